@@ -0,0 +1,907 @@
+// Headless benchmarks for motion evaluation.
+//
+// Usage: ishi_animations_bench file.bvh [file.bvh ...]
+
+#include <core/bbox.h>
+#include <core/dual_quaternion.h>
+#include <core/matrix.h>
+#include <core/point.h>
+#include <core/quaternion.h>
+#include <core/rigid.h>
+#include <core/transform.h>
+#include <core/vector.h>
+
+// C++ library includes
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "./batch.h"
+#include "./crowd.h"
+#include "./joint.h"
+#include "./joint_query.h"
+#include "./loader.h"
+#include "./memory.h"
+#include "./parallel_eval.h"
+#include "./pose_cache.h"
+#include "./symbol.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+// Number of passes over every frame of a clip per measurement
+const int kPasses = 5;
+
+/// Run a function and return the wall time it took, in milliseconds
+template <class F>
+double TimeMs(F f) {
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  f();
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+  return chrono::duration<double, milli>(end - start).count();
+}
+
+/// Return the largest difference between the elements of two matrices
+float MaxDifference(const Matrix4x4 &a, const Matrix4x4 &b) {
+  float difference = 0.f;
+  for (int r = 0; r < 4; r++)
+    for (int c = 0; c < 4; c++)
+      difference = fmax(difference, fabs(a.m[r][c] - b.m[r][c]));
+  return difference;
+}
+
+/// Return the largest difference between the matrices of two arrays of
+/// transforms
+float MaxDifference(const Transform *a, const Transform *b, uint32_t n) {
+  float difference = 0.f;
+  for (uint32_t i = 0; i < n; i++)
+    difference = fmax(difference, MaxDifference(a[i].Matrix(),
+                                                b[i].Matrix()));
+  return difference;
+}
+
+/// Print a result line as time per pose and poses per second
+void Report(const char *name, double ms, uint64_t poses) {
+  printf("  %-36s %10.3f us/pose %12.0f poses/s\n",
+         name, 1000.0 * ms / poses, poses / (ms / 1000.0));
+}
+
+/// Compare the recursive Segment::Update against the flattened skeleton
+void BenchForwardKinematics(SceneGraph *sg) {
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  const Skeleton &skeleton = sg->clip->skeleton;
+  vector<Transform> world(skeleton.NumJoints());
+  PlaybackInstance instance(sg->clip);
+
+  // The recursive walk reads frames in the layout they were loaded in
+  vector<float> source(static_cast<size_t>(numFrames) *
+                       skeleton.sourceFrameSize);
+  for (uint32_t f = 0; f < numFrames; f++)
+    skeleton.Unpack(sg->Frame(f), &source[f * skeleton.sourceFrameSize]);
+
+  double recursive = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      for (uint32_t f = 0; f < numFrames; f++) {
+        sg->root->frameIndex = f;
+        sg->root->Update(&source[f * skeleton.sourceFrameSize]);
+      }
+    }
+  });
+
+  // The same skeleton without its topology's specialized evaluator
+  Skeleton generic = skeleton;
+  generic.evaluator = NULL;
+  double flat = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        generic.Evaluate(sg->Frame(f), &world[0]);
+  });
+
+  double specialized = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        skeleton.Evaluate(sg->Frame(f), &world[0]);
+  });
+
+  // Rotations stored with the clip, so no trigonometry is left
+  vector<Quaternion> rotations(static_cast<size_t>(numFrames) *
+                               skeleton.NumRotations());
+  skeleton.Rotations(sg->Frame(0), numFrames, &rotations[0]);
+  const uint32_t numRotations = skeleton.NumRotations();
+  double stored = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        skeleton.Evaluate(sg->Frame(f), &rotations[f * numRotations],
+                          &world[0]);
+  });
+
+  instance.SetIncremental(false);
+  double playback = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        instance.SetCurrentFrame(f);
+  });
+
+  // Display ticks that fall between frames, a third of a frame apart
+  const double secondsPerFrame = sg->clip->MsPerFrame() / 1000.0;
+  double sampled = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        instance.SampleAtTime((f + 0.33) * secondsPerFrame);
+  });
+
+  PlaybackInstance storedInstance(ClipPtr(new Clip(
+      skeleton, sg->clip->frames, sg->clip->frameTime, true)));
+  double sampledStored = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        storedInstance.SampleAtTime((f + 0.33) * secondsPerFrame);
+  });
+
+  instance.SetIncremental(true);
+  instance.ResetStats();
+  double incremental = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        instance.SetCurrentFrame(f);
+  });
+
+  // A take holding every pose for four frames, as a capture played back
+  // at four times its rate without interpolation
+  const uint32_t hold = 4;
+  vector<float> heldFrames;
+  heldFrames.reserve(sg->clip->frames.size() * hold);
+  for (uint32_t f = 0; f < numFrames; f++)
+    for (uint32_t h = 0; h < hold; h++)
+      heldFrames.insert(heldFrames.end(), sg->Frame(f),
+                        sg->Frame(f) + skeleton.frameSize);
+  PlaybackInstance held(ClipPtr(new Clip(
+      skeleton, heldFrames, sg->clip->frameTime / hold)));
+  double heldFull = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames * hold; f++)
+        held.SetCurrentFrame(f);
+  });
+  held.SetIncremental(true);
+  held.ResetStats();
+  double heldIncremental = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames * hold; f++)
+        held.SetCurrentFrame(f);
+  });
+
+  double current = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        sg->SetCurrentFrame(f);
+  });
+
+  // The specialized evaluator must match the generic one bit for bit
+  float topologyDifference = 0.f;
+  if (skeleton.evaluator) {
+    vector<Transform> expected(world.size());
+    for (uint32_t f = 0; f < numFrames; f++) {
+      generic.Evaluate(sg->Frame(f), &expected[0]);
+      skeleton.Evaluate(sg->Frame(f), &world[0]);
+      topologyDifference = fmax(topologyDifference, MaxDifference(
+          &expected[0], &world[0], world.size()));
+    }
+  }
+
+  Report("Segment::Update (recursive)", recursive, poses);
+  Report("Skeleton::Evaluate (flat)", flat, poses);
+  if (skeleton.evaluator)
+    Report("Skeleton::Evaluate (topology)", specialized, poses);
+  else
+    printf("  no specialized evaluator for this topology\n");
+  if (topologyDifference > 0.f)
+    printf("  Topology evaluator differs from the generic one by %g\n",
+           topologyDifference);
+  Report("Skeleton::Evaluate (quaternions)", stored, poses);
+  Report("PlaybackInstance::SetCurrentFrame", playback, poses);
+  Report("PlaybackInstance::SampleAtTime", sampled, poses);
+  Report("SampleAtTime (stored rotations)", sampledStored, poses);
+  Report("PlaybackInstance (incremental)", incremental, poses);
+  printf("  incremental: %.1f%% of local and %.1f%% of world transforms "
+         "reused\n", 100.0 * instance.Stats().LocalReusedFraction(),
+         100.0 * instance.Stats().SkippedFraction());
+  Report("Poses held 4 frames (full)", heldFull, poses * hold);
+  Report("Poses held 4 frames (incremental)", heldIncremental, poses * hold);
+  printf("  held: %.1f%% of local and %.1f%% of world transforms reused\n",
+         100.0 * held.Stats().LocalReusedFraction(),
+         100.0 * held.Stats().SkippedFraction());
+  Report("SceneGraph::SetCurrentFrame", current, poses);
+}
+
+/// Compare composing a whole pose from local transforms with Transform
+/// (matrix and inverse), RigidTransform and DualQuaternion
+void BenchComposition(SceneGraph *sg) {
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const uint32_t n = skeleton.NumJoints();
+
+  // Local transforms of every frame, so only composition is timed
+  vector<Transform> local(static_cast<size_t>(numFrames) * n);
+  vector<RigidTransform> rigidLocal(local.size());
+  vector<DualQuaternion> dualLocal(local.size());
+  for (uint32_t f = 0; f < numFrames; f++) {
+    for (uint32_t j = 0; j < n; j++) {
+      local[f * n + j] = skeleton.Local(j, sg->Frame(f));
+      rigidLocal[f * n + j] = RigidTransform(local[f * n + j]);
+      dualLocal[f * n + j] = DualQuaternion(local[f * n + j]);
+    }
+  }
+
+  vector<Transform> world(n);
+  double general = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      for (uint32_t f = 0; f < numFrames; f++) {
+        const Transform *l = &local[f * n];
+        world[0] = l[0];
+        for (uint32_t j = 1; j < n; j++)
+          world[j] = world[skeleton.parents[j]] * l[j];
+      }
+    }
+  });
+
+  vector<RigidTransform> rigidWorld(n);
+  double rigid = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      for (uint32_t f = 0; f < numFrames; f++) {
+        const RigidTransform *l = &rigidLocal[f * n];
+        rigidWorld[0] = l[0];
+        for (uint32_t j = 1; j < n; j++)
+          rigidWorld[j] = rigidWorld[skeleton.parents[j]] * l[j];
+      }
+    }
+  });
+
+  vector<DualQuaternion> dualWorld(n);
+  double dual = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      for (uint32_t f = 0; f < numFrames; f++) {
+        const DualQuaternion *l = &dualLocal[f * n];
+        dualWorld[0] = l[0];
+        for (uint32_t j = 1; j < n; j++)
+          dualWorld[j] = dualWorld[skeleton.parents[j]] * l[j];
+      }
+    }
+  });
+
+  char name[64];
+  snprintf(name, sizeof(name), "Transform composition (%zu B)",
+           sizeof(Transform));
+  Report(name, general, poses);
+  snprintf(name, sizeof(name), "RigidTransform composition (%zu B)",
+           sizeof(RigidTransform));
+  Report(name, rigid, poses);
+  snprintf(name, sizeof(name), "DualQuaternion composition (%zu B)",
+           sizeof(DualQuaternion));
+  Report(name, dual, poses);
+}
+
+/// The matrix product as it was before Mul was vectorized, as a baseline
+Matrix4x4 ScalarMul(const Matrix4x4 &m1, const Matrix4x4 &m2) {
+  Matrix4x4 r;
+
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      r.m[i][j] = m1.m[i][0] * m2.m[0][j] +
+          m1.m[i][1] * m2.m[1][j] +
+          m1.m[i][2] * m2.m[2][j] +
+          m1.m[i][3] * m2.m[3][j];
+    }
+  }
+
+  return r;
+}
+
+/// Compare the scalar and vectorized matrix products, one at a time and
+/// batched, on the local matrices of every frame: composed down the
+/// hierarchy, and multiplied pairwise with the previous frame's. Then
+/// invert them one at a time and batched.
+void BenchMatrix(SceneGraph *sg) {
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const uint32_t n = skeleton.NumJoints();
+
+  vector<Matrix4x4> local(static_cast<size_t>(numFrames) * n);
+  for (uint32_t f = 0; f < numFrames; f++)
+    for (uint32_t j = 0; j < n; j++)
+      local[f * n + j] = skeleton.Local(j, sg->Frame(f)).Matrix();
+
+  vector<Matrix4x4> world(n);
+  double scalarChain = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      for (uint32_t f = 0; f < numFrames; f++) {
+        const Matrix4x4 *l = &local[f * n];
+        world[0] = l[0];
+        for (uint32_t j = 1; j < n; j++)
+          world[j] = ScalarMul(world[skeleton.parents[j]], l[j]);
+      }
+    }
+  });
+
+  double mulChain = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      for (uint32_t f = 0; f < numFrames; f++) {
+        const Matrix4x4 *l = &local[f * n];
+        world[0] = l[0];
+        for (uint32_t j = 1; j < n; j++)
+          world[j] = Mul(world[skeleton.parents[j]], l[j]);
+      }
+    }
+  });
+
+  double batchChain = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        MulMatrixChain(&local[f * n], &skeleton.parents[0], n, &world[0]);
+  });
+
+  double scalarPairs = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 1; f < numFrames; f++)
+        for (uint32_t j = 0; j < n; j++)
+          world[j] = ScalarMul(local[(f - 1) * n + j], local[f * n + j]);
+  });
+
+  double batchPairs = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 1; f < numFrames; f++)
+        MulMatrices(&local[(f - 1) * n], &local[f * n], n, &world[0]);
+  });
+
+  Report("Matrix chain (scalar Mul)", scalarChain, poses);
+  Report("Matrix chain (Mul)", mulChain, poses);
+  Report("MulMatrixChain", batchChain, poses);
+  vector<Matrix4x4> inverse(n);
+  double single = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        for (uint32_t j = 0; j < n; j++)
+          Inverse(local[f * n + j], &inverse[j]);
+  });
+
+  double batchInverse = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        InverseMatrices(&local[f * n], n, &inverse[0]);
+  });
+
+  Report("Matrix pairs (scalar Mul)", scalarPairs, poses);
+  Report("MulMatrices", batchPairs, poses);
+  Report("Matrix inverse (Inverse)", single, poses);
+  Report("InverseMatrices", batchInverse, poses);
+}
+
+/// Measure evaluation at every skeletal level of detail, through the
+/// topology's specialized evaluator (if any) and the generic one
+void BenchLod(SceneGraph *sg) {
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  const Skeleton &skeleton = sg->clip->skeleton;
+  Skeleton generic = skeleton;
+  generic.evaluator = NULL;
+  vector<Transform> world(skeleton.NumJoints());
+  vector<Transform> expected(skeleton.NumJoints());
+
+  float difference = 0.f;
+  for (int lod = 0; lod < kNumLods; lod++) {
+    double ms = TimeMs([&]() {
+      for (int p = 0; p < kPasses; p++)
+        for (uint32_t f = 0; f < numFrames; f++)
+          skeleton.Evaluate(sg->Frame(f), lod, &world[0]);
+    });
+    double genericMs = TimeMs([&]() {
+      for (int p = 0; p < kPasses; p++)
+        for (uint32_t f = 0; f < numFrames; f++)
+          generic.Evaluate(sg->Frame(f), lod, &world[0]);
+    });
+
+    // Kept joints must get what a full evaluation gives them
+    for (uint32_t f = 0; f < numFrames; f++) {
+      skeleton.Evaluate(sg->Frame(f), &expected[0]);
+      for (int k = 0; k < 2; k++) {
+        (k ? generic : skeleton).Evaluate(sg->Frame(f), lod, &world[0]);
+        for (uint32_t j = 0; j < skeleton.NumJoints(); j++) {
+          if (skeleton.lods[j] >= lod)
+            difference = fmax(difference, MaxDifference(
+                expected[j].Matrix(), world[j].Matrix()));
+        }
+      }
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "Skeleton::Evaluate LOD %d (%u joints)",
+             lod, skeleton.NumJointsAtLod(lod));
+    Report(name, ms, poses);
+    if (skeleton.evaluator) {
+      snprintf(name, sizeof(name), "  generic LOD %d", lod);
+      Report(name, genericMs, poses);
+    }
+  }
+  if (difference > 0.f)
+    printf("  Level of detail evaluation differs from Skeleton::Evaluate "
+           "by %g\n", difference);
+}
+
+/// Return the largest difference between the batch evaluators and
+/// Skeleton::Evaluate: EvaluateFrames and EvaluateTrajectories over a frame
+/// count that leaves frames outside a full group, and EvaluatePoses of
+/// unrelated, placed frames at every level of detail
+float BatchDifference(SceneGraph *sg) {
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const uint32_t n = skeleton.NumJoints();
+  const uint32_t w = BatchWidth();
+  uint32_t numFrames = sg->NumFrames();
+  if (numFrames > w && numFrames % w == 0)
+    numFrames--;
+  const size_t size = static_cast<size_t>(n) * numFrames;
+
+  vector<Point> positions(size);
+  vector<Matrix4x4> matrices(size);
+  vector<float> x(size), y(size), z(size);
+  PointArrays trajectories = {&x[0], &y[0], &z[0]};
+  EvaluateFrames(skeleton, sg->Frame(0), numFrames, &positions[0],
+                 &matrices[0]);
+  EvaluateTrajectories(skeleton, sg->Frame(0), numFrames, trajectories);
+
+  vector<Transform> world(n);
+  float difference = 0.f;
+  for (uint32_t f = 0; f < numFrames; f++) {
+    skeleton.Evaluate(sg->Frame(f), &world[0]);
+    for (uint32_t j = 0; j < n; j++) {
+      size_t i = static_cast<size_t>(f) * n + j;
+      size_t t = static_cast<size_t>(j) * numFrames + f;
+      Point p = world[j](Point());
+      difference = fmax(difference, MaxDifference(world[j].Matrix(),
+                                                  matrices[i]));
+      difference = fmax(difference, Distance(p, positions[i]));
+      difference = fmax(difference, Distance(p, Point(x[t], y[t], z[t])));
+    }
+  }
+
+  // Frames from all over the clip, each placed at its own spot
+  const uint32_t numPoses = min(numFrames, 2 * w + 3);
+  vector<const float *> frames(numPoses);
+  vector<Matrix4x4> roots(numPoses);
+  for (uint32_t i = 0; i < numPoses; i++) {
+    frames[i] = sg->Frame((numFrames - 1) - i * (numFrames / numPoses));
+    roots[i] = Translate(Vector(i, 0.f, -2.f * i)).Matrix();
+  }
+  for (int lod = 0; lod < kNumLods; lod++) {
+    EvaluatePoses(skeleton, &frames[0], &roots[0], lod, numPoses,
+                  &positions[0], &matrices[0]);
+    // The root matrix is the root joint's parent, so it is composed down
+    // the hierarchy like any other parent
+    for (uint32_t i = 0; i < numPoses; i++) {
+      for (uint32_t j = 0; j < n; j++) {
+        int32_t p = skeleton.parents[j];
+        world[j] = (p < 0 ? Rigid(roots[i]) : world[p]) *
+            skeleton.Local(j, frames[i]);
+        if (skeleton.lods[j] < lod)
+          continue;
+        difference = fmax(difference, MaxDifference(
+            world[j].Matrix(), matrices[i * n + j]));
+        difference = fmax(difference, Distance(world[j](Point()),
+                                               positions[i * n + j]));
+      }
+    }
+  }
+  return difference;
+}
+
+/// Measure multi-frame evaluation of every frame of the clip
+void BenchBatch(SceneGraph *sg) {
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const float *frames = sg->Frame(0);
+  vector<Point> positions(numFrames * skeleton.NumJoints());
+  vector<Matrix4x4> matrices(numFrames * skeleton.NumJoints());
+
+  double batchPositions = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      EvaluateFrames(skeleton, frames, numFrames, &positions[0], NULL);
+  });
+
+  double batchMatrices = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      EvaluateFrames(skeleton, frames, numFrames, NULL, &matrices[0]);
+  });
+
+  char name[64];
+  snprintf(name, sizeof(name), "EvaluateFrames x%d (positions)",
+           BatchWidth());
+  Report(name, batchPositions, poses);
+  snprintf(name, sizeof(name), "EvaluateFrames x%d (matrices)", BatchWidth());
+  Report(name, batchMatrices, poses);
+
+  float difference = BatchDifference(sg);
+  if (difference > 0.f)
+    printf("  Batch evaluation differs from Skeleton::Evaluate by %g\n",
+           difference);
+}
+
+/// Compare geometry over the joint positions of every frame, stored point
+/// by point from EvaluateFrames against trajectories of arrays from
+/// EvaluateTrajectories: the speed of every joint between frames, the
+/// bounds of the whole motion, and placing the motion in the world.
+void BenchGeometry(SceneGraph *sg) {
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const uint32_t n = skeleton.NumJoints();
+  const size_t size = static_cast<size_t>(n) * numFrames;
+  const Transform place = Translate(Vector(10, 0, -5)) * RotateY(0.5f);
+
+  vector<Point> points(size), placed(size);
+  vector<float> speeds(size), x(size), y(size), z(size);
+  vector<float> px(size), py(size), pz(size);
+  PointArrays trajectories = {&x[0], &y[0], &z[0]};
+  PointArrays placedArrays = {&px[0], &py[0], &pz[0]};
+  EvaluateFrames(skeleton, sg->Frame(0), numFrames, &points[0], NULL);
+  EvaluateTrajectories(skeleton, sg->Frame(0), numFrames, trajectories);
+
+  BBox bounds;
+  double aos = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      bounds = BBox();
+      for (uint32_t f = 0; f + 1 < numFrames; f++)
+        for (uint32_t j = 0; j < n; j++)
+          speeds[j * numFrames + f] =
+              Distance(points[f * n + j], points[(f + 1) * n + j]);
+      for (size_t i = 0; i < size; i++)
+        bounds = Union(bounds, points[i]);
+      for (size_t i = 0; i < size; i++)
+        placed[i] = place(points[i]);
+    }
+  });
+
+  BBox arrayBounds;
+  double soa = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++) {
+      for (uint32_t j = 0; numFrames > 1 && j < n; j++) {
+        size_t first = static_cast<size_t>(j) * numFrames;
+        PointArrays from = {&x[first], &y[first], &z[first]};
+        PointArrays to = {&x[first + 1], &y[first + 1], &z[first + 1]};
+        DistancePoints(from, to, numFrames - 1, &speeds[first]);
+      }
+      arrayBounds = Bounds(trajectories, size);
+      TransformPoints(place, trajectories, size, placedArrays);
+    }
+  });
+
+  Report("Speeds, bounds, placement (Point)", aos, poses);
+  Report("Speeds, bounds, placement (arrays)", soa, poses);
+  if (!(bounds.pMin == arrayBounds.pMin) || !(bounds.pMax == arrayBounds.pMax))
+    printf("  Bounds of the trajectories differ\n");
+}
+
+/// Compare querying the world transforms of the end effectors over the
+/// whole clip against a full evaluation of every frame
+void BenchJointQuery(SceneGraph *sg) {
+  static const char *kEffectors[] = {
+    "LeftFoot", "RightFoot", "LeftHand", "RightHand", "Head"
+  };
+  const uint32_t count = sizeof(kEffectors) / sizeof(kEffectors[0]);
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  const Skeleton &skeleton = sg->clip->skeleton;
+  int32_t ids[count];
+  sg->JointIndices(kEffectors, count, ids);
+
+  JointQuery query(skeleton, ids, count);
+  vector<float> out(query.OutputSize(numFrames));
+  vector<Transform> world(skeleton.NumJoints());
+
+  double full = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        skeleton.Evaluate(sg->Frame(f), &world[0]);
+  });
+
+  double serial = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      query.Run(*sg->clip, 0, numFrames, &out[0]);
+  });
+
+  ThreadPool pool;
+  double parallel = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      query.Run(*sg->clip, 0, numFrames, &out[0], &pool);
+  });
+
+  // Serial and pooled runs must both give what a full evaluation does
+  vector<float> single(out.size());
+  query.Run(*sg->clip, 0, numFrames, &single[0]);
+  float difference = 0.f;
+  for (uint32_t f = 0; f < numFrames; f++) {
+    skeleton.Evaluate(sg->Frame(f), &world[0]);
+    for (uint32_t q = 0; q < count; q++) {
+      Matrix4x4 m = (ids[q] >= 0) ? world[ids[q]].Matrix() : Matrix4x4();
+      for (uint32_t e = 0; e < kQueryValues; e++) {
+        size_t i = (q * kQueryValues + e) * static_cast<size_t>(numFrames) + f;
+        difference = fmax(difference, fabs(m.m[e / 4][e % 4] - out[i]));
+        difference = fmax(difference, fabs(m.m[e / 4][e % 4] - single[i]));
+      }
+    }
+  }
+
+  char name[64];
+  printf("  joint query: %u joints evaluating %u of %u\n", count,
+         query.NumEvaluated(), skeleton.NumJoints());
+  if (difference > 0.f)
+    printf("  Joint query differs from Skeleton::Evaluate by %g\n",
+           difference);
+  Report("Skeleton::Evaluate (all joints)", full, poses);
+  Report("JointQuery::Run", serial, poses);
+  snprintf(name, sizeof(name), "JointQuery::Run (%u threads)",
+           pool.NumThreads());
+  Report(name, parallel, poses);
+}
+
+/// Measure baking a pose cache, mapping it back from disk, and playing
+/// from it
+void BenchPoseCache(SceneGraph *sg, const char *path) {
+  const uint32_t numFrames = sg->NumFrames();
+  const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+  string cachePath = PoseCache::PathFor(path, POSE_MATRICES);
+  PoseCachePtr baked, mapped;
+  ThreadPool pool;
+
+  double bakeOne = TimeMs([&]() {
+    baked = PoseCache::Bake(*sg->clip, POSE_MATRICES);
+  });
+  double bakeAll = TimeMs([&]() {
+    baked = PoseCache::Bake(*sg->clip, POSE_MATRICES, &pool);
+  });
+  if (!baked->Save(cachePath))
+    printf("  could not save %s\n", cachePath.c_str());
+  double open = TimeMs([&]() {
+    mapped = PoseCache::Open(cachePath, *sg->clip, POSE_MATRICES);
+  });
+
+  PlaybackInstance instance(sg->clip);
+  instance.SetPoseCache(mapped ? mapped : baked);
+  double lookup = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        instance.SetCurrentFrame(f);
+  });
+
+  sg->SetPoseCache(mapped ? mapped : baked);
+  double current = TimeMs([&]() {
+    for (int p = 0; p < kPasses; p++)
+      for (uint32_t f = 0; f < numFrames; f++)
+        sg->SetCurrentFrame(f);
+  });
+  sg->SetPoseCache(PoseCachePtr());
+
+  printf("  pose cache: bake %.2f ms (1 thread), %.2f ms (%u threads), "
+         "open %.2f ms%s, %.1f KB\n", bakeOne, bakeAll, pool.NumThreads(),
+         open, mapped ? " (mapped)" : " (failed)",
+         baked->Memory().Total() / 1024.0);
+  Report("PlaybackInstance (pose cache)", lookup, poses);
+  Report("SceneGraph::SetCurrentFrame (cache)", current, poses);
+}
+
+/// Measure crowd updates at a range of crowd sizes, on one thread and on
+/// every hardware thread
+void BenchCrowd(SceneGraph *sg) {
+  const uint32_t sizes[] = {100, 1000, 10000};
+  const int ticks = 20;
+  const float tickMs = 1000.f / 60.f;
+  const float duration = sg->NumFrames() * sg->MsPerFrame();
+
+  for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    double ms[2];
+    unsigned int threads[2] = {1, 0};
+    for (int t = 0; t < 2; t++) {
+      Crowd crowd(threads[t]);
+      threads[t] = crowd.NumThreads();
+
+      // Spread the members over a grid, each at its own point in the clip
+      uint32_t side = static_cast<uint32_t>(sqrt(sizes[s])) + 1;
+      srand(1);
+      for (uint32_t i = 0; i < sizes[s]; i++) {
+        Matrix4x4 root;
+        root.m[0][3] = 100.f * (i % side);
+        root.m[2][3] = 100.f * (i / side);
+        crowd.Add(sg->clip, duration * rand() / RAND_MAX, 1.f, root);
+      }
+      crowd.Evaluate();
+
+      ms[t] = TimeMs([&]() {
+        for (int i = 0; i < ticks; i++)
+          crowd.Update(tickMs);
+      }) / ticks;
+    }
+    printf("  Crowd of %5u: %8.3f ms/tick (1 thread) %8.3f ms/tick "
+           "(%u threads)\n", sizes[s], ms[0], ms[1], threads[1]);
+  }
+}
+
+/// Measure time-sliced crowd updates: a tenth of the crowd in the
+/// foreground, the rest sharing a budget
+void BenchCrowdBudget(SceneGraph *sg) {
+  const uint32_t size = 10000;
+  const int ticks = 20;
+  const float tickMs = 1000.f / 60.f;
+  const float duration = sg->NumFrames() * sg->MsPerFrame();
+  UpdateBudget budgets[3];
+  budgets[1].maxMembers = 1000;
+  budgets[2].maxMs = 2.f;
+
+  for (int b = 0; b < 3; b++) {
+    Crowd crowd;
+    srand(1);
+    for (uint32_t i = 0; i < size; i++) {
+      uint32_t id = crowd.Add(sg->clip, duration * rand() / RAND_MAX, 1.f,
+                              Matrix4x4());
+      crowd.SetPriority(id, (i % 10 == 0) ? 1.f : 0.1f + 0.8f * i / size);
+    }
+    crowd.SetBudget(budgets[b]);
+    crowd.Evaluate();
+
+    uint64_t evaluated = 0;
+    double ms = TimeMs([&]() {
+      for (int i = 0; i < ticks; i++) {
+        crowd.Update(tickMs);
+        evaluated += crowd.Stats().evaluated;
+      }
+    }) / ticks;
+
+    char name[64];
+    if (budgets[b].maxMembers)
+      snprintf(name, sizeof(name), "%u members", budgets[b].maxMembers);
+    else if (budgets[b].maxMs > 0.f)
+      snprintf(name, sizeof(name), "%.1f ms", budgets[b].maxMs);
+    else
+      snprintf(name, sizeof(name), "none");
+    printf("  Crowd of %5u, budget %-12s %8.3f ms/tick, %6.0f updated/tick"
+           "\n", size, name, ms, static_cast<double>(evaluated) / ticks);
+  }
+}
+
+/// Build a procedural rig: a moving root with numChains chains of
+/// chainLength rotating joints (tails, cloth strands), each ending in an end
+/// site, animated with random angles
+SceneGraph *BuildRig(uint32_t numChains, uint32_t chainLength,
+                     uint32_t numFrames) {
+  SceneGraph *sg = new SceneGraph;
+  int rootOrder[6] = {BVH_XPOS_IDX, BVH_YPOS_IDX, BVH_ZPOS_IDX,
+                      BVH_ZROT_IDX, BVH_XROT_IDX, BVH_YROT_IDX};
+  int jointOrder[3] = {BVH_ZROT_IDX, BVH_XROT_IDX, BVH_YROT_IDX};
+  float offset[3] = {0.f, 2.f, 0.f};
+  uint32_t id = 0;
+  uint32_t frameSize = 0;
+  char name[64];
+
+  sg->CreateRoot("rig", id);
+  sg->SetNumChannels(id, 6);
+  sg->SetChannelFlags(id, BVH_XPOS | BVH_YPOS | BVH_ZPOS | BVH_XROT |
+                      BVH_YROT | BVH_ZROT);
+  sg->SetChannelOrder(id, rootOrder);
+  sg->SetFrameIndex(id, frameSize);
+  frameSize += 6;
+
+  for (uint32_t c = 0; c < numChains; c++) {
+    uint32_t parent = 0;
+    for (uint32_t j = 0; j <= chainLength; j++) {
+      id++;
+      snprintf(name, sizeof(name), "chain%u_%u", c, j);
+      if (j == chainLength) {
+        sg->CreateEndSite(name, id);
+      } else {
+        sg->CreateJoint(name, id);
+        sg->SetNumChannels(id, 3);
+        sg->SetChannelFlags(id, BVH_XROT | BVH_YROT | BVH_ZROT);
+        sg->SetChannelOrder(id, jointOrder);
+        sg->SetFrameIndex(id, frameSize);
+        frameSize += 3;
+      }
+      sg->SetChild(parent, id);
+      sg->SetOffset(id, offset);
+      parent = id;
+    }
+  }
+
+  sg->SetFrameTime(1.f / 30.f);
+  sg->SetNumFrames(numFrames);
+  sg->SetFrameSize(frameSize);
+  vector<float> frame(frameSize);
+  srand(1);
+  for (uint32_t f = 0; f < numFrames; f++) {
+    for (uint32_t i = 0; i < frameSize; i++)
+      frame[i] = 90.f * rand() / RAND_MAX - 45.f;
+    sg->AddFrame(&frame[0]);
+  }
+  sg->Compile();
+  return sg;
+}
+
+/// Compare serial and task-parallel evaluation of procedural rigs from a
+/// few hundred to a few thousand joints
+void BenchLargeRigs() {
+  const uint32_t shapes[][2] = {{8, 16}, {32, 32}, {64, 64}};
+  const uint32_t numFrames = 60;
+  ThreadPool pool;
+
+  for (uint32_t r = 0; r < sizeof(shapes) / sizeof(shapes[0]); r++) {
+    SceneGraph *sg = BuildRig(shapes[r][0], shapes[r][1], numFrames);
+    const Skeleton &skeleton = sg->clip->skeleton;
+    const uint64_t poses = static_cast<uint64_t>(kPasses) * numFrames;
+    vector<Transform> world(skeleton.NumJoints());
+    ParallelEvaluator parallel(skeleton, &pool);
+
+    double serial = TimeMs([&]() {
+      for (int p = 0; p < kPasses; p++) {
+        for (uint32_t f = 0; f < numFrames; f++)
+          skeleton.Evaluate(sg->Frame(f), &world[0]);
+      }
+    });
+    double split = TimeMs([&]() {
+      for (int p = 0; p < kPasses; p++) {
+        for (uint32_t f = 0; f < numFrames; f++)
+          parallel.Evaluate(sg->Frame(f), &world[0]);
+      }
+    });
+
+    char name[64];
+    printf("  Rig of %u joints: %u tasks, %u trunk joints, %u threads\n",
+           skeleton.NumJoints(), parallel.NumTasks(),
+           parallel.NumTrunkJoints(), pool.NumThreads());
+    Report("Skeleton::Evaluate (serial)", serial, poses);
+    snprintf(name, sizeof(name), "ParallelEvaluator%s",
+             parallel.IsParallel() ? "" : " (serial fallback)");
+    Report(name, split, poses);
+    delete sg;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printf("Usage: %s file.bvh [file.bvh ...]\n", argv[0]);
+    exit(0);
+  }
+
+  MemoryUsage total;
+
+  for (int i = 1; i < argc; i++) {
+    SceneGraph *sg = new SceneGraph;
+    BVHLoader::loadBVH(argv[i], sg);
+
+    const Skeleton &skeleton = sg->clip->skeleton;
+    printf("%s: %u joints, %u frames, %u of %u channels animated\n",
+           argv[i], skeleton.NumJoints(), sg->NumFrames(), skeleton.frameSize,
+           skeleton.sourceFrameSize);
+    PrintMemoryUsage("Memory", sg->Memory());
+    total += sg->Memory();
+    BenchForwardKinematics(sg);
+    BenchComposition(sg);
+    BenchMatrix(sg);
+    BenchLod(sg);
+    BenchBatch(sg);
+    BenchGeometry(sg);
+    BenchJointQuery(sg);
+    BenchPoseCache(sg, argv[i]);
+    BenchCrowd(sg);
+    BenchCrowdBudget(sg);
+  }
+  printf("Procedural rigs:\n");
+  BenchLargeRigs();
+
+  PrintMemoryUsage("All clips", total);
+  printf("Symbol table: %.1f KB\n",
+         SymbolTable::Shared().MemoryBytes() / 1024.0);
+
+  return 0;
+}
@@ -0,0 +1,300 @@
+#include <core/euler.h>
+#include <core/lanes.h>
+#include <core/matrix.h>
+#include <core/point.h>
+#include <core/sincos.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "./batch.h"
+#include "./skeleton.h"
+
+using namespace std;
+using namespace ishi;
+
+// Values per joint in the world buffer: a 3x3 rotation and a translation
+static const int kWorldSize = 12;
+
+/// Scratch buffers shared by every group of one EvaluateFrames call. Each
+/// holds one value per lane, so element i of lane l is at [i * width + l].
+struct BatchScratch {
+  vector<float> values;  // frame values
+  vector<float> angles;  // batched angles, then their sines
+  vector<float> cosines; // cosines of the batched angles
+  vector<float> world;   // world rotation and translation of each joint
+  vector<float> root;    // rotation and translation placing the root
+};
+
+template <class L>
+static void EulerRotationLanes(RotationOrder order, const L c[3],
+                               const L s[3], L r[3][3]) {
+  switch (order) {
+    case ROT_XYZ: EulerRotation<0, 1, 2>(c, s, r); break;
+    case ROT_XZY: EulerRotation<0, 2, 1>(c, s, r); break;
+    case ROT_YXZ: EulerRotation<1, 0, 2>(c, s, r); break;
+    case ROT_YZX: EulerRotation<1, 2, 0>(c, s, r); break;
+    case ROT_ZXY: EulerRotation<2, 0, 1>(c, s, r); break;
+    case ROT_ZYX: EulerRotation<2, 1, 0>(c, s, r); break;
+  }
+}
+
+/// Evaluate L::kWidth frames, one per lane, keeping the joints of a level
+/// of detail. The world transform of each joint is composed as
+/// Rw = Rp * Rl, tw = Rp * tl + tp, summed in the same order as Mul so
+/// results match Skeleton::Evaluate. If placed, the root's parent transform
+/// is read from scratch->root.
+template <class L>
+static void EvaluateGroup(const Skeleton &skeleton, const float *const *frames,
+                          int lod, bool placed, BatchScratch *scratch) {
+  const int w = L::kWidth;
+  const uint32_t numJoints = skeleton.NumJoints();
+  const uint32_t numAngles = skeleton.NumAngles();
+  const uint32_t frameSize = skeleton.frameSize;
+  float *values = &scratch->values[0];
+  float *angles = &scratch->angles[0];
+  float *cosines = &scratch->cosines[0];
+
+  // Transpose the frames so each value is contiguous across lanes
+  for (int l = 0; l < w; l++) {
+    const float *frame = frames[l];
+    for (uint32_t i = 0; i < frameSize; i++)
+      values[i * w + l] = frame[i];
+  }
+
+  // Gather every rotation angle, then take all sines and cosines in one go
+  for (uint32_t j = 0; j < numJoints; j++) {
+    const ChannelLayout &layout = skeleton.channels[j];
+    if (skeleton.lods[j] < lod) {
+      j = skeleton.subtreeEnd[j] - 1;
+      continue;
+    }
+    if (layout.angles < 0)
+      continue;
+    for (int i = 0; i < 3; i++) {
+      uint32_t a = layout.angles + i;
+      float *dst = angles + a * w;
+      if (skeleton.angleSources[a] >= 0) {
+        const float *src = values + skeleton.angleSources[a] * w;
+        for (int l = 0; l < w; l++)
+          dst[l] = src[l];
+      } else {
+        for (int l = 0; l < w; l++)
+          dst[l] = skeleton.angleDefaults[a];
+      }
+    }
+  }
+  SinCosDegrees(angles, numAngles * w, angles, cosines);
+
+  for (uint32_t j = 0; j < numJoints; j++) {
+    const ChannelLayout &layout = skeleton.channels[j];
+    float *world = &scratch->world[j * kWorldSize * w];
+    if (skeleton.lods[j] < lod) {
+      j = skeleton.subtreeEnd[j] - 1;
+      continue;
+    }
+
+    // Local transform. Fixed joints broadcast their bind transform.
+    L t[3], r[3][3];
+    bool rotates = layout.rotation[0] >= 0;
+    if (layout.fixed) {
+      const Matrix4x4 m = skeleton.bind[j].Matrix();
+      for (int i = 0; i < 3; i++) {
+        t[i] = L(m.m[i][3]);
+        for (int k = 0; k < 3; k++)
+          r[i][k] = L(m.m[i][k]);
+      }
+    } else {
+      for (int i = 0; i < 3; i++) {
+        t[i] = L(skeleton.bindOffsets[j][i]);
+        if (layout.storedPosition[i] >= 0)
+          t[i] = t[i] + L::Load(values + layout.storedPosition[i] * w);
+      }
+      if (rotates) {
+        L c[3], s[3];
+        for (int i = 0; i < 3; i++) {
+          s[i] = L::Load(angles + (layout.angles + i) * w);
+          c[i] = L::Load(cosines + (layout.angles + i) * w);
+        }
+        EulerRotationLanes(layout.rotationOrder, c, s, r);
+      }
+    }
+
+    int32_t p = skeleton.parents[j];
+    if (p < 0 && !placed) {
+      for (int i = 0; i < 3; i++) {
+        for (int k = 0; k < 3; k++)
+          (rotates ? r[i][k] : L(i == k ? 1.f : 0.f)).Store(
+              world + (i * 3 + k) * w);
+        t[i].Store(world + (9 + i) * w);
+      }
+      continue;
+    }
+
+    const float *parent = (p < 0) ? &scratch->root[0] :
+        &scratch->world[p * kWorldSize * w];
+    L pr[3][3];
+    for (int i = 0; i < 3; i++)
+      for (int k = 0; k < 3; k++)
+        pr[i][k] = L::Load(parent + (i * 3 + k) * w);
+
+    for (int i = 0; i < 3; i++) {
+      for (int k = 0; k < 3; k++) {
+        L v = rotates ?
+            pr[i][0] * r[0][k] + pr[i][1] * r[1][k] + pr[i][2] * r[2][k] :
+            pr[i][k];
+        v.Store(world + (i * 3 + k) * w);
+      }
+      L v = pr[i][0] * t[0] + pr[i][1] * t[1] + pr[i][2] * t[2] +
+          L::Load(parent + (9 + i) * w);
+      v.Store(world + (9 + i) * w);
+    }
+  }
+}
+
+/// Spread the rigid matrices placing each lane's root over the lanes
+static void LoadRoots(const Matrix4x4 *roots, int w, BatchScratch *scratch) {
+  for (int l = 0; l < w; l++) {
+    const Matrix4x4 &m = roots[l];
+    for (int i = 0; i < 3; i++) {
+      for (int k = 0; k < 3; k++)
+        scratch->root[(i * 3 + k) * w + l] = m.m[i][k];
+      scratch->root[(9 + i) * w + l] = m.m[i][3];
+    }
+  }
+}
+
+/// Copy the world transforms of a group's kept joints out of the lanes
+static void StoreGroup(const Skeleton &skeleton, const BatchScratch &scratch,
+                       int lod, int w, Point *positions,
+                       Matrix4x4 *matrices) {
+  const uint32_t numJoints = skeleton.NumJoints();
+  for (uint32_t j = 0; j < numJoints; j++) {
+    if (skeleton.lods[j] < lod) {
+      j = skeleton.subtreeEnd[j] - 1;
+      continue;
+    }
+    const float *world = &scratch.world[j * kWorldSize * w];
+    for (int l = 0; l < w; l++) {
+      const float *t = world + 9 * w + l;
+      if (positions)
+        positions[l * numJoints + j] = Point(t[0], t[w], t[2 * w]);
+      if (matrices) {
+        const float *r = world + l;
+        matrices[l * numJoints + j] = Matrix4x4(
+            r[0], r[w], r[2 * w], t[0],
+            r[3 * w], r[4 * w], r[5 * w], t[w],
+            r[6 * w], r[7 * w], r[8 * w], t[2 * w],
+            0.f, 0.f, 0.f, 1.f);
+      }
+    }
+  }
+}
+
+/// Copy the positions of a group of consecutive frames out of the lanes,
+/// where each one's lanes are already contiguous over the frames
+static void StoreTrajectories(const Skeleton &skeleton,
+                              const BatchScratch &scratch, int w,
+                              uint32_t frame, uint32_t numFrames,
+                              const PointArrays &positions) {
+  const uint32_t numJoints = skeleton.NumJoints();
+  float *dst[3] = {positions.x, positions.y, positions.z};
+  for (uint32_t j = 0; j < numJoints; j++) {
+    const float *t = &scratch.world[(j * kWorldSize + 9) * w];
+    for (int i = 0; i < 3; i++)
+      copy(t + i * w, t + (i + 1) * w,
+           dst[i] + static_cast<size_t>(j) * numFrames + frame);
+  }
+}
+
+/// Size the scratch buffers for a skeleton and a lane width
+static void ResizeScratch(const Skeleton &skeleton, int w,
+                          BatchScratch *scratch) {
+  scratch->values.resize(skeleton.frameSize * w + 1);
+  scratch->angles.resize(skeleton.NumAngles() * w + 1);
+  scratch->cosines.resize(skeleton.NumAngles() * w + 1);
+  scratch->world.resize(skeleton.NumJoints() * kWorldSize * w);
+  scratch->root.resize(kWorldSize * w);
+}
+
+void EvaluateFrames(const Skeleton &skeleton, const float *frames,
+                    uint32_t numFrames, Point *positions,
+                    Matrix4x4 *matrices) {
+  const int w = FloatN::kWidth;
+  const uint32_t numJoints = skeleton.NumJoints();
+  BatchScratch scratch;
+  ResizeScratch(skeleton, w, &scratch);
+
+  const float *group[FloatN::kWidth];
+  uint32_t f = 0;
+  for (; f + w <= numFrames; f += w) {
+    for (int l = 0; l < w; l++)
+      group[l] = frames + (f + l) * skeleton.frameSize;
+    EvaluateGroup<FloatN>(skeleton, group, 0, false, &scratch);
+    StoreGroup(skeleton, scratch, 0, w,
+               positions ? positions + f * numJoints : NULL,
+               matrices ? matrices + f * numJoints : NULL);
+  }
+  for (; f < numFrames; f++) {
+    group[0] = frames + f * skeleton.frameSize;
+    EvaluateGroup<Float1>(skeleton, group, 0, false, &scratch);
+    StoreGroup(skeleton, scratch, 0, 1,
+               positions ? positions + f * numJoints : NULL,
+               matrices ? matrices + f * numJoints : NULL);
+  }
+}
+
+void EvaluateTrajectories(const Skeleton &skeleton, const float *frames,
+                          uint32_t numFrames, const PointArrays &positions) {
+  const int w = FloatN::kWidth;
+  BatchScratch scratch;
+  ResizeScratch(skeleton, w, &scratch);
+
+  const float *group[FloatN::kWidth];
+  uint32_t f = 0;
+  for (; f + w <= numFrames; f += w) {
+    for (int l = 0; l < w; l++)
+      group[l] = frames + (f + l) * skeleton.frameSize;
+    EvaluateGroup<FloatN>(skeleton, group, 0, false, &scratch);
+    StoreTrajectories(skeleton, scratch, w, f, numFrames, positions);
+  }
+  for (; f < numFrames; f++) {
+    group[0] = frames + f * skeleton.frameSize;
+    EvaluateGroup<Float1>(skeleton, group, 0, false, &scratch);
+    StoreTrajectories(skeleton, scratch, 1, f, numFrames, positions);
+  }
+}
+
+/// Groups are filled exactly like EvaluateFrames, but with one pointer per
+/// lane, so poses of unrelated frames vectorize just as well.
+void EvaluatePoses(const Skeleton &skeleton, const float *const *frames,
+                   const Matrix4x4 *roots, int lod, uint32_t numPoses,
+                   Point *positions, Matrix4x4 *matrices) {
+  const int w = FloatN::kWidth;
+  const uint32_t numJoints = skeleton.NumJoints();
+  static thread_local BatchScratch scratch;
+  ResizeScratch(skeleton, w, &scratch);
+
+  uint32_t i = 0;
+  for (; i + w <= numPoses; i += w) {
+    if (roots)
+      LoadRoots(roots + i, w, &scratch);
+    EvaluateGroup<FloatN>(skeleton, frames + i, lod, roots != NULL, &scratch);
+    StoreGroup(skeleton, scratch, lod, w,
+               positions ? positions + i * numJoints : NULL,
+               matrices ? matrices + i * numJoints : NULL);
+  }
+  for (; i < numPoses; i++) {
+    if (roots)
+      LoadRoots(roots + i, 1, &scratch);
+    EvaluateGroup<Float1>(skeleton, frames + i, lod, roots != NULL, &scratch);
+    StoreGroup(skeleton, scratch, lod, 1,
+               positions ? positions + i * numJoints : NULL,
+               matrices ? matrices + i * numJoints : NULL);
+  }
+}
+
+int BatchWidth() {
+  return FloatN::kWidth;
+}
@@ -0,0 +1,51 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <core/matrix.h>
+#include <core/point.h>
+
+#include <stdint.h>
+
+#include "./skeleton.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Evaluate forward kinematics for many consecutive frames at once, for
+/// offline consumers (feature extraction, error metrics, bounds) that need
+/// every frame of a clip.
+///
+/// Frames are processed in groups as wide as the SIMD lanes of the build
+/// (8 with AVX, 4 with SSE2): each lane holds the same joint at a different
+/// frame, so the skeleton is traversed once per group and all the math is
+/// vectorized. Leftover frames go through the same kernel one at a time.
+///
+/// Results are stored frame after frame, NumJoints() entries per frame.
+/// Either output may be NULL if it is not needed.
+void EvaluateFrames(const Skeleton &skeleton, const float *frames,
+                    uint32_t numFrames, Point *positions,
+                    Matrix4x4 *matrices);
+
+/// Evaluate the position of every joint over consecutive frames (as
+/// EvaluateFrames) into arrays, trajectory after trajectory: joint j at
+/// frame f is at index j * numFrames + f, so batch geometry (see
+/// PointArrays) runs over whole trajectories. Each array must hold
+/// NumJoints() * numFrames values.
+void EvaluateTrajectories(const Skeleton &skeleton, const float *frames,
+                          uint32_t numFrames, const PointArrays &positions);
+
+/// Evaluate forward kinematics for unrelated frames of one skeleton, e.g.
+/// one per character of a crowd playing the same clip. Each pose may be
+/// placed in the world by a rigid root matrix (roots may be NULL), and only
+/// the joints kept at a level of detail are evaluated and stored.
+///
+/// Results are stored pose after pose, NumJoints() entries per pose.
+/// Either output may be NULL if it is not needed.
+void EvaluatePoses(const Skeleton &skeleton, const float *const *frames,
+                   const Matrix4x4 *roots, int lod, uint32_t numPoses,
+                   Point *positions, Matrix4x4 *matrices);
+
+/// Return the number of frames evaluated together by EvaluateFrames
+int BatchWidth();
+
+#endif
@@ -0,0 +1,58 @@
+#include <core/quaternion.h>
+
+#include <stdint.h>
+#include <vector>
+
+#include "./clip.h"
+#include "./memory.h"
+#include "./skeleton.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Return the rotations of all frames of a clip
+static vector<Quaternion> AllRotations(const Skeleton &skeleton,
+                                       const vector<float> &frames) {
+  uint32_t numFrames = skeleton.frameSize ?
+      frames.size() / skeleton.frameSize : 0;
+  vector<Quaternion> rotations(numFrames * skeleton.NumRotations());
+  if (!rotations.empty())
+    skeleton.Rotations(&frames[0], numFrames, &rotations[0]);
+  return rotations;
+}
+
+Clip::Clip(const Skeleton &skeleton, const vector<float> &frames,
+           float frameTime, bool storeRotations)
+    : skeleton(skeleton), frames(frames), frameTime(frameTime),
+      rotations(storeRotations ? AllRotations(skeleton, frames) :
+                vector<Quaternion>()) {}
+
+uint32_t Clip::NumFrames() const {
+  return skeleton.frameSize ? frames.size() / skeleton.frameSize : 0;
+}
+
+uint32_t Clip::FrameSize() const {
+  return skeleton.frameSize;
+}
+
+const float *Clip::Frame(uint32_t frameNumber) const {
+  return &frames[static_cast<size_t>(frameNumber) * skeleton.frameSize];
+}
+
+const Quaternion *Clip::Rotations(uint32_t frameNumber) const {
+  if (rotations.empty())
+    return NULL;
+  return &rotations[static_cast<size_t>(frameNumber) *
+                    skeleton.NumRotations()];
+}
+
+float Clip::MsPerFrame() const {
+  return frameTime;
+}
+
+MemoryUsage Clip::Memory() const {
+  MemoryUsage m;
+  m.skeleton = sizeof(*this) + kHeapOverhead + skeleton.MemoryBytes();
+  m.frames = HeapBytes(frames) + HeapBytes(rotations);
+  return m;
+}
@@ -0,0 +1,65 @@
+#ifndef __CLIP_H__
+#define __CLIP_H__
+
+#include <core/quaternion.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "./memory.h"
+#include "./skeleton.h"
+
+using namespace std;
+using namespace ishi;
+
+class Clip;
+
+/// Shared, reference-counted handle to a read-only clip
+typedef shared_ptr<const Clip> ClipPtr;
+
+/// The immutable part of a loaded motion: the skeleton, every frame of
+/// motion data and the frame rate.
+///
+/// A clip may also store the rotation of every rotating joint of every
+/// frame as a quaternion, so playback composes local transforms without
+/// any trigonometry. That takes 16 bytes per rotation and frame, against
+/// the 48 of a rigid matrix.
+///
+/// A clip is never modified after construction, so any number of playback
+/// instances, on any number of threads, may read it at once without locking.
+class Clip {
+ public:
+  const Skeleton skeleton;    // flattened hierarchy and channel layout
+  const vector<float> frames; // all frame data, one frame after another
+  const float frameTime;      // time between each frame (in milliseconds)
+  const vector<Quaternion> rotations; // rotations of all frames, one frame
+                                      // after another (empty if not stored)
+
+ public:
+  /// Initialize a clip from a skeleton and its frames, storing the
+  /// rotations of every frame as quaternions if requested
+  Clip(const Skeleton &skeleton, const vector<float> &frames,
+       float frameTime, bool storeRotations = false);
+
+  /// Return the total number of frames
+  uint32_t NumFrames() const;
+
+  /// Return the number of values in each frame
+  uint32_t FrameSize() const;
+
+  /// Return the data for a frame
+  const float *Frame(uint32_t frameNumber) const;
+
+  /// Return the stored rotations of a frame (Skeleton::NumRotations()
+  /// quaternions), or NULL if the clip does not store rotations
+  const Quaternion *Rotations(uint32_t frameNumber) const;
+
+  /// Return the time between frames, in milliseconds
+  float MsPerFrame() const;
+
+  /// Return the bytes used by the clip (skeleton, frames and rotations)
+  MemoryUsage Memory() const;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "./clip.h"
+#include "./clip_view.h"
+
+using namespace std;
+
+ClipView::ClipView()
+    : numFrames(0) {}
+
+ClipView::ClipView(const ClipPtr &source)
+    : numFrames(0) {
+  Append(source, 0, source->NumFrames());
+}
+
+ClipView::ClipView(const ClipPtr &source, uint32_t begin, uint32_t end)
+    : numFrames(0) {
+  Append(source, begin, end);
+}
+
+bool ClipView::Append(const ClipPtr &source, uint32_t begin,
+                      uint32_t end) {
+  if (begin > end || end > source->NumFrames())
+    return false;
+  if (!ranges.empty() &&
+      !ranges[0].source->skeleton.Matches(source->skeleton))
+    return false;
+  if (begin == end)
+    return true;
+
+  // Extend the last range instead of adding one when they are contiguous
+  if (!ranges.empty() && ranges.back().source.get() == source.get() &&
+      ranges.back().end == begin) {
+    ranges.back().end = end;
+  } else {
+    FrameRange r = { source, begin, end };
+    ranges.push_back(r);
+    starts.push_back(numFrames);
+  }
+  numFrames += end - begin;
+  return true;
+}
+
+bool ClipView::Append(const ClipView &view) {
+  if (!ranges.empty() && !view.ranges.empty() &&
+      !ranges[0].source->skeleton.Matches(view.ranges[0].source->skeleton))
+    return false;
+
+  // Copy the ranges first, as the view may be this one
+  vector<FrameRange> appended = view.ranges;
+  for (unsigned int i = 0; i < appended.size(); i++) {
+    const FrameRange &r = appended[i];
+    Append(r.source, r.begin, r.end);
+  }
+  return true;
+}
+
+ClipView ClipView::Trim(uint32_t begin, uint32_t end) const {
+  ClipView view;
+  end = min(end, numFrames);
+
+  for (unsigned int i = 0; i < ranges.size() && begin < end; i++) {
+    uint32_t length = ranges[i].end - ranges[i].begin;
+    uint32_t rangeEnd = starts[i] + length;
+    if (begin >= rangeEnd)
+      continue;
+
+    uint32_t first = ranges[i].begin + (begin - starts[i]);
+    uint32_t last = ranges[i].begin + (min(end, rangeEnd) - starts[i]);
+    view.Append(ranges[i].source, first, last);
+    begin = rangeEnd;
+  }
+  return view;
+}
+
+uint32_t ClipView::NumFrames() const {
+  return numFrames;
+}
+
+uint32_t ClipView::FrameSize() const {
+  return ranges.empty() ? 0 : ranges[0].source->skeleton.frameSize;
+}
+
+/// Find the range holding the frame by binary search over the range starts
+const float *ClipView::Frame(uint32_t frameNumber) const {
+  unsigned int i = upper_bound(starts.begin(), starts.end(), frameNumber) -
+      starts.begin() - 1;
+  return ranges[i].source->Frame(ranges[i].begin + frameNumber - starts[i]);
+}
+
+const vector<FrameRange> &ClipView::Ranges() const {
+  return ranges;
+}
+
+void ClipView::Materialize(vector<float> *frames) const {
+  frames->clear();
+  frames->reserve(static_cast<size_t>(numFrames) * FrameSize());
+
+  for (unsigned int i = 0; i < ranges.size(); i++) {
+    const FrameRange &r = ranges[i];
+    const float *first = r.source->Frame(r.begin);
+    const float *last = first + (r.end - r.begin) * FrameSize();
+    frames->insert(frames->end(), first, last);
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef __CLIP_VIEW_H__
+#define __CLIP_VIEW_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "./clip.h"
+
+using namespace std;
+
+/// A half-open range [begin, end) of frames in a loaded clip
+struct FrameRange {
+  ClipPtr source;             // clip the frames belong to
+  uint32_t begin;             // index of the first frame in the range
+  uint32_t end;               // index one past the last frame in the range
+};
+
+/// A sequence of frame ranges, possibly from several clips, that is played
+/// back as if it were one clip. No frame data is copied; the view holds
+/// references to the clips it was built from.
+///
+/// All ranges must come from clips that share a skeleton (the same frame
+/// layout).
+class ClipView {
+ private:
+  vector<FrameRange> ranges;  // ranges, in playback order
+  vector<uint32_t> starts;    // index of the first frame of each range
+  uint32_t numFrames;         // total number of frames in all ranges
+
+ public:
+  /// Initialize an empty view
+  ClipView();
+
+  /// Initialize a view of every frame in a clip
+  explicit ClipView(const ClipPtr &source);
+
+  /// Initialize a view of frames [begin, end) of a clip
+  ClipView(const ClipPtr &source, uint32_t begin, uint32_t end);
+
+  /// Append frames [begin, end) of a clip to the end of the view.
+  /// Return false (leaving the view unchanged) if the range is out of bounds
+  /// or the clip does not share the view's skeleton.
+  bool Append(const ClipPtr &source, uint32_t begin, uint32_t end);
+
+  /// Append all ranges of a view (which may be this one) to the end of this
+  /// view. Return false (leaving the view unchanged) if the view does not
+  /// share this view's skeleton.
+  bool Append(const ClipView &view);
+
+  /// Return a view of frames [begin, end) of this view
+  ClipView Trim(uint32_t begin, uint32_t end) const;
+
+  /// Return the total number of frames
+  uint32_t NumFrames() const;
+
+  /// Return the number of values in each frame (0 for an empty view)
+  uint32_t FrameSize() const;
+
+  /// Return the data for a frame of the view
+  const float *Frame(uint32_t frameNumber) const;
+
+  /// Return the ranges making up the view
+  const vector<FrameRange> &Ranges() const;
+
+  /// Copy every frame of the view, one after another, into a buffer
+  void Materialize(vector<float> *frames) const;
+};
+
+#endif
@@ -0,0 +1,297 @@
+#include <core/matrix.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "./batch.h"
+#include "./clip.h"
+#include "./crowd.h"
+#include "./memory.h"
+#include "./skeleton.h"
+
+using namespace std;
+using namespace ishi;
+
+// Most members evaluated by one task. A multiple of every SIMD width, and
+// small enough to keep a batch's poses in cache while it is evaluated.
+static const uint32_t kMaxBatchSize = 64;
+
+// Lowest priority counted when scheduling, so hidden members still come
+// round now and then
+static const float kMinPriority = 0.01f;
+
+UpdateBudget::UpdateBudget()
+    : maxMembers(0), maxMs(0.f) {}
+
+/// Return the inverse of a rigid matrix (its rotation transposed)
+static Matrix4x4 RigidInverse(const Matrix4x4 &m) {
+  Matrix4x4 r;
+  for (int i = 0; i < 3; i++) {
+    for (int k = 0; k < 3; k++)
+      r.m[i][k] = m.m[k][i];
+    r.m[i][3] = -(m.m[0][i] * m.m[0][3] + m.m[1][i] * m.m[1][3] +
+                  m.m[2][i] * m.m[2][3]);
+  }
+  return r;
+}
+
+Crowd::Crowd(unsigned int numThreads)
+    : grouped(true), msPerMember(0.f), time(0.0), pool(numThreads) {
+  stats = CrowdStats();
+}
+
+uint32_t Crowd::Add(const ClipPtr &clip, float timeOffset, float rate,
+                    const Matrix4x4 &root) {
+  CrowdMember m;
+  m.clip = clip;
+  m.timeOffset = timeOffset;
+  m.rate = rate;
+  m.root = root;
+  m.lod = 0;
+  m.priority = kForegroundPriority;
+  m.urgency = 0.f;
+  m.evaluated = false;
+  m.currentFrame = 0;
+  m.first = 0;
+  members.push_back(m);
+  grouped = false;
+  return members.size() - 1;
+}
+
+uint32_t Crowd::Size() const {
+  return members.size();
+}
+
+const CrowdMember &Crowd::Member(uint32_t id) const {
+  return members[id];
+}
+
+void Crowd::SetRoot(uint32_t id, const Matrix4x4 &root) {
+  members[id].root = root;
+}
+
+/// The offset is moved so the member carries on from where it is now
+/// rather than jumping to where the new rate would have put it.
+void Crowd::SetRate(uint32_t id, float rate) {
+  CrowdMember &m = members[id];
+  m.timeOffset += (m.rate - rate) * time;
+  m.rate = rate;
+}
+
+void Crowd::SetLod(uint32_t id, int lod) {
+  lod = max(0, min(lod, kNumLods - 1));
+  if (members[id].lod != lod) {
+    members[id].lod = lod;
+    grouped = false;
+  }
+}
+
+void Crowd::SetPriority(uint32_t id, float priority) {
+  members[id].priority = priority;
+}
+
+void Crowd::SetBudget(const UpdateBudget &budget) {
+  this->budget = budget;
+}
+
+const CrowdStats &Crowd::Stats() const {
+  return stats;
+}
+
+double Crowd::GetTime() const {
+  return time;
+}
+
+/// Members are sorted by clip and level of detail, and each run is cut
+/// into batches of at most kMaxBatchSize members.
+void Crowd::Group() {
+  order = vector<uint32_t>(members.size());
+  for (uint32_t i = 0; i < members.size(); i++)
+    order[i] = i;
+  sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    const CrowdMember &ma = members[a], &mb = members[b];
+    if (ma.clip != mb.clip)
+      return ma.clip.get() < mb.clip.get();
+    if (ma.lod != mb.lod)
+      return ma.lod < mb.lod;
+    return a < b;
+  });
+
+  batches.clear();
+  uint32_t numPoses = 0;
+  for (uint32_t i = 0; i < order.size(); i++) {
+    CrowdMember &m = members[order[i]];
+    m.first = numPoses;
+    m.evaluated = false;
+    numPoses += m.clip->skeleton.NumJoints();
+
+    if (batches.empty() || batches.back().clip != m.clip.get() ||
+        batches.back().lod != m.lod ||
+        batches.back().end - batches.back().begin == kMaxBatchSize) {
+      Batch b = {m.clip.get(), m.lod, i, i};
+      batches.push_back(b);
+    }
+    batches.back().end = i + 1;
+  }
+
+  poses = vector<Matrix4x4>(numPoses);
+  frames = vector<const float*>(order.size());
+  roots = vector<Matrix4x4>(order.size());
+  due = vector<uint8_t>(order.size(), 1);
+  grouped = true;
+}
+
+/// Foreground members and members without a pose are always due. The
+/// budget then goes to the background members with the highest urgency,
+/// sized from the recent cost per member when the budget is a time.
+void Crowd::Schedule() {
+  if (budget.maxMembers == 0 && budget.maxMs <= 0.f) {
+    fill(due.begin(), due.end(), 1);
+    return;
+  }
+
+  uint32_t foreground = 0;
+  waiting.clear();
+  for (uint32_t i = 0; i < order.size(); i++) {
+    CrowdMember &m = members[order[i]];
+    if (!m.evaluated || m.priority >= kForegroundPriority) {
+      due[i] = 1;
+      foreground++;
+    } else {
+      due[i] = 0;
+      m.urgency += max(m.priority, kMinPriority);
+      waiting.push_back(i);
+    }
+  }
+
+  uint32_t limit = waiting.size();
+  if (budget.maxMembers > 0)
+    limit = min(limit, budget.maxMembers);
+  if (budget.maxMs > 0.f && msPerMember > 0.f) {
+    float spare = budget.maxMs - foreground * msPerMember;
+    limit = min(limit, static_cast<uint32_t>(max(spare, 0.f) / msPerMember));
+  }
+
+  nth_element(waiting.begin(), waiting.begin() + limit, waiting.end(),
+              [this](uint32_t a, uint32_t b) {
+    return members[order[a]].urgency > members[order[b]].urgency;
+  });
+  for (uint32_t i = 0; i < limit; i++) {
+    due[waiting[i]] = 1;
+    members[order[waiting[i]]].urgency = 0.f;
+  }
+}
+
+/// Due members are packed to the front of the batch's slots in frames and
+/// roots. When every member is due their poses are written in place;
+/// otherwise they are evaluated into a scratch block and copied out.
+uint32_t Crowd::EvaluateBatch(const Batch &batch) {
+  const Clip &clip = *batch.clip;
+  const uint32_t numFrames = clip.NumFrames();
+  const uint32_t numJoints = clip.skeleton.NumJoints();
+  const double duration = numFrames * clip.MsPerFrame();
+  uint32_t count = 0, moved = 0;
+
+  for (uint32_t i = batch.begin; i < batch.end; i++) {
+    CrowdMember &m = members[order[i]];
+    Matrix4x4 *pose = &poses[m.first];
+
+    if (!due[i]) {
+      // Carry the previous pose along with the root
+      if (memcmp(&m.placed, &m.root, sizeof(Matrix4x4)) != 0) {
+        Matrix4x4 delta = Mul(m.root, RigidInverse(m.placed));
+        for (uint32_t j = 0; j < numJoints; j++)
+          pose[j] = Mul(delta, pose[j]);
+        m.placed = m.root;
+        moved++;
+      }
+      continue;
+    }
+
+    double t = fmod(m.timeOffset + m.rate * time, duration);
+    if (t < 0)
+      t += duration;
+    uint32_t f = static_cast<uint32_t>(t / clip.MsPerFrame());
+    m.currentFrame = min(f, numFrames - 1);
+    m.evaluated = true;
+    m.placed = m.root;
+    frames[batch.begin + count] = clip.Frame(m.currentFrame);
+    roots[batch.begin + count] = m.root;
+    count++;
+  }
+  if (count == 0)
+    return moved;
+
+  if (count == batch.end - batch.begin) {
+    uint32_t first = members[order[batch.begin]].first;
+    EvaluatePoses(clip.skeleton, &frames[batch.begin], &roots[batch.begin],
+                  batch.lod, count, NULL, &poses[first]);
+    return moved;
+  }
+
+  static thread_local vector<Matrix4x4> scratch;
+  if (scratch.size() < count * numJoints)
+    scratch.resize(count * numJoints);
+  EvaluatePoses(clip.skeleton, &frames[batch.begin], &roots[batch.begin],
+                batch.lod, count, NULL, &scratch[0]);
+  for (uint32_t i = batch.begin, k = 0; i < batch.end; i++) {
+    if (due[i]) {
+      memcpy(&poses[members[order[i]].first], &scratch[k * numJoints],
+             numJoints * sizeof(Matrix4x4));
+      k++;
+    }
+  }
+  return moved;
+}
+
+void Crowd::Update(float elapsedMs) {
+  time += elapsedMs;
+  Evaluate();
+}
+
+void Crowd::Evaluate() {
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  if (!grouped)
+    Group();
+  Schedule();
+
+  atomic<uint32_t> moved(0);
+  pool.Run(batches.size(), [this, &moved](uint32_t b) {
+    if (batches[b].clip->NumFrames() > 0)
+      moved += EvaluateBatch(batches[b]);
+  });
+
+  stats.evaluated = count(due.begin(), due.end(), 1);
+  stats.reused = order.size() - stats.evaluated;
+  stats.moved = moved;
+  stats.ms = chrono::duration<float, milli>(
+      chrono::steady_clock::now() - start).count();
+
+  // Track the cost per member, smoothed over recent ticks
+  if (stats.evaluated > 0) {
+    float ms = stats.ms / stats.evaluated;
+    msPerMember = (msPerMember > 0.f) ? 0.8f * msPerMember + 0.2f * ms : ms;
+  }
+}
+
+const Matrix4x4 *Crowd::Pose(uint32_t id) const {
+  return grouped ? &poses[members[id].first] : NULL;
+}
+
+unsigned int Crowd::NumThreads() const {
+  return pool.NumThreads();
+}
+
+MemoryUsage Crowd::Memory() const {
+  MemoryUsage m;
+  m.caches = sizeof(*this) + HeapBytes(members) + HeapBytes(order) +
+      HeapBytes(batches) + HeapBytes(poses) + HeapBytes(frames) +
+      HeapBytes(roots) + HeapBytes(due) + HeapBytes(waiting);
+  return m;
+}
@@ -0,0 +1,159 @@
+#ifndef __CROWD_H__
+#define __CROWD_H__
+
+#include <core/matrix.h>
+
+#include <stdint.h>
+#include <vector>
+
+#include "./clip.h"
+#include "./memory.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Members with at least this priority are updated every tick
+const float kForegroundPriority = 1.f;
+
+/// Timing and placement of one character in a crowd
+struct CrowdMember {
+  ClipPtr clip;               // motion played (shared with other members)
+  float timeOffset;           // time into the clip at crowd time zero (ms)
+  float rate;                 // playback speed (1 plays at the clip's rate)
+  Matrix4x4 root;             // rigid transform placing the character
+  int lod;                    // skeletal level of detail evaluated at
+  float priority;             // importance, e.g. from distance or visibility
+  float urgency;              // priority accumulated while not updated
+  bool evaluated;             // if false, the member has no pose yet
+  Matrix4x4 placed;           // root the current pose was placed with
+  uint32_t currentFrame;      // frame evaluated by the last update
+  uint32_t first;             // index of its first joint in the poses
+};
+
+/// Limits on the work spent each tick on background members (priority
+/// below kForegroundPriority). Zero means no limit.
+struct UpdateBudget {
+  uint32_t maxMembers;        // most background members updated per tick
+  float maxMs;                // most time spent updating per tick (ms)
+
+  /// Initialize a budget without limits
+  UpdateBudget();
+};
+
+/// Counts of members updated and skipped by the last tick
+struct CrowdStats {
+  uint32_t evaluated;         // members whose pose was evaluated
+  uint32_t reused;            // members that kept their previous pose
+  uint32_t moved;             // reused poses moved to a new root
+  float ms;                   // time the tick took
+};
+
+/// Many characters playing shared clips, evaluated together every tick.
+///
+/// Members only hold their timing and placement; motion data lives in the
+/// clips they share. Every update evaluates all members on a thread pool.
+/// Members playing the same clip at the same level of detail are grouped
+/// into batches that go through the SIMD multi-pose evaluator, and their
+/// poses are laid out next to each other so each batch writes one block.
+///
+/// With an update budget, background members are time-sliced: each tick
+/// only the most urgent of them are evaluated, where urgency is priority
+/// accumulated since a member's last update, so every member comes round
+/// in turn and important ones come round more often. The others keep
+/// their previous pose, moved along with their root if it changed.
+class Crowd {
+ private:
+  /// A run of members sharing a clip and level of detail
+  struct Batch {
+    const Clip *clip;         // clip played by every member of the batch
+    int lod;                  // level of detail of every member
+    uint32_t begin;           // first position in order
+    uint32_t end;             // one past the last position in order
+  };
+
+  vector<CrowdMember> members;    // every member, by id
+  vector<uint32_t> order;         // member ids, grouped into batches
+  vector<Batch> batches;          // runs of order evaluated as one task
+  bool grouped;                   // if false, batches must be rebuilt
+  vector<Matrix4x4> poses;        // world matrix of every member's joints
+  vector<const float*> frames;    // frame of each member, in order
+  vector<Matrix4x4> roots;        // root of each member, in order
+  vector<uint8_t> due;            // if set, evaluate the member, in order
+  vector<uint32_t> waiting;       // background positions in order
+  UpdateBudget budget;            // limits on background updates
+  float msPerMember;              // recent cost of evaluating a member
+  CrowdStats stats;               // work done by the last tick
+  double time;                    // crowd time (ms)
+  ThreadPool pool;                // threads evaluating the batches
+
+  Crowd(const Crowd &);
+  Crowd &operator=(const Crowd &);
+
+  /// Sort the members into batches and lay their poses out to match
+  void Group();
+
+  /// Choose the members to evaluate this tick
+  void Schedule();
+
+  /// Look up the frame of every due member of a batch, then evaluate them.
+  /// Members that are not due are moved to their current root. Returns the
+  /// number of members moved.
+  uint32_t EvaluateBatch(const Batch &batch);
+
+ public:
+  /// Initialize an empty crowd evaluated on numThreads threads
+  /// (0 uses one thread per hardware thread)
+  explicit Crowd(unsigned int numThreads = 0);
+
+  /// Add a member playing a clip and return its id
+  uint32_t Add(const ClipPtr &clip, float timeOffset, float rate,
+               const Matrix4x4 &root);
+
+  /// Return the number of members
+  uint32_t Size() const;
+
+  /// Return a member's timing and placement
+  const CrowdMember &Member(uint32_t id) const;
+
+  /// Move a member
+  void SetRoot(uint32_t id, const Matrix4x4 &root);
+
+  /// Change a member's playback speed, keeping its current time
+  void SetRate(uint32_t id, float rate);
+
+  /// Change the level of detail a member is evaluated at
+  void SetLod(uint32_t id, int lod);
+
+  /// Change how important a member is. Members below kForegroundPriority
+  /// share the update budget, in proportion to their priority.
+  void SetPriority(uint32_t id, float priority);
+
+  /// Limit the work spent on background members each tick
+  void SetBudget(const UpdateBudget &budget);
+
+  /// Return the work done by the last tick
+  const CrowdStats &Stats() const;
+
+  /// Return the crowd time (ms)
+  double GetTime() const;
+
+  /// Advance the crowd time and evaluate every member
+  void Update(float elapsedMs);
+
+  /// Evaluate the members scheduled at the current crowd time (every member
+  /// without a budget)
+  void Evaluate();
+
+  /// Return the world matrix of every joint of a member, as of the last
+  /// update. Joints dropped by the member's level of detail are stale.
+  const Matrix4x4 *Pose(uint32_t id) const;
+
+  /// Return the number of threads evaluating the crowd
+  unsigned int NumThreads() const;
+
+  /// Return the bytes used by the crowd (clips are not counted)
+  MemoryUsage Memory() const;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include <core/common.h>
+#include <core/matrix.h>
+#include <core/rigid.h>
 #include <core/vector.h>
 #include <core/transform.h>
 
@@ -12,6 +14,8 @@
 
 #include "./bvh_defs.h"
 #include "./joint.h"
+#include "./joint_query.h"
+#include "./pose_cache.h"
 
 using namespace std;
 using namespace ishi;
@@ -21,19 +25,25 @@ using namespace ishi;
 Segment::Segment(const char* name, uint32_t id) {
   /* Identification information */
   this->id = id;
-  this->name = name;
+  this->symbol = SymbolTable::Shared().Intern(name);
+  this->name = SymbolTable::Shared().Name(this->symbol);
 
   /* Hierarchy information */
   this->par = NULL;
-  this->w2o = Transform();
+  this->w2o = RigidTransform();
 
   /* Geometric information */
   this->offset = Vector();    // in local coordinates
   this->endpoint = Point();   // in world coordinates
   this->basepoint = Point();  // in world coordinates
 
+  /* Bind information */
+  this->boneLength = 0;
+
   /* Motion information */
   this->numChannels = 0;
+  this->channelIndex = 0;
+  this->frameIndex = 0;
 }
 
 /// The root node is defined as the node without a parent
@@ -46,14 +56,31 @@ bool Segment::IsEndSite() {
   return (chd.size() == 0);
 }
 
-void Segment::Update() {
-  vector<float> frame = frameData[frameIndex];  // Data for this frame
-  Vector trans = Vector(0, 0, 0);               // Translation vector
-  Transform rot = Transform();                  // Rotation data holder
+/// The bone runs from the joint to its first child, along the child's
+/// offset, which is also the object-space vector between the basepoint and
+/// endpoint of any frame.
+void Segment::Precompute() {
+  Vector dir = chd.size() > 0 ? chd[0]->offset : Vector();
+  float scale = 1.25 * Length(dir);
+
+  this->bind = RigidTransform(Translate(offset));
+  this->boneLength = Length(dir);
+  Matrix4x4 stretch = Matrix4x4(scale/4, 0, 0, 0,
+                                0, scale/4, 0, 0,
+                                0, 0, scale, scale/2.5,
+                                0, 0, 0, 1);
+  Transform align = AlignZ(dir);
+  this->bone = Mul(Mul(Inverse(align).Matrix(), stretch), align.Matrix());
+}
+
+void Segment::Update(const float *frame) {
+  const float *data = frame + channelIndex;   // Data for this node
+  Vector trans = Vector(0, 0, 0);             // Translation vector
+  Transform rot = Transform();                // Rotation data holder
 
   for (unsigned int i = 0; i < numChannels; i++) {
     // Get channel to update by order
-    float f = frame[i];         // The data point
+    float f = data[i];          // The data point
     int c = channelOrder[i];    // The channel it applies to
 
     // Read frame data
@@ -75,11 +102,15 @@ void Segment::Update() {
     }
   }
 
-  // Recompute world-to-object transformation
+  // Recompute world-to-object transformation, translating by the cached
+  // bind offset unless the joint has position channels of its own
+  RigidTransform local = bind * RigidTransform(rot);
+  if (channelFlags & (BVH_XPOS | BVH_YPOS | BVH_ZPOS))
+    local = RigidTransform(Translate(trans)) * local;
   if (par)
-    this->w2o = par->w2o * Translate(trans + this->offset) * rot;
+    this->w2o = par->w2o * local;
   else
-    this->w2o = Translate(trans + this->offset) * rot;
+    this->w2o = local;
 
   // Recompute basepoint
   this->basepoint = this->w2o(Point());
@@ -93,29 +124,16 @@ void Segment::Update() {
   // Do the same for all children (order doesn't matter)
   for (unsigned int i = 0; i < chd.size(); i++) {
     chd[i]->frameIndex = this->frameIndex;
-    chd[i]->Update();
+    chd[i]->Update(frame);
   }
 }
 
-void Segment::DistributeFrame(float** data) {
-  // Distribute to self first
-  vector<float> frame;
-  for (unsigned int i = 0; i < numChannels; i++) {
-    frame.push_back(**data);
-    (*data)++;
-  }
-  frameData.push_back(frame);
-
-  // Then distribute to the children (in order)
-  for (unsigned int i = 0; i < chd.size(); i++)
-    chd[i]->DistributeFrame(data);
-}
-
 void Segment::Render() {
   std::cout << "Rendering" << std::endl;
-  // Render this node
-  Vector dir = Inverse(w2o)(endpoint-basepoint);
-  float scale = 1.25 * Length(dir);
+  // Render this node. Joints collapsed onto their parent by the level of
+  // detail, and bones of no length, have nothing to stretch the sphere to.
+  bool stretched = !IsEndSite() && !IsRoot();
+  bool collapsed = boneLength == 0 || endpoint == basepoint;
 
   // Draw wireframe "muscle"
   glBegin(GL_LINES);
@@ -130,16 +148,12 @@ void Segment::Render() {
     glMultTransposeMatrixf(reinterpret_cast<float*>(w2o.Matrix().m));
 
     // Stretch sphere to the "muscle" length
-    if (!IsEndSite() && !IsRoot()) {
-      glMultTransposeMatrixf(
-        reinterpret_cast<float*>(Inverse(AlignZ(dir)).Matrix().m));
-      glTranslatef(0, 0, scale/2.5);
-      glScalef(scale/4, scale/4, scale);
-      glMultTransposeMatrixf(reinterpret_cast<float*>(AlignZ(dir).Matrix().m));
-    }
+    if (stretched)
+      glMultTransposeMatrixf(reinterpret_cast<float*>(bone.m));
 
     // Draw sphere
-    glutSolidSphere(INV_PI, 16, 16);
+    if (!stretched || !collapsed)
+      glutSolidSphere(INV_PI, 16, 16);
 
   // Restore the modelview transformation state
   glPopMatrix();
@@ -188,7 +202,8 @@ void SceneGraph::SetChannelOrder(uint32_t id, int * order) {
 }
 
 void SceneGraph::SetFrameIndex(uint32_t id, uint32_t index) {
-  nodes[id]->frameIndex = index;
+  // The loader reports where the node's channels start within a frame
+  nodes[id]->channelIndex = index;
 }
 
 void SceneGraph::SetFrameTime(float delta) {
@@ -203,22 +218,92 @@ void SceneGraph::SetNumFrames(uint32_t num) {
 
 void SceneGraph::SetFrameSize(uint32_t size) {
   frameSize = size;
+  frames.reserve(numFrames * frameSize);
 }
 
 void SceneGraph::AddFrame(float * data) {
-  // Distribute frame data to all nodes, starting at the root
-  root->DistributeFrame(&data);
+  frames.insert(frames.end(), data, data + frameSize);
+}
+
+void SceneGraph::Compile() {
+  Skeleton skeleton(root);
+  vector<float> stored;
+
+  for (unsigned int i = 0; i < nodes.size(); i++)
+    nodes[i]->Precompute();
+
+  // Segments missing from the mask keep their derived level
+  if (!jointLods.empty()) {
+    vector<uint8_t> levels = skeleton.lods;
+    for (uint32_t j = 0; j < skeleton.NumJoints(); j++) {
+      if (skeleton.ids[j] < jointLods.size())
+        levels[j] = jointLods[skeleton.ids[j]];
+    }
+    skeleton.SetLods(levels);
+  }
+
+  if (staticEpsilon >= 0.f) {
+    skeleton.FoldStaticChannels(frames, staticEpsilon, &stored);
+    frames.swap(stored);
+  }
+  clip = ClipPtr(new Clip(skeleton, frames, frameTime, storeRotations));
+  instance.SetClip(clip);
+  frames = vector<float>();
+}
+
+bool SceneGraph::Play(const ClipView *view) {
+  return instance.Play(view);
+}
+
+void SceneGraph::SetFrames(const vector<float> &data) {
+  clip = ClipPtr(new Clip(clip->skeleton, data, frameTime,
+                          !clip->rotations.empty()));
+  numFrames = clip->NumFrames();
+  instance.SetClip(clip);
+}
+
+bool SceneGraph::SetPoseCache(const PoseCachePtr &cache) {
+  return instance.SetPoseCache(cache);
 }
 
 void SceneGraph::SetCurrentFrame(uint32_t frameNumber) {
-  // Frame should loop around if the number of frames is exceeded
-  while (frameNumber >= numFrames)
-    frameNumber -= numFrames;
-  this->currentFrame = frameNumber;
+  instance.SetCurrentFrame(frameNumber);
+  UpdateSegments();
+}
 
-  // Change frame number for all children and request update
-  root->frameIndex = frameNumber;
-  root->Update();
+void SceneGraph::SampleAtTime(double seconds) {
+  instance.SampleAtTime(seconds);
+  UpdateSegments();
+}
+
+void SceneGraph::UpdateSegments() {
+  const Skeleton &skeleton = clip->skeleton;
+  const vector<Transform> &world = instance.world;
+  const Matrix4x4 *cached = instance.CachedPose();
+  uint32_t currentFrame = instance.GetCurrentFrame();
+  int lod = cached ? 0 : instance.GetLod();
+
+  for (uint32_t j = 0; j < skeleton.NumJoints(); j++) {
+    Segment *s = nodes[skeleton.ids[j]];
+    int32_t c = skeleton.firstChild[j];
+
+    s->frameIndex = currentFrame;
+
+    // Joints dropped by the level of detail collapse onto their parent
+    if (skeleton.lods[j] < lod) {
+      Segment *parent = nodes[skeleton.ids[skeleton.parents[j]]];
+      s->w2o = parent->w2o;
+      s->basepoint = s->endpoint = parent->basepoint;
+      continue;
+    }
+
+    s->w2o = cached ? RigidTransform(cached[j]) : RigidTransform(world[j]);
+    s->basepoint = s->w2o(Point());
+    if (c >= 0)
+      s->endpoint = s->w2o(Point() + skeleton.offsets[c]);
+    else
+      s->endpoint = s->basepoint;
+  }
 }
 
 float SceneGraph::MsPerFrame() {
@@ -230,5 +315,65 @@ float SceneGraph::FramePerMs() {
 }
 
 uint32_t SceneGraph::GetCurrentFrame() {
-  return currentFrame;
+  return instance.GetCurrentFrame();
+}
+
+double SceneGraph::GetTime() const {
+  return instance.GetTime();
+}
+
+/// The SceneGraph object itself, including the headers of its containers,
+/// is counted under the skeleton.
+MemoryUsage SceneGraph::Memory() const {
+  MemoryUsage m;
+
+  m += clip->Memory();
+  m += instance.Memory();
+  if (instance.GetPoseCache())
+    m += instance.GetPoseCache()->Memory();
+  m.skeleton += sizeof(*this) - sizeof(instance) + HeapBytes(nodes) +
+      HeapBytes(jointLods);
+  m.frames += HeapBytes(frames);
+
+  for (unsigned int i = 0; i < nodes.size(); i++) {
+    const Segment *s = nodes[i];
+    size_t render = sizeof(s->w2o) + sizeof(s->basepoint) +
+        sizeof(s->endpoint) + sizeof(s->bind) + sizeof(s->boneLength) +
+        sizeof(s->bone);
+
+    m.skeleton += sizeof(Segment) + kHeapOverhead - render +
+        HeapBytes(s->chd) + HeapBytes(s->channelOrder);
+    m.render += render;
+  }
+  return m;
+}
+
+int32_t SceneGraph::JointIndex(const char *name) {
+  return clip->skeleton.JointIndex(SymbolTable::Shared().Find(name));
+}
+
+int32_t SceneGraph::JointIndex(Symbol name) {
+  return clip->skeleton.JointIndex(name);
+}
+
+void SceneGraph::JointIndices(const char * const *names, uint32_t count,
+                              int32_t *indices) {
+  const SymbolTable &symbols = SymbolTable::Shared();
+  for (uint32_t i = 0; i < count; i++)
+    indices[i] = clip->skeleton.JointIndex(symbols.Find(names[i]));
+}
+
+uint32_t SceneGraph::NumFrames() const {
+  return numFrames;
+}
+
+bool SceneGraph::QueryJointWorld(const int32_t *jointIds, uint32_t count,
+                                 uint32_t frameBegin, uint32_t frameEnd,
+                                 float *out, ThreadPool *pool) const {
+  return ::QueryJointWorld(*clip, jointIds, count, frameBegin, frameEnd, out,
+                           pool);
+}
+
+const float *SceneGraph::Frame(uint32_t frameNumber) const {
+  return clip->Frame(frameNumber);
 }
@@ -1,7 +1,9 @@
 #ifndef __JOINT_H__
 #define __JOINT_H__
 
+#include <core/matrix.h>
 #include <core/point.h>
+#include <core/rigid.h>
 #include <core/vector.h>
 #include <core/transform.h>
 
@@ -10,6 +12,14 @@
 #include <string>
 
 #include "./bvh_defs.h"
+#include "./clip.h"
+#include "./clip_view.h"
+#include "./memory.h"
+#include "./playback.h"
+#include "./pose_cache.h"
+#include "./skeleton.h"
+#include "./symbol.h"
+#include "./thread_pool.h"
 #include "./vec.h"
 
 using namespace std;
@@ -22,26 +32,32 @@ class Segment {
  public:
   /* Identification information */
   uint32_t id;
-  std::string name;
+  Symbol symbol;          // interned name
+  const char *name;       // name, owned by the shared symbol table
 
   /* Hierarchy information */
   vector<Segment*> chd;   // pointers to child nodes
   Segment *par;           // pointer to parent node
-  Transform w2o;          // world space to object space transformation
+  RigidTransform w2o;     // world space to object space transformation
 
   /* Geometric information */
   Vector offset;
   Point endpoint;
   Point basepoint;
 
+  /* Bind information, constant once loading is complete (see Precompute) */
+  RigidTransform bind;    // translation by the offset
+  float boneLength;       // length of the bone to the first child
+  Matrix4x4 bone;         // stretches the joint's sphere along the bone,
+                          // in object space
+
   /* Motion information */
   uint16_t numChannels;       // number of channels (movement types) this has
   vector<int> channelOrder;   // how to interpret motion data
   uint16_t channelFlags;      // bit mask specifying available channels
+  uint32_t channelIndex;      // index of this node's first value in a frame
   uint32_t frameIndex;        // index of the motion frame this is at
 
-  vector<vector<float> > frameData;   // all frame data for this node
-
  public:
   /// Initialize a node
   Segment(const char *name, uint32_t id);
@@ -51,9 +67,14 @@ class Segment {
 
   /// Return true if the segment is an endsite
   bool IsEndSite();
-  void Update();
 
-  void DistributeFrame(float** data);
+  /// Cache the bind data of this node, which no frame changes. Must be
+  /// called again if the offsets of the node or its first child change.
+  void Precompute();
+
+  /// Recompute the transforms of all nodes from this node down, reading
+  /// channel values from a whole motion frame
+  void Update(const float *frame);
 
   /// Called to render all nodes from this node down
   void Render();
@@ -67,15 +88,32 @@ class SceneGraph {
   uint32_t frameSize;         // how many data points each frame has
   float frameTime;            // time between each frame (in milliseconds)
   float invFrameTime;         // number of frames per millisecond
-  uint32_t currentFrame;      // index of the motion frame this is at
+
+  vector<float> frames;       // frame data read so far, until Compile()
+
+  /// Copy the instance's current pose out to the segment tree
+  void UpdateSegments();
 
  public:
+  float staticEpsilon;        // channels varying by at most this much are
+                              // folded out of the frames (negative, the
+                              // default, disables folding)
+  bool storeRotations;        // if true, the clip stores every frame's
+                              // rotations as quaternions
+  vector<uint8_t> jointLods;  // level of detail of each segment, by id,
+                              // in place of the levels derived from the
+                              // skeleton (empty keeps those)
+
   Segment *root;              // point to root of the scene graph tree
+  ClipPtr clip;               // immutable motion data, shared by copies
+  PlaybackInstance instance;  // playback state driving the segment tree
 
  public:
   /// Initialize a SceneGraph
   SceneGraph() {
     nodes = vector<Segment*>();
+    staticEpsilon = -1.f;
+    storeRotations = false;
   }
 
   /*  Hierarchy Specification methods */
@@ -99,6 +137,32 @@ class SceneGraph {
   void AddFrame(float * data);
   void SetCurrentFrame(uint32_t frameNumber);
 
+  /// Show the pose at a time in seconds from the first frame, interpolated
+  /// between frames (see PlaybackInstance::SampleAtTime)
+  void SampleAtTime(double seconds);
+
+  /// Flatten the hierarchy and move the frames read so far into a shared,
+  /// read-only clip once loading is complete. Static channels are folded
+  /// out of the frames if staticEpsilon is not negative, and rotations are
+  /// stored as quaternions if storeRotations is set. Levels of detail in
+  /// jointLods are applied (see Skeleton::SetLods). Folding depends on the
+  /// motion, so folded clips only match clips folded the same way (see
+  /// Skeleton::Matches) and can rarely be joined in a ClipView.
+  void Compile();
+
+  /// Play the frames of a view instead of this clip's own frames. Return
+  /// false if the view does not share this clip's skeleton. Pass NULL to go
+  /// back to this clip's frames.
+  bool Play(const ClipView *view);
+
+  /// Read poses of this clip's frames from a baked cache instead of
+  /// evaluating them. Returns false if the cache does not fit the clip.
+  bool SetPoseCache(const PoseCachePtr &cache);
+
+  /// Play a new clip made from a contiguous copy of some stored frames
+  /// (e.g. from ClipView::Materialize)
+  void SetFrames(const vector<float> &data);
+
   /// Return the time between frames, in milliseconds
   float MsPerFrame();
 
@@ -107,6 +171,38 @@ class SceneGraph {
 
   /// Return the current frame index
   uint32_t GetCurrentFrame();
+
+  /// Return the time of the current pose, in seconds from the first frame
+  double GetTime() const;
+
+  /// Return the bytes used by this scene graph and its clip, by subsystem.
+  /// The shared symbol table is not included.
+  MemoryUsage Memory() const;
+
+  /// Return the skeleton index of the joint with a name, or -1 if none
+  int32_t JointIndex(const char *name);
+
+  /// Return the skeleton index of the joint with an interned name, or -1
+  int32_t JointIndex(Symbol name);
+
+  /// Resolve a list of names to skeleton indices (-1 for unknown names)
+  void JointIndices(const char * const *names, uint32_t count,
+                    int32_t *indices);
+
+  /// Return the total number of frames
+  uint32_t NumFrames() const;
+
+  /// Compute the world transforms of some joints (skeleton indices) over
+  /// frames [frameBegin, frameEnd) without changing the current pose (see
+  /// JointQuery for the layout of out). Returns false if the range is not
+  /// within the clip.
+  bool QueryJointWorld(const int32_t *jointIds, uint32_t count,
+                       uint32_t frameBegin, uint32_t frameEnd, float *out,
+                       ThreadPool *pool = NULL) const;
+
+  /// Return the stored data for a frame (clip->FrameSize() values; use
+  /// Skeleton::Unpack for the layout it was loaded in)
+  const float *Frame(uint32_t frameNumber) const;
 };
 
 
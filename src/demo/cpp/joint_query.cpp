@@ -0,0 +1,157 @@
+#include <core/matrix.h>
+#include <core/rigid.h>
+#include <core/sincos.h>
+#include <core/transform.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "./clip.h"
+#include "./joint_query.h"
+#include "./skeleton.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+JointQuery::JointQuery() : skeleton(NULL) {}
+
+/// Ancestors are marked by walking up from every queried joint until a
+/// joint already marked, so a shared ancestor is visited once.
+JointQuery::JointQuery(const Skeleton &skeleton, const int32_t *jointIds,
+                       uint32_t count)
+    : skeleton(&skeleton) {
+  const uint32_t n = skeleton.NumJoints();
+  vector<int32_t> position(n, -1);
+  vector<uint8_t> needed(n, 0);
+
+  for (uint32_t q = 0; q < count; q++) {
+    int32_t j = jointIds[q];
+    if (j < 0 || static_cast<uint32_t>(j) >= n)
+      continue;
+    for (; j >= 0 && !needed[j]; j = skeleton.parents[j])
+      needed[j] = 1;
+  }
+
+  // Joint indices are already in topological order
+  for (uint32_t j = 0; j < n; j++) {
+    if (!needed[j])
+      continue;
+    position[j] = joints.size();
+    joints.push_back(j);
+    int32_t p = skeleton.parents[j];
+    parents.push_back(p >= 0 ? position[p] : -1);
+
+    int32_t first = skeleton.channels[j].angles;
+    for (int i = 0; first >= 0 && i < 3; i++)
+      angles.push_back(first + i);
+  }
+
+  for (uint32_t q = 0; q < count; q++) {
+    int32_t j = jointIds[q];
+    bool known = j >= 0 && static_cast<uint32_t>(j) < n;
+    outputs.push_back(known ? position[j] : -1);
+  }
+}
+
+uint32_t JointQuery::NumQueried() const {
+  return outputs.size();
+}
+
+uint32_t JointQuery::NumEvaluated() const {
+  return joints.size();
+}
+
+size_t JointQuery::OutputSize(uint32_t numFrames) const {
+  return static_cast<size_t>(outputs.size()) * kQueryValues * numFrames;
+}
+
+/// The angles of the whole range go through one batch. Local transforms
+/// read them from a scratch laid out like a whole frame's batch, of which
+/// only the evaluated joints' angles are filled.
+void JointQuery::Evaluate(const Clip &clip, uint32_t begin, uint32_t end,
+                          uint32_t frameBegin, uint32_t numFrames,
+                          float *out) const {
+  static thread_local vector<float> scratch;
+  static thread_local vector<RigidTransform> world;
+  const Skeleton &skeleton = *this->skeleton;
+  const uint32_t numAngles = skeleton.NumAngles();
+  const uint32_t m = angles.size();
+  const size_t size = 2 * (static_cast<size_t>(end - begin) * m + numAngles);
+  if (scratch.size() < max<size_t>(size, 1))
+    scratch.resize(max<size_t>(size, 1));
+  if (world.size() < joints.size())
+    world.resize(joints.size());
+
+  float *s = &scratch[0];
+  float *c = s + (end - begin) * m;
+  float *frameS = c + (end - begin) * m;
+  float *frameC = frameS + numAngles;
+
+  for (uint32_t f = begin; f < end; f++) {
+    const float *frame = clip.Frame(f);
+    float *dst = s + (f - begin) * m;
+    for (uint32_t i = 0; i < m; i++) {
+      int32_t source = skeleton.angleSources[angles[i]];
+      dst[i] = (source >= 0) ? frame[source] :
+          skeleton.angleDefaults[angles[i]];
+    }
+  }
+  SinCosDegrees(s, (end - begin) * m, s, c);
+
+  for (uint32_t f = begin; f < end; f++) {
+    const float *frame = clip.Frame(f);
+    for (uint32_t i = 0; i < m; i++) {
+      frameS[angles[i]] = s[(f - begin) * m + i];
+      frameC[angles[i]] = c[(f - begin) * m + i];
+    }
+
+    for (uint32_t i = 0; i < joints.size(); i++) {
+      RigidTransform local(skeleton.Local(joints[i], frame, frameS, frameC));
+      world[i] = (parents[i] >= 0) ? world[parents[i]] * local : local;
+    }
+
+    size_t column = f - frameBegin;
+    for (uint32_t q = 0; q < outputs.size(); q++) {
+      Matrix4x4 mat = (outputs[q] >= 0) ? world[outputs[q]].Matrix() :
+          Matrix4x4();
+      float *dst = out + q * kQueryValues * static_cast<size_t>(numFrames) +
+          column;
+      for (uint32_t e = 0; e < kQueryValues; e++)
+        dst[e * static_cast<size_t>(numFrames)] = mat.m[e / 4][e % 4];
+    }
+  }
+}
+
+bool JointQuery::Run(const Clip &clip, uint32_t frameBegin,
+                     uint32_t frameEnd, float *out, ThreadPool *pool) const {
+  if (!skeleton || !clip.skeleton.Matches(*skeleton) ||
+      frameBegin > frameEnd || frameEnd > clip.NumFrames())
+    return false;
+
+  const uint32_t numFrames = frameEnd - frameBegin;
+  const uint32_t numTasks =
+      (numFrames + kQueryFramesPerTask - 1) / kQueryFramesPerTask;
+  auto task = [&](uint32_t t) {
+    uint32_t begin = frameBegin + t * kQueryFramesPerTask;
+    uint32_t end = min(begin + kQueryFramesPerTask, frameEnd);
+    Evaluate(clip, begin, end, frameBegin, numFrames, out);
+  };
+
+  if (pool && pool->NumThreads() > 1 && numTasks > 1) {
+    pool->Run(numTasks, task);
+  } else {
+    for (uint32_t t = 0; t < numTasks; t++)
+      task(t);
+  }
+  return true;
+}
+
+bool QueryJointWorld(const Clip &clip, const int32_t *jointIds,
+                     uint32_t count, uint32_t frameBegin, uint32_t frameEnd,
+                     float *out, ThreadPool *pool) {
+  JointQuery query(clip.skeleton, jointIds, count);
+  return query.Run(clip, frameBegin, frameEnd, out, pool);
+}
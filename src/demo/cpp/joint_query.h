@@ -0,0 +1,84 @@
+#ifndef __JOINT_QUERY_H__
+#define __JOINT_QUERY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "./clip.h"
+#include "./skeleton.h"
+#include "./thread_pool.h"
+
+using namespace std;
+
+/// Number of frames evaluated by one task of a query: their angles go
+/// through one batch, and a pool hands out one task at a time
+const uint32_t kQueryFramesPerTask = 64;
+
+/// Number of values written for each queried joint and frame: the top
+/// three rows of its world matrix, row after row
+const uint32_t kQueryValues = 12;
+
+/// A read-only query for the world transforms of a few joints (e.g. feet,
+/// hands and head) over a range of frames.
+///
+/// Only the requested joints and their ancestors are evaluated, each once
+/// per frame however many requested joints share it. Nothing of a playback
+/// instance is touched, so queries may run alongside playback.
+///
+/// Results are written as structure of arrays: value e (0 to 11, row-major
+/// in the top three rows of the world matrix) of queried joint q at frame
+/// f is out[(q * kQueryValues + e) * numFrames + f - frameBegin], so each
+/// coordinate of a joint is contiguous over the frames.
+class JointQuery {
+ private:
+  const Skeleton *skeleton;     // skeleton queried (not owned)
+  vector<uint32_t> joints;      // joints evaluated, in topological order
+  vector<int32_t> parents;      // position in joints of each one's parent
+                                // (-1 for the root)
+  vector<uint32_t> angles;      // batched angle of each angle evaluated
+  vector<int32_t> outputs;      // position in joints of each queried joint
+                                // (-1 for an unknown joint)
+
+  /// Evaluate a range of frames, writing into a buffer for numFrames frames
+  /// starting at frameBegin
+  void Evaluate(const Clip &clip, uint32_t begin, uint32_t end,
+                uint32_t frameBegin, uint32_t numFrames, float *out) const;
+
+ public:
+  /// Initialize a query for no joint
+  JointQuery();
+
+  /// Prepare a query for joints of a skeleton, by index (see
+  /// Skeleton::JointIndex). The skeleton must outlive the query. An index
+  /// of -1 gives identity transforms.
+  JointQuery(const Skeleton &skeleton, const int32_t *jointIds,
+             uint32_t count);
+
+  /// Return the number of joints queried
+  uint32_t NumQueried() const;
+
+  /// Return the number of joints evaluated per frame
+  uint32_t NumEvaluated() const;
+
+  /// Return the number of floats written for a number of frames
+  size_t OutputSize(uint32_t numFrames) const;
+
+  /// Evaluate frames [frameBegin, frameEnd) of a clip with the query's
+  /// skeleton into out, which must hold OutputSize(frameEnd - frameBegin)
+  /// floats. Returns false (writing nothing) if the clip does not share the
+  /// query's skeleton (see Skeleton::Matches) or the range is not within
+  /// the clip. With a pool, ranges of frames are evaluated in parallel; the
+  /// pool must not run other batches meanwhile.
+  bool Run(const Clip &clip, uint32_t frameBegin, uint32_t frameEnd,
+           float *out, ThreadPool *pool = NULL) const;
+};
+
+/// Compute the world transforms of some joints of a clip over a range of
+/// frames (see JointQuery). Returns false if the range is not within the
+/// clip.
+bool QueryJointWorld(const Clip &clip, const int32_t *jointIds,
+                     uint32_t count, uint32_t frameBegin, uint32_t frameEnd,
+                     float *out, ThreadPool *pool = NULL);
+
+#endif
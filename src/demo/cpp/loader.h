@@ -14,6 +14,7 @@ class BVHLoader
     BVHLoader::psg=sg;
     set_bvh_cb_info(&BVHLoader::bci);
     load_bvh(filename);
+    sg->Compile();
   }
   static void createRoot(const char * name, uint32_t id)
   {
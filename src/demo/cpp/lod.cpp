@@ -0,0 +1,19 @@
+#include <cmath>
+
+#include "./lod.h"
+#include "./skeleton.h"
+
+float ProjectedSize(float size, float distance, float fovY,
+                    int viewportHeight) {
+  if (distance <= 0.f)
+    return static_cast<float>(viewportHeight);
+  float halfHeight = distance * tanf(0.5f * fovY * M_PI / 180.f);
+  return 0.5f * size / halfHeight * viewportHeight;
+}
+
+int LodForProjectedSize(float pixels) {
+  int lod = 0;
+  while (lod < kNumLods - 1 && pixels < kLodPixels[lod])
+    lod++;
+  return lod;
+}
@@ -0,0 +1,18 @@
+#ifndef __LOD_H__
+#define __LOD_H__
+
+/// Projected height, in pixels, below which each level of detail is used:
+/// level 1 below the first, level 2 below the second, level 3 below the
+/// last
+const float kLodPixels[3] = {100.f, 40.f, 12.f};
+
+/// Return the height in pixels of an object of a given size seen at a
+/// distance through a perspective projection (fovY in degrees)
+float ProjectedSize(float size, float distance, float fovY,
+                    int viewportHeight);
+
+/// Return the skeletal level of detail for a character covering a number
+/// of pixels on screen
+int LodForProjectedSize(float pixels);
+
+#endif
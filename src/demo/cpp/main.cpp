@@ -22,9 +22,15 @@
 
 #include "./types.h"
 #include "./bvh_defs.h"
+#include "./crowd.h"
 #include "./joint.h"
 #include "./loader.h"
+#include "./lod.h"
 #include "./geom.h"
+#include "./memory.h"
+#include "./pose_cache.h"
+#include "./symbol.h"
+#include "./thread_pool.h"
 
 using namespace std;
 using namespace ishi;
@@ -44,6 +50,8 @@ void Motion(int x, int y);
 void Idle();
 
 void SetLighting();
+void ShowMemory();
+void DrawCrowd();
 
 // Application initialization
 void Init();
@@ -52,6 +60,7 @@ void Init();
 
 vector<SceneGraph> sg;    // Vector of scene graphs
 vector<Color> sgc;        // Vector of scene graph colors
+Crowd *crowd = NULL;      // Extra characters playing the loaded clips
 
 Point eye, center;        // Position of camera, focal point
 Vector up;                // The up direction for the camera
@@ -65,6 +74,8 @@ bool showAxis = true;       // If true, show axis
 bool showBounds = false;    // If true, show bounding box
 bool showFloor = true;      // If true, draw the floor
 bool animate = false;       // If true, animate character
+bool autoLod = false;       // If true, pick each character's skeletal LOD
+                            // from its size on screen
 
 int prevTime;     // The last time (in millisecond) the timer was queried
 
@@ -256,6 +267,30 @@ void DrawBounds() {
   }
 }
 
+/// Draw every member of the crowd as a stick figure
+void DrawCrowd() {
+  glDisable(GL_LIGHTING);
+  glColor3f(0.3f, 0.3f, 0.3f);
+  glBegin(GL_LINES);
+  for (uint32_t i = 0; i < crowd->Size(); i++) {
+    const CrowdMember &m = crowd->Member(i);
+    const Skeleton &skeleton = m.clip->skeleton;
+    const Matrix4x4 *pose = crowd->Pose(i);
+
+    for (uint32_t j = 1; j < skeleton.NumJoints(); j++) {
+      if (skeleton.lods[j] < m.lod) {
+        j = skeleton.subtreeEnd[j] - 1;
+        continue;
+      }
+      const Matrix4x4 &a = pose[skeleton.parents[j]], &b = pose[j];
+      glVertex3f(a.m[0][3], a.m[1][3], a.m[2][3]);
+      glVertex3f(b.m[0][3], b.m[1][3], b.m[2][3]);
+    }
+  }
+  glEnd();
+  glEnable(GL_LIGHTING);
+}
+
 void Display() {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -270,6 +305,7 @@ void Display() {
   if (showAxis) DrawAxis();
   if (showBounds) DrawBounds();
   if (showFloor) DrawFloor(800, 800, 80, 80);
+  if (crowd) DrawCrowd();
 
   // Render scene graph
   for (unsigned int i = 0; i < sg.size(); i++) {
@@ -336,6 +372,11 @@ void Keyboard(unsigned char key, int x, int y) {
     showBounds = !showBounds;
   } else if (key =='f') {
     showFloor = !showFloor;
+  } else if (key =='m') {
+    ShowMemory();
+  } else if (key =='l') {
+    autoLod = !autoLod;
+    printf("Automatic level of detail %s\n", autoLod ? "on" : "off");
   } else if (key =='q' || key ==27 /* esc */) {
     exit(0);
   }
@@ -399,17 +440,41 @@ void Motion(int x, int y) {
 
 /// Called whenever the program is not busy doing something else
 void Idle() {
-  // Calculate elapsed frames since last tick
+  // Calculate the time elapsed since last tick
   int currentTime = glutGet(GLUT_ELAPSED_TIME);
-  int frameDelta;
+  double delta = (currentTime - prevTime) / 1000.0;
 
   for (unsigned int i = 0; i < sg.size(); i++) {
-    frameDelta = (currentTime - prevTime) * sg[i].FramePerMs();
 
-    if (animate && frameDelta > 0)
-      // If animating and enough time has passed:
-      // raise frame index && update position for all joints
-      sg[i].SetCurrentFrame((sg[i].GetCurrentFrame() + frameDelta));
+    // Characters far from the camera only evaluate their larger joints
+    if (autoLod) {
+      float size = 2 * sg[i].clip->skeleton.extents[0];
+      float pixels = ProjectedSize(size, Distance(eye, sg[i].root->basepoint),
+                                   40.f, window_height);
+      sg[i].instance.SetLod(LodForProjectedSize(pixels));
+    } else {
+      sg[i].instance.SetLod(0);
+    }
+
+    if (animate && delta > 0)
+      // If animating, advance the time and update all joints, interpolating
+      // between frames so playback is smooth at any display rate (cached
+      // and coarse characters play whole frames)
+      sg[i].SampleAtTime(sg[i].GetTime() + delta);
+  }
+
+  if (crowd) {
+    // Members small on screen or behind the camera are updated less often
+    for (uint32_t i = 0; i < crowd->Size(); i++) {
+      const CrowdMember &m = crowd->Member(i);
+      Point root(m.root.m[0][3], m.root.m[1][3], m.root.m[2][3]);
+      float pixels = ProjectedSize(2 * m.clip->skeleton.extents[0],
+                                   Distance(eye, root), 40.f, window_height);
+      bool visible = Dot(center - eye, root - eye) > 0;
+      crowd->SetPriority(i, visible ? pixels / kLodPixels[0] : 0.f);
+      crowd->SetLod(i, autoLod ? LodForProjectedSize(pixels) : 0);
+    }
+    crowd->Update(animate ? currentTime - prevTime : 0);
   }
 
   // Save tick time
@@ -419,14 +484,61 @@ void Idle() {
   glutPostRedisplay();
 }
 
+/// Print the memory used by every loaded clip, and in total
+void ShowMemory() {
+  MemoryUsage total;
+  char label[64];
+
+  for (unsigned int i = 0; i < sg.size(); i++) {
+    MemoryUsage m = sg[i].Memory();
+    snprintf(label, sizeof(label), "Scene graph %u", i);
+    PrintMemoryUsage(label, m);
+    total += m;
+  }
+  PrintMemoryUsage("All scene graphs", total);
+  printf("Symbol table: %.1f KB\n",
+         SymbolTable::Shared().MemoryBytes() / 1024.0);
+}
+
 void processCommandLine(int argc, char *argv[]) {
+  bool cachePoses = false;  // If true, play from baked pose caches
+  bool foldStatic = false;  // If true, fold static channels out of frames
+  uint32_t crowdSize = 0;   // Number of extra characters to play
+  UpdateBudget budget;      // Limit on crowd updates per tick
+
   if (argc>1) {
     for (int i = 1; i < argc; i++) {
       char filename[500];
+
+      if (strcmp(argv[i], "--cache") == 0) {
+        cachePoses = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--fold") == 0) {
+        foldStatic = true;
+        continue;
+      }
+      if (strcmp(argv[i], "--crowd") == 0 && i + 1 < argc) {
+        crowdSize = atoi(argv[++i]);
+        continue;
+      }
+      if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+        budget.maxMs = atof(argv[++i]);
+        continue;
+      }
+
       SceneGraph *s = new SceneGraph;
+      if (foldStatic)
+        s->staticEpsilon = 0.f;
 
       snprintf(&(filename[0]), strlen(argv[i])+1, "%s", argv[i]);
       BVHLoader::loadBVH(filename, s);
+      if (cachePoses) {
+        ThreadPool pool;
+        s->SetPoseCache(PoseCache::Load(filename, *s->clip, POSE_MATRICES,
+                                        &pool));
+      }
+      PrintMemoryUsage(filename, s->Memory());
       sg.push_back(*s);
 
       float r = static_cast<float>((i + 15) % 3) / 3;
@@ -439,6 +551,23 @@ void processCommandLine(int argc, char *argv[]) {
     printf("Filename argument required.\n");
     exit(0);
   }
+
+  // Lay the crowd out on a grid, cycling through the loaded clips
+  if (crowdSize > 0 && !sg.empty()) {
+    int side = static_cast<int>(sqrt(crowdSize)) + 1;
+    crowd = new Crowd;
+    crowd->SetBudget(budget);
+    for (uint32_t i = 0; i < crowdSize; i++) {
+      const ClipPtr &clip = sg[i % sg.size()].clip;
+      float spacing = 2 * clip->skeleton.extents[0];
+      Matrix4x4 root;
+      root.m[0][3] = spacing * (static_cast<int>(i) % side - side / 2);
+      root.m[2][3] = spacing * (static_cast<int>(i) / side - side / 2);
+      crowd->Add(clip, clip->NumFrames() * clip->MsPerFrame() * i / crowdSize,
+                 1.f, root);
+    }
+    crowd->Evaluate();
+  }
 }
 
 void showMenu() {
@@ -447,6 +576,8 @@ void showMenu() {
   cout << "a - show/hide axis" << endl;
   cout << "b - show/hide bounds" << endl;
   cout << "f - show/hide floor" << endl;
+  cout << "m - print memory usage" << endl;
+  cout << "l - toggle automatic level of detail" << endl;
   cout << "[1-3] - move to waypoint" << endl;
   cout << "z - zoom in" << endl;
   cout << "Z - zoom out" << endl;
@@ -454,6 +585,9 @@ void showMenu() {
   cout << "k - rotate right" << endl;
   cout << "[MOUSE WHEEL] - zoom in/out" << endl;
   cout << "[SPACE] - start/stop" << endl;
+  cout << "(--crowd N plays N extra characters, --budget MS limits their"
+       << " updates per tick, --cache bakes poses, --fold drops static"
+       << " channels)" << endl;
 }
 
 int main(int argc, char *argv[]) {
@@ -0,0 +1,28 @@
+#include <stddef.h>
+#include <cstdio>
+
+#include "./memory.h"
+
+MemoryUsage::MemoryUsage()
+    : skeleton(0), frames(0), caches(0), render(0) {}
+
+size_t MemoryUsage::Total() const {
+  return skeleton + frames + caches + render;
+}
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &m) {
+  skeleton += m.skeleton;
+  frames += m.frames;
+  caches += m.caches;
+  render += m.render;
+  return *this;
+}
+
+void PrintMemoryUsage(const char *label, const MemoryUsage &m) {
+  const double kb = 1.0 / 1024;
+  printf("%s: %.1f KB\n", label, m.Total() * kb);
+  printf("  skeleton %10.1f KB\n", m.skeleton * kb);
+  printf("  frames   %10.1f KB\n", m.frames * kb);
+  printf("  caches   %10.1f KB\n", m.caches * kb);
+  printf("  render   %10.1f KB\n", m.render * kb);
+}
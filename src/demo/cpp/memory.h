@@ -0,0 +1,61 @@
+#ifndef __MEMORY_H__
+#define __MEMORY_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// Estimated bookkeeping cost of one heap allocation (allocator header and
+/// alignment padding)
+const size_t kHeapOverhead = 2 * sizeof(void*);
+
+/// Bytes used by one object, broken down by subsystem
+struct MemoryUsage {
+  size_t skeleton;    // hierarchy, names, offsets and channel layout
+  size_t frames;      // motion data, including container overhead
+  size_t caches;      // evaluated poses and other derived data
+  size_t render;      // per-segment state read by the renderer
+
+  /// Initialize all counts to zero
+  MemoryUsage();
+
+  /// Return the sum of all subsystems
+  size_t Total() const;
+
+  /// Add another breakdown to this one
+  MemoryUsage &operator+=(const MemoryUsage &m);
+};
+
+/// Return the heap bytes owned by a vector (excluding the vector itself)
+template <class T>
+size_t HeapBytes(const vector<T> &v) {
+  return v.capacity() ? v.capacity() * sizeof(T) + kHeapOverhead : 0;
+}
+
+/// Return the heap bytes owned by a vector of vectors, including the
+/// header of every inner vector
+template <class T>
+size_t HeapBytes(const vector<vector<T> > &v) {
+  size_t bytes = v.capacity() ? v.capacity() * sizeof(vector<T>) +
+      kHeapOverhead : 0;
+  for (unsigned int i = 0; i < v.size(); i++)
+    bytes += HeapBytes(v[i]);
+  return bytes;
+}
+
+/// Return the heap bytes owned by a string (0 if its characters are kept
+/// inside the string object itself, as short strings are)
+inline size_t HeapBytes(const string &s) {
+  const char *data = s.data();
+  const char *object = reinterpret_cast<const char *>(&s);
+  if (data >= object && data < object + sizeof(string))
+    return 0;
+  return s.capacity() + 1 + kHeapOverhead;
+}
+
+/// Print a breakdown, one subsystem per line
+void PrintMemoryUsage(const char *label, const MemoryUsage &m);
+
+#endif
@@ -0,0 +1,140 @@
+#include <core/sincos.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "./memory.h"
+#include "./parallel_eval.h"
+#include "./skeleton.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Orders tasks so the largest are handed out first
+static bool LargerTask(const SubtreeTask &a, const SubtreeTask &b) {
+  return a.end - a.begin > b.end - b.begin;
+}
+
+ParallelEvaluator::ParallelEvaluator() : skeleton(NULL), pool(NULL) {}
+
+ParallelEvaluator::ParallelEvaluator(const Skeleton &skeleton,
+                                     ThreadPool *pool, uint32_t minJoints)
+    : skeleton(&skeleton), pool(pool) {
+  const uint32_t n = skeleton.NumJoints();
+  if (!pool || pool->NumThreads() <= 1 || n < minJoints)
+    return;
+
+  uint32_t numTasks = pool->NumThreads() * kTasksPerThread;
+  uint32_t grain = (n + numTasks - 1) / numTasks;
+  for (uint32_t j = 0; j < n; j = skeleton.subtreeEnd[j])
+    Split(j, grain);
+
+  // Angles are batched in joint order, so a range's angles are contiguous
+  for (uint32_t t = 0; t < tasks.size(); t++) {
+    SubtreeTask &task = tasks[t];
+    task.firstAngle = task.endAngle = 0;
+    for (uint32_t j = task.begin; j < task.end; j++) {
+      int32_t first = skeleton.channels[j].angles;
+      if (first < 0)
+        continue;
+      if (task.endAngle == 0)
+        task.firstAngle = first;
+      task.endAngle = first + 3;
+    }
+  }
+  sort(tasks.begin(), tasks.end(), LargerTask);
+
+  // A hierarchy that is one long chain leaves nothing to share
+  if (tasks.size() < 2) {
+    trunk.clear();
+    tasks.clear();
+  }
+}
+
+/// Sibling subtrees that follow each other are merged into one task while
+/// they fit in the grain, so a joint with many small children (fingers,
+/// feathers) does not become many tiny tasks.
+void ParallelEvaluator::Split(uint32_t joint, uint32_t grain) {
+  uint32_t end = skeleton->subtreeEnd[joint];
+  if (end - joint <= grain) {
+    if (!tasks.empty() && tasks.back().end == joint &&
+        end - tasks.back().begin <= grain) {
+      tasks.back().end = end;
+    } else {
+      SubtreeTask task = {joint, end, 0, 0};
+      tasks.push_back(task);
+    }
+    return;
+  }
+
+  trunk.push_back(joint);
+  for (uint32_t child = joint + 1; child < end;
+       child = skeleton->subtreeEnd[child])
+    Split(child, grain);
+}
+
+bool ParallelEvaluator::IsParallel() const {
+  return !tasks.empty();
+}
+
+uint32_t ParallelEvaluator::NumTrunkJoints() const {
+  return trunk.size();
+}
+
+uint32_t ParallelEvaluator::NumTasks() const {
+  return tasks.size();
+}
+
+void ParallelEvaluator::Evaluate(const float *frame, Transform *world) const {
+  if (tasks.empty()) {
+    skeleton->Evaluate(frame, world);
+    return;
+  }
+
+  // The trunk is a small part of the skeleton, so its angles are not
+  // batched
+  for (uint32_t i = 0; i < trunk.size(); i++) {
+    uint32_t j = trunk[i];
+    int32_t parent = skeleton->parents[j];
+    if (parent >= 0)
+      world[j] = world[parent] * skeleton->Local(j, frame);
+    else
+      world[j] = skeleton->Local(j, frame);
+  }
+
+  const Skeleton &skeleton = *this->skeleton;
+  const vector<SubtreeTask> &tasks = this->tasks;
+  pool->Run(tasks.size(), [&](uint32_t t) {
+    // Per-thread scratch laid out like a whole frame's batch, of which
+    // each task fills only its own angles
+    static thread_local vector<float> scratch;
+    const uint32_t numAngles = skeleton.NumAngles();
+    if (scratch.size() < 2 * numAngles)
+      scratch.resize(2 * numAngles);
+    float *s = &scratch[0];
+    float *c = &scratch[numAngles];
+
+    const SubtreeTask &task = tasks[t];
+    for (uint32_t i = task.firstAngle; i < task.endAngle; i++)
+      s[i] = (skeleton.angleSources[i] >= 0) ?
+          frame[skeleton.angleSources[i]] : skeleton.angleDefaults[i];
+    if (task.endAngle > task.firstAngle)
+      SinCosDegrees(s + task.firstAngle, task.endAngle - task.firstAngle,
+                    s + task.firstAngle, c + task.firstAngle);
+
+    // Roots of the range have their parent in the trunk; every other
+    // joint's parent comes earlier in the range
+    for (uint32_t j = task.begin; j < task.end; j++)
+      world[j] = world[skeleton.parents[j]] * skeleton.Local(j, frame, s, c);
+  });
+}
+
+MemoryUsage ParallelEvaluator::Memory() const {
+  MemoryUsage m;
+  m.caches = sizeof(*this) + HeapBytes(trunk) + HeapBytes(tasks);
+  return m;
+}
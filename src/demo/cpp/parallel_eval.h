@@ -0,0 +1,79 @@
+#ifndef __PARALLEL_EVAL_H__
+#define __PARALLEL_EVAL_H__
+
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <vector>
+
+#include "./memory.h"
+#include "./skeleton.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Skeletons with fewer joints than this are evaluated serially: a pass
+/// over them takes about as long as waking the pool
+const uint32_t kMinParallelJoints = 256;
+
+/// Number of tasks aimed for per thread, so uneven subtrees still balance
+const uint32_t kTasksPerThread = 4;
+
+/// A range of joints evaluated by one task: one or more whole sibling
+/// subtrees, contiguous in the joint order
+struct SubtreeTask {
+  uint32_t begin;             // first joint of the range
+  uint32_t end;               // one past the last joint of the range
+  uint32_t firstAngle;        // first batched angle of the range
+  uint32_t endAngle;          // one past the last batched angle
+};
+
+/// Forward kinematics of a large skeleton split across a thread pool.
+///
+/// The hierarchy is split once into a trunk and independent subtrees. A
+/// subtree small enough for one task becomes a task; a larger one leaves its
+/// root in the trunk and is split among its children. Every pass evaluates
+/// the trunk (the shared ancestors) serially, then runs the tasks on the
+/// pool, each computing the sines and cosines of its own angles. A long
+/// unbranched chain cannot be split, so it stays in the trunk.
+///
+/// Small skeletons, and pools of one thread, use Skeleton::Evaluate.
+class ParallelEvaluator {
+ private:
+  const Skeleton *skeleton;   // skeleton evaluated (not owned)
+  ThreadPool *pool;           // pool the tasks run on (not owned)
+  vector<uint32_t> trunk;     // joints evaluated before the tasks, in order
+  vector<SubtreeTask> tasks;  // subtrees evaluated in parallel, largest first
+
+  /// Assign a joint's subtree to the trunk or to tasks of at most grain
+  /// joints
+  void Split(uint32_t joint, uint32_t grain);
+
+ public:
+  /// Initialize an evaluator without a skeleton
+  ParallelEvaluator();
+
+  /// Split a skeleton into tasks for a pool. Both must outlive the
+  /// evaluator. Skeletons below minJoints are not split.
+  ParallelEvaluator(const Skeleton &skeleton, ThreadPool *pool,
+                    uint32_t minJoints = kMinParallelJoints);
+
+  /// Return true if passes run on the pool rather than serially
+  bool IsParallel() const;
+
+  /// Return the number of joints evaluated before the tasks
+  uint32_t NumTrunkJoints() const;
+
+  /// Return the number of tasks of each pass
+  uint32_t NumTasks() const;
+
+  /// Compute the world transform of every joint for a frame.
+  /// The output array must hold NumJoints() transforms.
+  void Evaluate(const float *frame, Transform *world) const;
+
+  /// Return the bytes used by the split (caches)
+  MemoryUsage Memory() const;
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "./clip.h"
+#include "./clip_view.h"
+#include "./memory.h"
+#include "./parallel_eval.h"
+#include "./playback.h"
+#include "./pose_cache.h"
+#include "./skeleton.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+EvaluationStats::EvaluationStats()
+    : poses(0), joints(0), localsReused(0), skipped(0) {}
+
+double EvaluationStats::LocalReusedFraction() const {
+  return joints ? static_cast<double>(localsReused) / joints : 0.0;
+}
+
+double EvaluationStats::SkippedFraction() const {
+  return joints ? static_cast<double>(skipped) / joints : 0.0;
+}
+
+IncrementalState::IncrementalState(uint32_t numJoints)
+    : evaluated(NULL), local(numJoints), changed(numJoints) {}
+
+PlaybackInstance::PlaybackInstance()
+    : view(NULL), currentFrame(0), time(0.0), pose(NULL), lod(0),
+      pool(NULL) {}
+
+PlaybackInstance::PlaybackInstance(const ClipPtr &clip)
+    : view(NULL), currentFrame(0), time(0.0), pose(NULL), lod(0),
+      pool(NULL) {
+  SetClip(clip);
+}
+
+PlaybackInstance::PlaybackInstance(const PlaybackInstance &other)
+    : view(NULL), currentFrame(0), time(0.0), pose(NULL), lod(0),
+      pool(NULL) {
+  *this = other;
+}
+
+PlaybackInstance &PlaybackInstance::operator=(
+    const PlaybackInstance &other) {
+  clip = other.clip;
+  view = other.view;
+  currentFrame = other.currentFrame;
+  time = other.time;
+  poses = other.poses;
+  pose = other.pose;
+  lod = other.lod;
+  pool = other.pool;
+  parallel.reset(other.parallel ?
+                 new ParallelEvaluator(*other.parallel) : NULL);
+  incremental.reset(other.incremental ?
+                    new IncrementalState(*other.incremental) : NULL);
+  world = other.world;
+  return *this;
+}
+
+void PlaybackInstance::SetClip(const ClipPtr &clip) {
+  this->clip = clip;
+  this->view = NULL;
+  this->currentFrame = 0;
+  this->time = 0.0;
+  this->poses = PoseCachePtr();
+  this->pose = NULL;
+  world = vector<Transform>(clip ? clip->skeleton.NumJoints() : 0);
+  if (incremental)
+    incremental.reset(new IncrementalState(world.size()));
+  SplitForPool();
+}
+
+const ClipPtr &PlaybackInstance::GetClip() const {
+  return clip;
+}
+
+bool PlaybackInstance::Play(const ClipView *view) {
+  if (view && !view->Ranges().empty() &&
+      (!clip || !clip->skeleton.Matches(view->Ranges()[0].source->skeleton)))
+    return false;
+
+  this->view = view;
+  this->currentFrame = 0;
+  this->time = 0.0;
+  this->pose = NULL;
+  if (incremental)
+    incremental->evaluated = NULL;
+  return true;
+}
+
+bool PlaybackInstance::SetPoseCache(const PoseCachePtr &cache) {
+  pose = NULL;
+  if (cache && (!clip || cache->Contents() != POSE_MATRICES ||
+                cache->NumFrames() != clip->NumFrames() ||
+                cache->NumJoints() != clip->skeleton.NumJoints())) {
+    poses = PoseCachePtr();
+    return false;
+  }
+  poses = cache;
+  return true;
+}
+
+const PoseCachePtr &PlaybackInstance::GetPoseCache() const {
+  return poses;
+}
+
+void PlaybackInstance::SetCurrentFrame(uint32_t frameNumber) {
+  uint32_t count = NumFrames();
+  if (count == 0)
+    return;
+
+  // Frame should loop around if the number of frames is exceeded
+  while (frameNumber >= count)
+    frameNumber -= count;
+  this->currentFrame = frameNumber;
+  this->time = frameNumber * (clip->MsPerFrame() / 1000.0);
+
+  // Views may mix clips, so only the clip's own frames use the cache
+  if (poses && !view) {
+    pose = poses->Matrices(frameNumber);
+    if (incremental)
+      incremental->evaluated = NULL;
+    return;
+  }
+  pose = NULL;
+
+  const float *frame = view ? view->Frame(frameNumber) :
+      clip->Frame(frameNumber);
+  uint32_t numJoints = world.size();
+
+  // Frames are immutable, so the last evaluated frame can be compared
+  // against in place. The first incremental update computes everything.
+  if (lod > 0) {
+    clip->skeleton.Evaluate(frame, lod, &world[0]);
+    numJoints = clip->skeleton.NumJointsAtLod(lod);
+  } else if (incremental) {
+    IncrementalState &state = *incremental;
+    ChangeCounts counts = clip->skeleton.EvaluateChanged(
+        frame, state.evaluated, &state.local[0], &world[0],
+        &state.changed[0]);
+    if (state.evaluated) {
+      state.stats.localsReused += numJoints - counts.locals;
+      state.stats.skipped += numJoints - counts.worlds;
+    }
+  } else if (parallel) {
+    // Split the pass over the flattened skeleton across the pool
+    parallel->Evaluate(frame, &world[0]);
+  } else if (!view && clip->Rotations(frameNumber)) {
+    // Stored rotations leave only the matrix assembly and products
+    clip->skeleton.Evaluate(frame, clip->Rotations(frameNumber), &world[0]);
+  } else {
+    // Evaluate all joints in one pass over the flattened skeleton
+    clip->skeleton.Evaluate(frame, &world[0]);
+  }
+  if (incremental) {
+    incremental->stats.poses++;
+    incremental->stats.joints += numJoints;
+    incremental->evaluated = (lod <= 0) ? frame : NULL;
+  }
+}
+
+void PlaybackInstance::SampleAtTime(double seconds) {
+  uint32_t count = NumFrames();
+  if (count == 0)
+    return;
+
+  double frames = fmod(seconds * 1000.0 / clip->MsPerFrame(), count);
+  if (frames < 0.0)
+    frames += count;
+  uint32_t frameNumber = static_cast<uint32_t>(frames);
+  float t = static_cast<float>(frames - frameNumber);
+
+  // Cached, coarse, incremental and split evaluations only exist for whole
+  // frames, so those modes play the nearest frame. The time keeps its
+  // fraction so small steps still add up to the next frame.
+  bool whole = (poses && !view) || lod > 0 || incremental || parallel;
+  if (frameNumber >= count || t <= 0.f || whole) {
+    if (whole && t >= 0.5f)
+      frameNumber++;
+    SetCurrentFrame(frameNumber);
+    this->time = frames * (clip->MsPerFrame() / 1000.0);
+    return;
+  }
+  this->currentFrame = frameNumber;
+  this->time = frames * (clip->MsPerFrame() / 1000.0);
+  pose = NULL;
+
+  // The last frame blends back into the first, as playback loops, but only
+  // in its rotations: positions hold until the clip starts over
+  uint32_t nextFrame = (frameNumber + 1 < count) ? frameNumber + 1 : 0;
+  bool seam = (nextFrame == 0);
+  if (view) {
+    clip->skeleton.Sample(view->Frame(frameNumber), NULL,
+                          view->Frame(nextFrame), NULL, t, seam, &world[0]);
+  } else {
+    clip->skeleton.Sample(clip->Frame(frameNumber),
+                          clip->Rotations(frameNumber),
+                          clip->Frame(nextFrame), clip->Rotations(nextFrame),
+                          t, seam, &world[0]);
+  }
+}
+
+double PlaybackInstance::GetTime() const {
+  return time;
+}
+
+void PlaybackInstance::SetIncremental(bool enable) {
+  if (!enable)
+    incremental.reset();
+  else if (!incremental)
+    incremental.reset(new IncrementalState(world.size()));
+}
+
+void PlaybackInstance::SetLod(int lod) {
+  if (lod < 0)
+    lod = 0;
+  else if (lod >= kNumLods)
+    lod = kNumLods - 1;
+  if (lod != this->lod && incremental)
+    incremental->evaluated = NULL;
+  this->lod = lod;
+}
+
+void PlaybackInstance::SetThreadPool(ThreadPool *pool) {
+  this->pool = pool;
+  SplitForPool();
+}
+
+void PlaybackInstance::SplitForPool() {
+  parallel.reset();
+  if (!clip || !pool)
+    return;
+  parallel.reset(new ParallelEvaluator(clip->skeleton, pool));
+  if (!parallel->IsParallel())
+    parallel.reset();
+}
+
+int PlaybackInstance::GetLod() const {
+  return lod;
+}
+
+const EvaluationStats &PlaybackInstance::Stats() const {
+  static const EvaluationStats none;
+  return incremental ? incremental->stats : none;
+}
+
+void PlaybackInstance::ResetStats() {
+  if (incremental)
+    incremental->stats = EvaluationStats();
+}
+
+const Matrix4x4 *PlaybackInstance::CachedPose() const {
+  return pose;
+}
+
+uint32_t PlaybackInstance::GetCurrentFrame() const {
+  return currentFrame;
+}
+
+uint32_t PlaybackInstance::NumFrames() const {
+  if (view)
+    return view->NumFrames();
+  return clip ? clip->NumFrames() : 0;
+}
+
+MemoryUsage PlaybackInstance::Memory() const {
+  MemoryUsage m;
+  m.caches = sizeof(*this) + HeapBytes(world);
+  if (incremental)
+    m.caches += sizeof(IncrementalState) + HeapBytes(incremental->local) +
+        HeapBytes(incremental->changed);
+  if (parallel)
+    m += parallel->Memory();
+  return m;
+}
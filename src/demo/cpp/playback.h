@@ -0,0 +1,176 @@
+#ifndef __PLAYBACK_H__
+#define __PLAYBACK_H__
+
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "./clip.h"
+#include "./clip_view.h"
+#include "./memory.h"
+#include "./parallel_eval.h"
+#include "./pose_cache.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Counts of joints evaluated and skipped by incremental updates
+struct EvaluationStats {
+  uint64_t poses;             // number of poses evaluated
+  uint64_t joints;            // number of joints in all those poses
+  uint64_t localsReused;      // joints whose channels had not changed
+  uint64_t skipped;           // joints whose world transform was reused
+
+  /// Initialize all counts to zero
+  EvaluationStats();
+
+  /// Return the fraction of joints whose local transform was reused
+  double LocalReusedFraction() const;
+
+  /// Return the fraction of joints whose world transform was reused
+  double SkippedFraction() const;
+};
+
+/// Local transforms and bookkeeping kept between incremental updates
+struct IncrementalState {
+  const float *evaluated;     // frame world was evaluated for (or NULL)
+  vector<Transform> local;    // local transforms of the evaluated frame
+  vector<uint8_t> changed;    // joints recomputed by the last update
+  EvaluationStats stats;      // savings of incremental updates
+
+  /// Initialize the state of a skeleton with nothing evaluated yet
+  explicit IncrementalState(uint32_t numJoints);
+};
+
+/// The mutable state of one character playing a clip: where it is in time,
+/// and the pose that was evaluated there.
+///
+/// Instances only read their clip, so many of them can share one clip.
+/// A single instance must not be used from several threads at once. The
+/// state of incremental updates and the split of the skeleton for a thread
+/// pool are only allocated once they are enabled.
+class PlaybackInstance {
+ private:
+  ClipPtr clip;               // motion being played
+  const ClipView *view;       // frames to play instead of the clip's own
+  uint32_t currentFrame;      // index of the motion frame this is at
+  double time;                // time of the pose, in seconds from the
+                              // first frame
+  PoseCachePtr poses;         // baked world matrices of the clip, if any
+  const Matrix4x4 *pose;      // cached pose of the current frame, if any
+
+  int lod;                    // level of detail evaluated at
+  ThreadPool *pool;           // pool full passes are split across (or NULL)
+  unique_ptr<ParallelEvaluator> parallel;    // split of the clip's skeleton
+                                             // (NULL if not split)
+  unique_ptr<IncrementalState> incremental;  // state of incremental
+                                             // updates (NULL if disabled)
+
+  /// Split the clip's skeleton for the pool, or drop the split if there is
+  /// no pool or the skeleton is too small to gain from one
+  void SplitForPool();
+
+ public:
+  vector<Transform> world;    // world transform of each skeleton joint,
+                              // when the pose was evaluated (not cached)
+
+ public:
+  /// Initialize an instance that is not playing anything
+  PlaybackInstance();
+
+  /// Initialize an instance playing a clip
+  explicit PlaybackInstance(const ClipPtr &clip);
+
+  /// Initialize a copy of an instance, including its incremental state and
+  /// thread pool
+  PlaybackInstance(const PlaybackInstance &other);
+
+  /// Copy an instance, including its incremental state and thread pool
+  PlaybackInstance &operator=(const PlaybackInstance &other);
+
+  /// Start playing a clip from its first frame
+  void SetClip(const ClipPtr &clip);
+
+  /// Return the clip being played
+  const ClipPtr &GetClip() const;
+
+  /// Play the frames of a view instead of the clip's own frames.
+  /// Return false (and keep playing what was played before) if the view
+  /// does not share the clip's skeleton. Pass NULL to go back to the clip's
+  /// frames.
+  bool Play(const ClipView *view);
+
+  /// Read poses from a cache of world matrices baked from the clip instead
+  /// of evaluating them. Returns false (and keeps evaluating) if the cache
+  /// has no matrices or does not fit the clip. Pass NULL to stop using one.
+  bool SetPoseCache(const PoseCachePtr &cache);
+
+  /// Return the pose cache in use, if any
+  const PoseCachePtr &GetPoseCache() const;
+
+  /// Evaluate the pose at a frame, wrapping around past the last frame.
+  /// With a pose cache (and no view) this only looks the pose up; a clip
+  /// that stores its rotations is evaluated from them.
+  void SetCurrentFrame(uint32_t frameNumber);
+
+  /// Evaluate the pose at a time in seconds from the first frame, wrapping
+  /// around past the end. Between two frames, positions are interpolated
+  /// linearly and rotations by slerp; between the last frame and the first,
+  /// positions hold. With a pose cache, a coarse level of detail,
+  /// incremental updates or a thread pool, which only evaluate whole
+  /// frames, the nearest frame is played instead.
+  void SampleAtTime(double seconds);
+
+  /// Return the time of the pose, in seconds from the first frame
+  double GetTime() const;
+
+  /// Enable or disable incremental updates (disabled by default). When
+  /// enabled, a joint's local transform is only recomputed if its channel
+  /// values differ from the previously evaluated frame, and its world
+  /// transform only if its local transform or an ancestor changed.
+  /// This pays off for held poses (about 2.5 times faster on a take holding
+  /// each pose for four frames). It does not pay off on moving takes: a
+  /// root that moves every frame dirties every world transform, and the
+  /// comparisons then cost more than they save.
+  void SetIncremental(bool enable);
+
+  /// Evaluate only the joints kept at a level of detail (0, the default,
+  /// evaluates every joint). The world transforms of dropped joints keep
+  /// whatever they held before. Coarse levels take precedence over
+  /// incremental updates, but not over a pose cache.
+  void SetLod(int lod);
+
+  /// Split full evaluations of large skeletons across a pool (see
+  /// ParallelEvaluator). The pool must outlive the instance, and must not
+  /// run other batches while the instance evaluates. Pass NULL to evaluate
+  /// serially again.
+  void SetThreadPool(ThreadPool *pool);
+
+  /// Return the level of detail evaluated at
+  int GetLod() const;
+
+  /// Return the counts of joints evaluated and skipped by incremental
+  /// updates since they were enabled (all zero while they are disabled)
+  const EvaluationStats &Stats() const;
+
+  /// Reset the counts of joints evaluated and skipped
+  void ResetStats();
+
+  /// Return the world matrix of every joint at the current frame if it came
+  /// from the pose cache, or NULL if it was evaluated into world
+  const Matrix4x4 *CachedPose() const;
+
+  /// Return the current frame index
+  uint32_t GetCurrentFrame() const;
+
+  /// Return the number of frames being played
+  uint32_t NumFrames() const;
+
+  /// Return the bytes used by the instance (pose output only)
+  MemoryUsage Memory() const;
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include <core/matrix.h>
+#include <core/point.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdint.h>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "./batch.h"
+#include "./clip.h"
+#include "./memory.h"
+#include "./pose_cache.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+// Identifies a pose cache file, and the version of its layout
+static const char kMagic[8] = {'I', 'S', 'H', 'I', 'P', 'O', 'S', 'E'};
+static const uint32_t kVersion = 1;
+
+// Frames baked by one pool task
+static const uint32_t kBakeFramesPerTask = 64;
+
+/// Header at the start of a cache file. It is padded to 64 bytes so the
+/// poses that follow stay aligned in the mapping.
+struct PoseFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t contents;
+  uint32_t numFrames;
+  uint32_t numJoints;
+  uint64_t fingerprint;
+  uint8_t padding[32];
+};
+
+/// FNV-1a over a block of bytes, continuing from a previous hash
+static uint64_t HashBytes(uint64_t hash, const void *bytes, size_t size) {
+  const uint8_t *p = static_cast<const uint8_t*>(bytes);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= p[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+/// Return the bytes used by one joint of one frame
+static size_t PoseBytes(PoseContents contents) {
+  return contents == POSE_MATRICES ? sizeof(Matrix4x4) : sizeof(Point);
+}
+
+PoseCache::PoseCache()
+    : contents(POSE_MATRICES), numFrames(0), numJoints(0), fingerprint(0),
+      mapping(NULL), mappingSize(0), data(NULL) {}
+
+PoseCache::~PoseCache() {
+  if (mapping)
+    munmap(mapping, mappingSize);
+}
+
+/// Frames are split into ranges of kBakeFramesPerTask, and every range goes
+/// through the SIMD multi-frame evaluator straight into the cache.
+PoseCachePtr PoseCache::Bake(const Clip &clip, PoseContents contents,
+                             ThreadPool *pool) {
+  PoseCache *cache = new PoseCache;
+  cache->contents = contents;
+  cache->numFrames = clip.NumFrames();
+  cache->numJoints = clip.skeleton.NumJoints();
+  cache->fingerprint = Fingerprint(clip);
+
+  size_t count = static_cast<size_t>(cache->numFrames) * cache->numJoints;
+  if (contents == POSE_MATRICES) {
+    cache->matrices.resize(count);
+    cache->data = count ? &cache->matrices[0] : NULL;
+  } else {
+    cache->positions.resize(count);
+    cache->data = count ? &cache->positions[0] : NULL;
+  }
+
+  const uint32_t numTasks =
+      (cache->numFrames + kBakeFramesPerTask - 1) / kBakeFramesPerTask;
+  auto task = [&](uint32_t t) {
+    uint32_t begin = t * kBakeFramesPerTask;
+    uint32_t end = min(begin + kBakeFramesPerTask, cache->numFrames);
+    size_t first = static_cast<size_t>(begin) * cache->numJoints;
+    Point *p = (contents == POSE_POSITIONS) ?
+        &cache->positions[first] : NULL;
+    Matrix4x4 *m = (contents == POSE_MATRICES) ?
+        &cache->matrices[first] : NULL;
+    EvaluateFrames(clip.skeleton, clip.Frame(begin), end - begin, p, m);
+  };
+
+  if (pool && pool->NumThreads() > 1 && numTasks > 1) {
+    pool->Run(numTasks, task);
+  } else {
+    for (uint32_t t = 0; t < numTasks; t++)
+      task(t);
+  }
+  return PoseCachePtr(cache);
+}
+
+PoseCachePtr PoseCache::Open(const string &path, const Clip &clip,
+                             PoseContents contents) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return PoseCachePtr();
+
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 &&
+      static_cast<size_t>(st.st_size) >= sizeof(PoseFileHeader))
+    mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return PoseCachePtr();
+
+  const PoseFileHeader *header = static_cast<PoseFileHeader*>(mapping);
+  size_t expected = sizeof(PoseFileHeader) +
+      static_cast<size_t>(clip.NumFrames()) * clip.skeleton.NumJoints() *
+      PoseBytes(contents);
+
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion ||
+      header->contents != static_cast<uint32_t>(contents) ||
+      header->numFrames != clip.NumFrames() ||
+      header->numJoints != clip.skeleton.NumJoints() ||
+      static_cast<size_t>(st.st_size) != expected ||
+      header->fingerprint != Fingerprint(clip)) {
+    munmap(mapping, st.st_size);
+    return PoseCachePtr();
+  }
+
+  PoseCache *cache = new PoseCache;
+  cache->contents = contents;
+  cache->numFrames = header->numFrames;
+  cache->numJoints = header->numJoints;
+  cache->fingerprint = header->fingerprint;
+  cache->mapping = mapping;
+  cache->mappingSize = st.st_size;
+  cache->data = header + 1;
+  return PoseCachePtr(cache);
+}
+
+PoseCachePtr PoseCache::Load(const string &clipPath, const Clip &clip,
+                             PoseContents contents, ThreadPool *pool) {
+  string path = PathFor(clipPath, contents);
+  PoseCachePtr cache = Open(path, clip, contents);
+  if (cache)
+    return cache;
+
+  cache = Bake(clip, contents, pool);
+  if (!cache->Save(path))
+    fprintf(stderr, "Could not save pose cache %s\n", path.c_str());
+  return cache;
+}
+
+string PoseCache::PathFor(const string &clipPath, PoseContents contents) {
+  return clipPath + (contents == POSE_MATRICES ? ".poses" : ".positions");
+}
+
+/// The fingerprint covers everything evaluation reads: the hierarchy, the
+/// offsets, the channel layout, the folded static values and every frame
+/// value.
+uint64_t PoseCache::Fingerprint(const Clip &clip) {
+  const Skeleton &skeleton = clip.skeleton;
+  uint64_t hash = 14695981039346656037ull;
+
+  hash = HashBytes(hash, &skeleton.frameSize, sizeof(skeleton.frameSize));
+  if (!skeleton.storedIndex.empty()) {
+    hash = HashBytes(hash, &skeleton.storedIndex[0],
+                     skeleton.storedIndex.size() * sizeof(int32_t));
+    hash = HashBytes(hash, &skeleton.staticValues[0],
+                     skeleton.staticValues.size() * sizeof(float));
+  }
+  for (uint32_t j = 0; j < skeleton.NumJoints(); j++) {
+    const ChannelLayout &layout = skeleton.channels[j];
+    const Vector &offset = skeleton.offsets[j];
+    float xyz[3] = {offset.x, offset.y, offset.z};
+
+    hash = HashBytes(hash, &skeleton.parents[j], sizeof(int32_t));
+    hash = HashBytes(hash, xyz, sizeof(xyz));
+    hash = HashBytes(hash, &layout.flags, sizeof(layout.flags));
+    hash = HashBytes(hash, layout.order, sizeof(layout.order));
+  }
+  if (!clip.frames.empty())
+    hash = HashBytes(hash, &clip.frames[0],
+                     clip.frames.size() * sizeof(float));
+  return hash;
+}
+
+/// The cache is written to a temporary file which is then renamed, so a
+/// reader never maps a partially written cache.
+bool PoseCache::Save(const string &path) const {
+  PoseFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.contents = contents;
+  header.numFrames = numFrames;
+  header.numJoints = numJoints;
+  header.fingerprint = fingerprint;
+
+  string temp = path + ".tmp";
+  FILE *file = fopen(temp.c_str(), "wb");
+  if (!file)
+    return false;
+
+  size_t bytes = static_cast<size_t>(numFrames) * numJoints *
+      PoseBytes(contents);
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+      (bytes == 0 || fwrite(data, bytes, 1, file) == 1);
+  ok = (fclose(file) == 0) && ok;
+
+  if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+    remove(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+PoseContents PoseCache::Contents() const {
+  return contents;
+}
+
+uint32_t PoseCache::NumFrames() const {
+  return numFrames;
+}
+
+uint32_t PoseCache::NumJoints() const {
+  return numJoints;
+}
+
+const Matrix4x4 *PoseCache::Matrices(uint32_t frameNumber) const {
+  if (contents != POSE_MATRICES)
+    return NULL;
+  return static_cast<const Matrix4x4*>(data) +
+      static_cast<size_t>(frameNumber) * numJoints;
+}
+
+const Point *PoseCache::Positions(uint32_t frameNumber) const {
+  if (contents != POSE_POSITIONS)
+    return NULL;
+  return static_cast<const Point*>(data) +
+      static_cast<size_t>(frameNumber) * numJoints;
+}
+
+Point PoseCache::Position(uint32_t frameNumber, uint32_t joint) const {
+  if (contents == POSE_POSITIONS)
+    return Positions(frameNumber)[joint];
+
+  const Matrix4x4 &m = Matrices(frameNumber)[joint];
+  return Point(m.m[0][3], m.m[1][3], m.m[2][3]);
+}
+
+bool PoseCache::IsMapped() const {
+  return mapping != NULL;
+}
+
+MemoryUsage PoseCache::Memory() const {
+  MemoryUsage m;
+  m.caches = sizeof(*this) + kHeapOverhead + HeapBytes(matrices) +
+      HeapBytes(positions) + mappingSize;
+  return m;
+}
@@ -0,0 +1,108 @@
+#ifndef __POSE_CACHE_H__
+#define __POSE_CACHE_H__
+
+#include <core/matrix.h>
+#include <core/point.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./clip.h"
+#include "./memory.h"
+#include "./thread_pool.h"
+
+using namespace std;
+using namespace ishi;
+
+class PoseCache;
+
+/// Shared handle to a read-only pose cache
+typedef shared_ptr<const PoseCache> PoseCachePtr;
+
+/// What a pose cache stores for every joint of every frame
+enum PoseContents {
+  POSE_MATRICES,    // full world matrices (enough to drive playback)
+  POSE_POSITIONS    // world positions only (a quarter of the size)
+};
+
+/// World-space poses of every frame of a clip, evaluated ahead of time.
+///
+/// Sampling a frame returns a pointer into the cache, so scrubbing and
+/// looping never evaluate the hierarchy or copy a pose. A cache can be saved
+/// next to its clip and memory-mapped on later runs; the file records a
+/// fingerprint of the clip so a stale cache is never used.
+class PoseCache {
+ private:
+  PoseContents contents;        // what is stored per joint
+  uint32_t numFrames;           // number of frames stored
+  uint32_t numJoints;           // number of joints per frame
+  uint64_t fingerprint;         // fingerprint of the clip baked from
+
+  vector<Matrix4x4> matrices;   // baked matrices (POSE_MATRICES)
+  vector<Point> positions;      // baked positions (POSE_POSITIONS)
+  void *mapping;                // file mapping, if opened from disk
+  size_t mappingSize;           // size of the file mapping, in bytes
+  const void *data;             // first pose, baked or mapped
+
+  PoseCache();
+  PoseCache(const PoseCache &);
+  PoseCache &operator=(const PoseCache &);
+
+ public:
+  ~PoseCache();
+
+  /// Evaluate every frame of a clip, splitting the frames into tasks run on
+  /// a pool (or on the calling thread if pool is NULL)
+  static PoseCachePtr Bake(const Clip &clip, PoseContents contents,
+                           ThreadPool *pool = NULL);
+
+  /// Map a cache saved by Save. Returns NULL if the file is missing,
+  /// malformed, or was baked from different motion data.
+  static PoseCachePtr Open(const string &path, const Clip &clip,
+                           PoseContents contents);
+
+  /// Open the cache saved next to a clip file, or bake and save it if there
+  /// is none yet (or it is stale), baking on a pool if one is given
+  static PoseCachePtr Load(const string &clipPath, const Clip &clip,
+                           PoseContents contents, ThreadPool *pool = NULL);
+
+  /// Return the path a clip file's cache is saved to
+  static string PathFor(const string &clipPath, PoseContents contents);
+
+  /// Return a fingerprint of a clip's skeleton and frame data
+  static uint64_t Fingerprint(const Clip &clip);
+
+  /// Write the cache to a file. Returns false on failure.
+  bool Save(const string &path) const;
+
+  /// Return what is stored per joint
+  PoseContents Contents() const;
+
+  /// Return the number of frames stored
+  uint32_t NumFrames() const;
+
+  /// Return the number of joints per frame
+  uint32_t NumJoints() const;
+
+  /// Return the world matrices of a frame (NumJoints() of them), or NULL if
+  /// the cache only has positions
+  const Matrix4x4 *Matrices(uint32_t frameNumber) const;
+
+  /// Return the world positions of a frame (NumJoints() of them), or NULL
+  /// if the cache has matrices
+  const Point *Positions(uint32_t frameNumber) const;
+
+  /// Return the world position of one joint at a frame
+  Point Position(uint32_t frameNumber, uint32_t joint) const;
+
+  /// Return true if the cache's poses are mapped from a file
+  bool IsMapped() const;
+
+  /// Return the bytes used by the cache (mapped files count as caches too)
+  MemoryUsage Memory() const;
+};
+
+#endif
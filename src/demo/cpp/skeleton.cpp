@@ -0,0 +1,751 @@
+#include <core/common.h>
+#include <core/euler.h>
+#include <core/quaternion.h>
+#include <core/sincos.h>
+#include <core/vector.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "./bvh_defs.h"
+#include "./joint.h"
+#include "./memory.h"
+#include "./skeleton.h"
+#include "./topology.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Resolve the loaded channel order into a rotation order and the positions
+/// of each rotation and position value. Axes without a rotation channel are
+/// appended at the end of the order; their angle is always 0, so where they
+/// go does not change the result.
+static void ResolveChannels(ChannelLayout *layout) {
+  int axes[3], numAxes = 0;
+  bool used[3] = {false, false, false};
+
+  for (int i = 0; i < 3; i++) {
+    layout->rotation[i] = -1;
+    layout->position[i] = -1;
+  }
+
+  for (int i = 0; i < layout->numChannels; i++) {
+    int c = layout->order[i];
+    if (c >= BVH_XPOS_IDX && c <= BVH_ZPOS_IDX &&
+        (layout->flags & (1 << c))) {
+      layout->position[c - BVH_XPOS_IDX] = i;
+    } else if (c >= BVH_XROT_IDX && c <= BVH_ZROT_IDX &&
+               (layout->flags & (1 << c)) && !used[c - BVH_XROT_IDX]) {
+      used[c - BVH_XROT_IDX] = true;
+      layout->rotation[numAxes] = i;
+      axes[numAxes++] = c - BVH_XROT_IDX;
+    }
+  }
+
+  for (int a = 0; a < 3; a++) {
+    if (!used[a])
+      axes[numAxes++] = a;
+  }
+  layout->rotationOrder = GetRotationOrder(axes[0], axes[1], axes[2]);
+}
+
+Skeleton::Skeleton()
+    : frameSize(0), sourceFrameSize(0), evaluator(NULL) {}
+
+/// Joints are laid out in depth-first pre-order, with children visited in
+/// the order they were attached. This is both a topological order and the
+/// order in which BVH frame data is written, so channel offsets are simply
+/// a running sum.
+Skeleton::Skeleton(Segment *root)
+    : frameSize(0), sourceFrameSize(0), evaluator(NULL) {
+  vector<Segment*> stack;
+  vector<int32_t> stackParent;
+
+  if (root) {
+    stack.push_back(root);
+    stackParent.push_back(-1);
+  }
+
+  while (!stack.empty()) {
+    Segment *s = stack.back();
+    int32_t parent = stackParent.back();
+    int32_t index = static_cast<int32_t>(parents.size());
+    stack.pop_back();
+    stackParent.pop_back();
+
+    parents.push_back(parent);
+    firstChild.push_back(-1);
+    ids.push_back(s->id);
+    names.push_back(s->symbol);
+    offsets.push_back(s->offset);
+
+    if (parent >= 0 && firstChild[parent] < 0)
+      firstChild[parent] = index;
+
+    ChannelLayout layout;
+    layout.first = frameSize;
+    layout.numChannels = s->numChannels;
+    layout.flags = s->numChannels ? s->channelFlags : 0;
+    for (unsigned int i = 0; i < BVH_MAX_CHANS; i++)
+      layout.order[i] = (i < s->channelOrder.size()) ?
+          s->channelOrder[i] : BVH_CHAN_INVALID;
+    ResolveChannels(&layout);
+    channels.push_back(layout);
+    frameSize += s->numChannels;
+
+    // Push in reverse so the first child is visited first
+    for (unsigned int i = s->chd.size(); i > 0; i--) {
+      stack.push_back(s->chd[i - 1]);
+      stackParent.push_back(index);
+    }
+  }
+
+  // Index joints by name. Repeated names (e.g. end sites) resolve to the
+  // first joint that has them.
+  uint32_t size = 4;
+  while (size < 2 * parents.size())
+    size *= 2;
+  lookup = vector<int32_t>(size, -1);
+
+  for (uint32_t j = 0; j < parents.size(); j++) {
+    uint32_t i = HashSymbol(names[j]) & (size - 1);
+    while (lookup[i] >= 0 && names[lookup[i]] != names[j])
+      i = (i + 1) & (size - 1);
+    if (lookup[i] < 0)
+      lookup[i] = j;
+  }
+
+  // Descendants follow their ancestor in pre-order, so each subtree ends
+  // where its last descendant's subtree ends. Its extent is the farthest
+  // any descendant reaches from the joint in the bind pose.
+  subtreeEnd = vector<uint32_t>(parents.size());
+  extents = vector<float>(parents.size(), 0.f);
+  for (uint32_t j = parents.size(); j > 0; j--) {
+    uint32_t c = j - 1;
+    int32_t p = parents[c];
+    subtreeEnd[c] = max<uint32_t>(subtreeEnd[c], j);
+    if (p >= 0) {
+      subtreeEnd[p] = max(subtreeEnd[p], subtreeEnd[c]);
+      extents[p] = max(extents[p], Length(offsets[c]) + extents[c]);
+    }
+  }
+
+  // Joints whose subtree is small next to the whole skeleton are dropped
+  // first: end sites, fingers and toes at level 1, hands, feet and the head
+  // at level 2, and everything but the root at level 3
+  vector<uint8_t> levels(parents.size(), 0);
+  float reach = parents.empty() ? 0.f : extents[0];
+  for (uint32_t j = 0; j < parents.size(); j++) {
+    if (extents[j] >= 0.25f * reach)
+      levels[j] = 2;
+    else if (extents[j] >= 0.05f * reach)
+      levels[j] = 1;
+  }
+  SetLods(levels);
+
+  // Until static channels are folded, every value is stored as loaded
+  sourceFrameSize = frameSize;
+  storedIndex = vector<int32_t>(sourceFrameSize);
+  staticValues = vector<float>(sourceFrameSize, 0.f);
+  for (uint32_t i = 0; i < sourceFrameSize; i++)
+    storedIndex[i] = i;
+  ResolveStored();
+  evaluator = FindPoseEvaluator(*this);
+}
+
+void Skeleton::ResolveStored() {
+  const uint32_t n = parents.size();
+  bindOffsets = vector<Vector>(n);
+  bind = vector<Transform>(n);
+  angleSources.clear();
+  angleDefaults.clear();
+  frameSize = 0;
+
+  for (uint32_t j = 0; j < n; j++) {
+    ChannelLayout &layout = channels[j];
+    float offset[3] = {offsets[j].x, offsets[j].y, offsets[j].z};
+
+    layout.storedFirst = frameSize;
+    layout.numStored = 0;
+    for (uint32_t i = 0; i < layout.numChannels; i++) {
+      if (storedIndex[layout.first + i] >= 0)
+        layout.numStored++;
+    }
+    frameSize += layout.numStored;
+    layout.fixed = (layout.numStored == 0);
+
+    // Static positions move into the bind offset
+    for (int i = 0; i < 3; i++) {
+      layout.storedPosition[i] = -1;
+      if (layout.position[i] < 0)
+        continue;
+      uint32_t value = layout.first + layout.position[i];
+      if (storedIndex[value] >= 0)
+        layout.storedPosition[i] = storedIndex[value];
+      else
+        offset[i] += staticValues[value];
+    }
+    bindOffsets[j] = Vector(offset[0], offset[1], offset[2]);
+
+    // Static rotations become constant angles
+    float angles[3];
+    for (int i = 0; i < 3; i++) {
+      layout.storedRotation[i] = -1;
+      angles[i] = 0.f;
+      if (layout.rotation[i] < 0)
+        continue;
+      uint32_t value = layout.first + layout.rotation[i];
+      layout.storedRotation[i] = storedIndex[value];
+      if (storedIndex[value] < 0)
+        angles[i] = staticValues[value];
+    }
+
+    layout.angles = -1;
+    if (layout.rotation[0] >= 0 && !layout.fixed) {
+      layout.angles = angleSources.size();
+      for (int i = 0; i < 3; i++) {
+        angleSources.push_back(layout.storedRotation[i]);
+        angleDefaults.push_back(angles[i]);
+      }
+    } else if (layout.rotation[0] >= 0) {
+      float s[3], c[3];
+      SinCosDegrees(angles, 3, s, c);
+      bind[j] = EulerTransform(layout.rotationOrder, c, s, bindOffsets[j]);
+    } else {
+      bind[j] = Translate(bindOffsets[j]);
+    }
+  }
+}
+
+uint32_t Skeleton::NumJoints() const {
+  return parents.size();
+}
+
+size_t Skeleton::MemoryBytes() const {
+  return HeapBytes(parents) + HeapBytes(firstChild) + HeapBytes(ids) +
+      HeapBytes(names) + HeapBytes(offsets) + HeapBytes(channels) +
+      HeapBytes(lookup) + HeapBytes(angleSources) +
+      HeapBytes(angleDefaults) + HeapBytes(storedIndex) +
+      HeapBytes(staticValues) + HeapBytes(bindOffsets) + HeapBytes(bind) +
+      HeapBytes(subtreeEnd) + HeapBytes(extents) + HeapBytes(lods);
+}
+
+/// Frames can only be shared if the same channels were folded to the same
+/// values, since the static values live in the skeleton.
+bool Skeleton::Matches(const Skeleton &other) const {
+  if (frameSize != other.frameSize || parents != other.parents ||
+      storedIndex != other.storedIndex || staticValues != other.staticValues)
+    return false;
+
+  for (uint32_t j = 0; j < channels.size(); j++) {
+    const ChannelLayout &a = channels[j], &b = other.channels[j];
+    if (a.numChannels != b.numChannels || a.flags != b.flags ||
+        memcmp(a.order, b.order, sizeof(a.order)) != 0)
+      return false;
+  }
+  return true;
+}
+
+int32_t Skeleton::JointIndex(Symbol name) const {
+  if (name == kNoSymbol || lookup.empty())
+    return -1;
+
+  uint32_t mask = lookup.size() - 1;
+  for (uint32_t i = HashSymbol(name) & mask; ; i = (i + 1) & mask) {
+    int32_t j = lookup[i];
+    if (j < 0 || names[j] == name)
+      return j;
+  }
+}
+
+/// A channel is static if its range over all frames is at most epsilon.
+/// It is folded to the middle of that range, so no value moves by more than
+/// epsilon / 2 (an exact constant is folded to itself).
+uint32_t Skeleton::FoldStaticChannels(const vector<float> &frames,
+                                      float epsilon, vector<float> *stored) {
+  const uint32_t size = sourceFrameSize;
+  const size_t numFrames = size ? frames.size() / size : 0;
+  vector<float> low, high;
+  uint32_t folded = 0;
+
+  if (numFrames > 0) {
+    low.assign(frames.begin(), frames.begin() + size);
+    high = low;
+  }
+  for (size_t f = 1; f < numFrames; f++) {
+    const float *frame = &frames[f * size];
+    for (uint32_t i = 0; i < size; i++) {
+      low[i] = min(low[i], frame[i]);
+      high[i] = max(high[i], frame[i]);
+    }
+  }
+
+  // Keep at least one stored value, so a clip still knows its frame count
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    bool keep = numFrames == 0 || high[i] - low[i] > epsilon ||
+        (i == size - 1 && next == 0);
+    if (keep) {
+      storedIndex[i] = next++;
+      staticValues[i] = 0.f;
+    } else {
+      storedIndex[i] = -1;
+      staticValues[i] = (low[i] == high[i]) ? frames[i] :
+          low[i] + 0.5f * (high[i] - low[i]);
+      folded++;
+    }
+  }
+  ResolveStored();
+
+  stored->resize(numFrames * frameSize);
+  for (size_t f = 0; f < numFrames; f++) {
+    const float *frame = &frames[f * size];
+    float *out = &(*stored)[f * frameSize];
+    for (uint32_t i = 0; i < size; i++) {
+      if (storedIndex[i] >= 0)
+        out[storedIndex[i]] = frame[i];
+    }
+  }
+  return folded;
+}
+
+void Skeleton::Unpack(const float *stored, float *source) const {
+  for (uint32_t i = 0; i < sourceFrameSize; i++)
+    source[i] = (storedIndex[i] >= 0) ? stored[storedIndex[i]] :
+        staticValues[i];
+}
+
+void Skeleton::SetLods(const vector<uint8_t> &levels) {
+  lods = vector<uint8_t>(parents.size());
+  for (uint32_t j = 0; j < parents.size(); j++) {
+    int32_t p = parents[j];
+    if (p < 0)
+      lods[j] = kNumLods - 1;
+    else
+      lods[j] = min(levels[j], lods[p]);
+  }
+}
+
+uint32_t Skeleton::NumJointsAtLod(int lod) const {
+  uint32_t count = 0;
+  for (uint32_t j = 0; j < lods.size(); j++) {
+    if (lods[j] >= lod)
+      count++;
+  }
+  return count;
+}
+
+uint32_t Skeleton::NumAngles() const {
+  return angleSources.size();
+}
+
+/// Angles are gathered for all frames first so the whole batch goes through
+/// a single call, which keeps the SIMD lanes full across joint boundaries.
+void Skeleton::SinCos(const float *frames, uint32_t numFrames, float *s,
+                      float *c) const {
+  const uint32_t n = angleSources.size();
+  float *angles = s;  // gather in place; SinCosDegrees reads before writing
+
+  for (uint32_t f = 0; f < numFrames; f++) {
+    const float *frame = frames + f * frameSize;
+    for (uint32_t i = 0; i < n; i++)
+      angles[f * n + i] = (angleSources[i] >= 0) ?
+          frame[angleSources[i]] : angleDefaults[i];
+  }
+  SinCosDegrees(angles, numFrames * n, s, c);
+}
+
+/// Kept angles are packed into one batch, so the trigonometry of dropped
+/// joints is skipped, and then spread back out to their slots.
+void Skeleton::SinCosAtLod(const float *frame, int lod, float *s,
+                           float *c) const {
+  static thread_local vector<float> scratch;
+  const uint32_t n = parents.size();
+  const uint32_t numAngles = angleSources.size();
+  if (scratch.size() < 2 * numAngles)
+    scratch.resize(2 * numAngles);
+  float *packedS = &scratch[0];
+  float *packedC = &scratch[numAngles];
+
+  uint32_t count = 0;
+  for (uint32_t j = 0; j < n; ) {
+    if (lods[j] < lod) {
+      j = subtreeEnd[j];
+      continue;
+    }
+    int32_t first = channels[j].angles;
+    for (int i = 0; first >= 0 && i < 3; i++) {
+      int32_t source = angleSources[first + i];
+      packedS[count++] = (source >= 0) ? frame[source] :
+          angleDefaults[first + i];
+    }
+    j++;
+  }
+  SinCosDegrees(packedS, count, packedS, packedC);
+
+  count = 0;
+  for (uint32_t j = 0; j < n; ) {
+    if (lods[j] < lod) {
+      j = subtreeEnd[j];
+      continue;
+    }
+    int32_t first = channels[j].angles;
+    for (int i = 0; first >= 0 && i < 3; i++) {
+      s[first + i] = packedS[count];
+      c[first + i] = packedC[count++];
+    }
+    j++;
+  }
+}
+
+uint32_t Skeleton::NumRotations() const {
+  return angleSources.size() / 3;
+}
+
+/// The quaternion of an Euler rotation takes the sines and cosines of the
+/// half angles, which still go through one batch for all frames
+void Skeleton::Rotations(const float *frames, uint32_t numFrames,
+                         Quaternion *q) const {
+  static thread_local vector<float> scratch;
+  const uint32_t n = angleSources.size();
+  if (scratch.size() < 2 * numFrames * n)
+    scratch.resize(2 * numFrames * n);
+  float *s = &scratch[0];
+  float *c = &scratch[numFrames * n];
+
+  for (uint32_t f = 0; f < numFrames; f++) {
+    const float *frame = frames + f * frameSize;
+    for (uint32_t i = 0; i < n; i++)
+      s[f * n + i] = 0.5f * ((angleSources[i] >= 0) ?
+                             frame[angleSources[i]] : angleDefaults[i]);
+  }
+  SinCosDegrees(s, numFrames * n, s, c);
+
+  for (uint32_t j = 0; j < parents.size(); j++) {
+    const ChannelLayout &layout = channels[j];
+    if (layout.angles < 0)
+      continue;
+    for (uint32_t f = 0; f < numFrames; f++) {
+      uint32_t first = f * n + layout.angles;
+      q[f * NumRotations() + layout.angles / 3] =
+          EulerQuaternion(layout.rotationOrder, &c[first], &s[first]);
+    }
+  }
+}
+
+Transform Skeleton::Local(uint32_t joint, const float *frame) const {
+  const ChannelLayout &layout = channels[joint];
+  float angles[3], s[3], c[3];
+
+  if (layout.angles < 0)
+    return Compose(joint, frame, NULL, NULL);
+
+  for (int i = 0; i < 3; i++)
+    angles[i] = (layout.storedRotation[i] >= 0) ?
+        frame[layout.storedRotation[i]] : angleDefaults[layout.angles + i];
+  SinCosDegrees(angles, 3, s, c);
+  return Compose(joint, frame, s, c);
+}
+
+Transform Skeleton::Local(uint32_t joint, const float *frame, const float *s,
+                          const float *c) const {
+  int32_t first = channels[joint].angles;
+  if (first < 0)
+    return Compose(joint, frame, NULL, NULL);
+  return Compose(joint, frame, s + first, c + first);
+}
+
+Vector Skeleton::LocalTranslation(uint32_t joint, const float *frame) const {
+  const ChannelLayout &layout = channels[joint];
+  Vector trans = bindOffsets[joint];
+  if (layout.storedPosition[0] >= 0)
+    trans.x += frame[layout.storedPosition[0]];
+  if (layout.storedPosition[1] >= 0)
+    trans.y += frame[layout.storedPosition[1]];
+  if (layout.storedPosition[2] >= 0)
+    trans.z += frame[layout.storedPosition[2]];
+  return trans;
+}
+
+Transform Skeleton::Compose(uint32_t joint, const float *frame,
+                            const float *s, const float *c) const {
+  const ChannelLayout &layout = channels[joint];
+  if (layout.fixed)
+    return bind[joint];
+
+  Vector trans = LocalTranslation(joint, frame);
+  if (layout.angles < 0)
+    return Translate(trans);
+  return EulerTransform(layout.rotationOrder, c, s, trans);
+}
+
+void Skeleton::Evaluate(const float *frame, Transform *world) const {
+  if (evaluator) {
+    evaluator(*this, frame, 0, world);
+    return;
+  }
+
+  // Per-thread scratch, so a shared skeleton can be evaluated concurrently
+  // without allocating on every frame
+  static thread_local vector<float> scratch;
+  const uint32_t n = angleSources.size();
+  if (scratch.size() < 2 * n)
+    scratch.resize(2 * n);
+
+  SinCos(frame, 1, &scratch[0], &scratch[n]);
+  Evaluate(frame, &scratch[0], &scratch[n], world);
+}
+
+/// A specialized evaluator skips dropped joints itself. Otherwise the pass
+/// skips a dropped joint's whole subtree in one step and composes kept
+/// joints as the full pass does, as rigid transforms whose inverses are
+/// never formed. Either way only the angles of kept joints are batched, so
+/// the cost falls with the number of joints dropped.
+void Skeleton::Evaluate(const float *frame, int lod, Transform *world) const {
+  if (lod <= 0) {
+    Evaluate(frame, world);
+    return;
+  }
+  if (evaluator) {
+    evaluator(*this, frame, lod, world);
+    return;
+  }
+
+  static thread_local vector<float> scratch;
+  const uint32_t n = parents.size();
+  const uint32_t numAngles = angleSources.size();
+  if (scratch.size() < 2 * numAngles)
+    scratch.resize(2 * numAngles);
+  float *s = &scratch[0];
+  float *c = &scratch[numAngles];
+  SinCosAtLod(frame, lod, s, c);
+
+  for (uint32_t j = 0; j < n; ) {
+    if (lods[j] < lod) {
+      j = subtreeEnd[j];
+      continue;
+    }
+    if (parents[j] >= 0)
+      world[j] = world[parents[j]] * Local(j, frame, s, c);
+    else
+      world[j] = Local(j, frame, s, c);
+    j++;
+  }
+}
+
+void Skeleton::Evaluate(const float *frame, const float *s, const float *c,
+                        Transform *world) const {
+  const uint32_t n = parents.size();
+  for (uint32_t j = 0; j < n; j++) {
+    if (parents[j] >= 0)
+      world[j] = world[parents[j]] * Local(j, frame, s, c);
+    else
+      world[j] = Local(j, frame, s, c);
+  }
+}
+
+void Skeleton::Evaluate(const float *frame, const Quaternion *rotations,
+                        Transform *world) const {
+  const uint32_t n = parents.size();
+  for (uint32_t j = 0; j < n; j++) {
+    int32_t k = channels[j].angles / 3;
+    Transform local = RotationLocal(j, frame, (k >= 0) ? rotations[k] :
+                                    Quaternion());
+    world[j] = (parents[j] >= 0) ? world[parents[j]] * local : local;
+  }
+}
+
+void Skeleton::Evaluate(const float *frame, const QuaternionArrays &rotations,
+                        Transform *world) const {
+  const uint32_t n = parents.size();
+  for (uint32_t j = 0; j < n; j++) {
+    int32_t k = channels[j].angles / 3;
+    Transform local = RotationLocal(j, frame, (k >= 0) ?
+        Quaternion(rotations.w[k], rotations.x[k], rotations.y[k],
+                   rotations.z[k]) : Quaternion());
+    world[j] = (parents[j] >= 0) ? world[parents[j]] * local : local;
+  }
+}
+
+Transform Skeleton::RotationLocal(uint32_t joint, const float *frame,
+                                  const Quaternion &rotation) const {
+  const ChannelLayout &layout = channels[joint];
+  if (layout.fixed)
+    return bind[joint];
+  if (layout.angles < 0)
+    return Translate(LocalTranslation(joint, frame));
+  return QuaternionTransform(rotation, LocalTranslation(joint, frame));
+}
+
+/// Angles are gathered axis by axis, so when every joint uses the same
+/// rotation order (as in most BVH files) the quaternions of all the frames
+/// come out of one batched kernel.
+void Skeleton::FrameRotations(const float *const *frames, uint32_t numFrames,
+                              float *scratch,
+                              const QuaternionArrays &q) const {
+  const uint32_t n = NumRotations();
+  const uint32_t m = numFrames * n;
+  float *s = scratch;
+  float *c = scratch + 3 * m;
+
+  for (uint32_t f = 0; f < numFrames; f++) {
+    for (uint32_t i = 0; i < 3 * n; i++)
+      s[(i % 3) * m + f * n + i / 3] = 0.5f * ((angleSources[i] >= 0) ?
+                                               frames[f][angleSources[i]] :
+                                               angleDefaults[i]);
+  }
+  SinCosDegrees(s, 3 * m, s, c);
+
+  bool uniform = true;
+  int32_t order = -1;
+  for (uint32_t j = 0; j < parents.size(); j++) {
+    if (channels[j].angles < 0)
+      continue;
+    if (order >= 0 && channels[j].rotationOrder != order)
+      uniform = false;
+    order = channels[j].rotationOrder;
+  }
+
+  if (uniform) {
+    const float *const cs[3] = {c, c + m, c + 2 * m};
+    const float *const ss[3] = {s, s + m, s + 2 * m};
+    EulerQuaternions(static_cast<RotationOrder>(order), cs, ss, m, q);
+    return;
+  }
+  for (uint32_t f = 0; f < numFrames; f++) {
+    for (uint32_t j = 0; j < parents.size(); j++) {
+      const ChannelLayout &layout = channels[j];
+      if (layout.angles < 0)
+        continue;
+      uint32_t k = f * n + layout.angles / 3;
+      float cj[3] = {c[k], c[m + k], c[2 * m + k]};
+      float sj[3] = {s[k], s[m + k], s[2 * m + k]};
+      Quaternion r = EulerQuaternion(layout.rotationOrder, cj, sj);
+      q.w[k] = r.w;
+      q.x[k] = r.x;
+      q.y[k] = r.y;
+      q.z[k] = r.z;
+    }
+  }
+}
+
+/// Rotations are interpolated as structure-of-arrays so the slerp of all
+/// joints runs in full SIMD lanes, and the rotations of both frames come
+/// out of one batch. Angles are never interpolated directly, which would
+/// take the long way around at the 180 degree wrap. Fixed joints have no
+/// rotation, so only animated ones are slerped.
+void Skeleton::Sample(const float *frame0, const Quaternion *rotations0,
+                      const float *frame1, const Quaternion *rotations1,
+                      float t, bool holdPositions, Transform *world) const {
+  static thread_local vector<float> scratch;
+  const uint32_t numRotations = NumRotations();
+  if (scratch.size() < frameSize + 20 * numRotations)
+    scratch.resize(frameSize + 20 * numRotations);
+
+  // Only the positions of the blended frame are read; the rotations come
+  // from the slerped quaternions
+  const float *frame = frame0;
+  if (!holdPositions) {
+    float *lerped = &scratch[0];
+    for (uint32_t i = 0; i < frameSize; i++)
+      lerped[i] = Lerp(t, frame0[i], frame1[i]);
+    frame = lerped;
+  }
+  if (numRotations == 0) {
+    Evaluate(frame, static_cast<const Quaternion *>(NULL), world);
+    return;
+  }
+
+  // Each component holds the rotations of frame0 followed by those of
+  // frame1, as FrameRotations lays out two frames
+  float *soa = &scratch[frameSize];
+  float *angles = soa + 8 * numRotations;
+  QuaternionArrays q[2];
+  for (int f = 0; f < 2; f++) {
+    q[f].w = soa + f * numRotations;
+    q[f].x = soa + (2 + f) * numRotations;
+    q[f].y = soa + (4 + f) * numRotations;
+    q[f].z = soa + (6 + f) * numRotations;
+  }
+  const float *frames[2] = {frame0, frame1};
+  const Quaternion *rotations[2] = {rotations0, rotations1};
+  for (int f = 0; f < 2; f++) {
+    if (!rotations0 && !rotations1) {
+      FrameRotations(frames, 2, angles, q[0]);
+      break;
+    }
+    if (!rotations[f]) {
+      FrameRotations(&frames[f], 1, angles, q[f]);
+      continue;
+    }
+    for (uint32_t i = 0; i < numRotations; i++) {
+      q[f].w[i] = rotations[f][i].w;
+      q[f].x[i] = rotations[f][i].x;
+      q[f].y[i] = rotations[f][i].y;
+      q[f].z[i] = rotations[f][i].z;
+    }
+  }
+
+  SlerpQuaternions(t, q[0], q[1], numRotations, q[0]);
+  Evaluate(frame, q[0], world);
+}
+
+/// Only the angles of joints whose values changed go through the batch,
+/// so a held joint costs a comparison and nothing else.
+ChangeCounts Skeleton::EvaluateChanged(const float *frame,
+                                       const float *previous,
+                                       Transform *local, Transform *world,
+                                       uint8_t *changed) const {
+  static thread_local vector<float> scratch;
+  const uint32_t n = parents.size();
+  const uint32_t numAngles = angleSources.size();
+  ChangeCounts counts = {0, 0};
+  if (scratch.size() < 4 * numAngles)
+    scratch.resize(4 * numAngles);
+  float *packedS = &scratch[0];
+  float *packedC = &scratch[numAngles];
+  float *s = &scratch[2 * numAngles];
+  float *c = &scratch[3 * numAngles];
+
+  // Values are compared bit for bit, so the result is exactly what a full
+  // evaluation would give. changed holds the local changes until the
+  // second pass.
+  uint32_t count = 0;
+  for (uint32_t j = 0; j < n; j++) {
+    const ChannelLayout &layout = channels[j];
+    changed[j] = !previous ||
+        memcmp(frame + layout.storedFirst, previous + layout.storedFirst,
+               layout.numStored * sizeof(float)) != 0;
+    for (int i = 0; changed[j] && layout.angles >= 0 && i < 3; i++) {
+      int32_t source = angleSources[layout.angles + i];
+      packedS[count++] = (source >= 0) ? frame[source] :
+          angleDefaults[layout.angles + i];
+    }
+  }
+  SinCosDegrees(packedS, count, packedS, packedC);
+
+  count = 0;
+  for (uint32_t j = 0; j < n; j++) {
+    const ChannelLayout &layout = channels[j];
+    int32_t p = parents[j];
+    bool localChanged = changed[j];
+
+    if (localChanged) {
+      for (int i = 0; layout.angles >= 0 && i < 3; i++) {
+        s[layout.angles + i] = packedS[count];
+        c[layout.angles + i] = packedC[count++];
+      }
+      local[j] = Local(j, frame, s, c);
+      counts.locals++;
+    }
+    changed[j] = localChanged || (p >= 0 && changed[p]);
+    if (changed[j]) {
+      world[j] = (p >= 0) ? world[p] * local[j] : local[j];
+      counts.worlds++;
+    }
+  }
+  return counts;
+}
@@ -0,0 +1,266 @@
+#ifndef __SKELETON_H__
+#define __SKELETON_H__
+
+#include <core/euler.h>
+#include <core/point.h>
+#include <core/quaternion.h>
+#include <core/vector.h>
+#include <core/transform.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "./bvh_defs.h"
+#include "./symbol.h"
+
+using namespace std;
+using namespace ishi;
+
+class Segment;
+
+/// Describes where a joint's channels live in a motion frame and how to
+/// interpret them.
+///
+/// Besides the channel order as it was loaded, the layout is resolved into
+/// one of the six rotation orders plus the positions of the position and
+/// rotation values, so evaluation never has to branch per channel.
+///
+/// Frames may be stored without static channels (see
+/// Skeleton::FoldStaticChannels), so the layout describes both the frame as
+/// loaded and where the remaining animated values are stored.
+struct ChannelLayout {
+  uint32_t first;               // index of the joint's first value in a
+                                // frame as loaded
+  uint16_t numChannels;         // number of channels the joint has
+  uint16_t flags;               // bit mask specifying available channels
+  int8_t order[BVH_MAX_CHANS];  // channel index of each value, in order
+
+  RotationOrder rotationOrder;  // order the three rotations are composed in
+  int8_t rotation[3];           // value of each rotation in order (-1 if none)
+  int8_t position[3];           // value of the X, Y, Z position (-1 if none)
+
+  uint32_t storedFirst;         // index of the joint's first stored value
+  uint16_t numStored;           // number of animated values stored
+  bool fixed;                   // true if no channel is animated, so the
+                                // local transform is the bind transform
+  int32_t storedRotation[3];    // stored index of each rotation in order
+                                // (-1 if none or static)
+  int32_t storedPosition[3];    // stored index of the X, Y, Z position
+                                // (-1 if none or static)
+  int32_t angles;               // first of the joint's three batched angles
+                                // (-1 if the joint has no animated rotation)
+};
+
+/// Number of skeletal levels of detail. Level 0 evaluates every joint;
+/// each coarser level drops the joints with the smallest subtrees, down to
+/// the root alone at kNumLods - 1.
+const int kNumLods = 4;
+
+class Skeleton;
+
+/// Forward kinematics for the joints of one frame kept at a level of detail
+/// (0 for every joint), specialized for a particular skeleton topology
+typedef void (*PoseEvaluator)(const Skeleton &skeleton, const float *frame,
+                              int lod, Transform *world);
+
+/// Number of transforms recomputed by an incremental evaluation
+struct ChangeCounts {
+  uint32_t locals;              // local transforms recomputed
+  uint32_t worlds;              // world transforms recomputed
+};
+
+/// A flattened, read-only form of a Segment hierarchy.
+///
+/// Joints are stored in topological order (every parent comes before its
+/// children), so forward kinematics is a single forward loop over parallel
+/// arrays instead of a recursive walk over Segment pointers.
+///
+/// The sines and cosines of all rotation channels are computed in one
+/// vectorized batch before any matrix is assembled; every rotating joint owns
+/// three consecutive slots of that batch, in rotation order.
+///
+/// Channels that never change can be folded out of the frames: their values
+/// go into the joint's bind offset (positions), a constant batched angle
+/// (rotations), or a precomputed bind transform when nothing of the joint
+/// is animated.
+///
+/// Every joint has a level of detail: the coarsest level it is still
+/// evaluated at. Levels never increase from parent to child, and a joint's
+/// descendants are contiguous in the joint order, so an evaluation at a
+/// coarse level skips whole subtrees at once.
+class Skeleton {
+ public:
+  vector<int32_t> parents;          // parent joint index (-1 for the root)
+  vector<int32_t> firstChild;       // first child joint index (-1 if none)
+  vector<uint32_t> ids;             // id of the Segment each joint came from
+  vector<Symbol> names;             // interned name of each joint
+  vector<Vector> offsets;           // offset from the parent, in local space
+  vector<ChannelLayout> channels;   // how to read each joint's frame data
+  uint32_t frameSize;               // number of values in a stored frame
+
+  uint32_t sourceFrameSize;         // number of values in a frame as loaded
+  vector<int32_t> storedIndex;      // stored index of each loaded value
+                                    // (-1 if the channel is static)
+  vector<float> staticValues;       // value of each static channel
+  vector<Vector> bindOffsets;       // offset plus static positions
+  vector<Transform> bind;           // local transform of fixed joints
+  vector<int32_t> angleSources;     // stored value of each batched angle
+                                    // (-1 for a static or missing axis)
+  vector<float> angleDefaults;      // angle used where the source is -1
+
+  vector<uint32_t> subtreeEnd;      // index one past the last descendant
+  vector<float> extents;            // farthest bind distance to a descendant
+  vector<uint8_t> lods;             // coarsest level each joint is kept at
+
+  PoseEvaluator evaluator;          // evaluator specialized for the
+                                    // topology (NULL to use the generic one)
+
+ private:
+  vector<int32_t> lookup;           // open-addressing table of joint indices
+
+  /// Derive the stored layout, bind data and angle batch from storedIndex
+  /// and staticValues
+  void ResolveStored();
+
+  /// Assemble the local transform of a joint from the sines and cosines of
+  /// its own three angles (both NULL if it has no rotation)
+  Transform Compose(uint32_t joint, const float *frame, const float *s,
+                    const float *c) const;
+
+  /// Return the translation of a joint's local transform for a frame
+  Vector LocalTranslation(uint32_t joint, const float *frame) const;
+
+  /// Assemble the local transform of a joint from its rotation (unused if
+  /// it has none)
+  Transform RotationLocal(uint32_t joint, const float *frame,
+                          const Quaternion &rotation) const;
+
+  /// Compute the rotations of one or more frames as structure-of-arrays
+  /// quaternions, frame after frame, given scratch space for
+  /// 6 * numFrames * NumRotations() floats
+  void FrameRotations(const float *const *frames, uint32_t numFrames,
+                      float *scratch, const QuaternionArrays &q) const;
+
+ public:
+  /// Initialize an empty skeleton
+  Skeleton();
+
+  /// Compile the hierarchy rooted at a segment
+  explicit Skeleton(Segment *root);
+
+  /// Return the number of joints
+  uint32_t NumJoints() const;
+
+  /// Return the heap bytes used by the skeleton's arrays
+  size_t MemoryBytes() const;
+
+  /// Return true if both skeletons have the same hierarchy and frame layout.
+  /// Skeletons whose static channels were folded only match if the same
+  /// channels were folded to the same values.
+  bool Matches(const Skeleton &other) const;
+
+  /// Return the index of the first joint with a name, or -1 if none
+  int32_t JointIndex(Symbol name) const;
+
+  /// Find channels whose value never varies by more than epsilon over a set
+  /// of frames in loaded layout, fold them into the bind data and store the
+  /// frames without them. Must be called on a skeleton that has not been
+  /// folded yet. Returns the number of channels folded.
+  uint32_t FoldStaticChannels(const vector<float> &frames, float epsilon,
+                              vector<float> *stored);
+
+  /// Rebuild a frame in the layout it was loaded in (sourceFrameSize
+  /// values) from a stored frame, e.g. for export
+  void Unpack(const float *stored, float *source) const;
+
+  /// Set the level of detail of every joint (e.g. from a user-defined
+  /// mask, see SceneGraph::jointLods). A joint is never kept at a coarser
+  /// level than its parent, and the root is kept at every level. Clips hold
+  /// their skeleton const, so this must be done before one is built.
+  void SetLods(const vector<uint8_t> &levels);
+
+  /// Return the number of joints evaluated at a level of detail
+  uint32_t NumJointsAtLod(int lod) const;
+
+  /// Return the number of batched angles in a frame (three per joint with
+  /// rotation channels)
+  uint32_t NumAngles() const;
+
+  /// Compute the sine and cosine of every batched angle of consecutive
+  /// frames. Each output array must hold numFrames * NumAngles() values,
+  /// frame after frame.
+  void SinCos(const float *frames, uint32_t numFrames, float *s,
+              float *c) const;
+
+  /// Compute the sine and cosine of the batched angles of the joints kept
+  /// at a level of detail in one frame. They land where SinCos puts them,
+  /// so each output array must hold NumAngles() values; the slots of
+  /// dropped joints are left untouched.
+  void SinCosAtLod(const float *frame, int lod, float *s, float *c) const;
+
+  /// Return the number of rotations in a frame (one per joint with
+  /// rotation channels, NumAngles() / 3)
+  uint32_t NumRotations() const;
+
+  /// Compute the rotation of every rotating joint of consecutive frames as
+  /// a quaternion, in the order of the batched angles. The output array
+  /// must hold numFrames * NumRotations() quaternions, frame after frame.
+  void Rotations(const float *frames, uint32_t numFrames,
+                 Quaternion *q) const;
+
+  /// Return the local (parent-relative) transform of a joint for a frame
+  Transform Local(uint32_t joint, const float *frame) const;
+
+  /// Return the local transform of a joint for a frame, given the frame's
+  /// batched sines and cosines
+  Transform Local(uint32_t joint, const float *frame, const float *s,
+                  const float *c) const;
+
+  /// Compute the world transform of every joint for a frame.
+  /// The output array must hold NumJoints() transforms. Skeletons with a
+  /// registered topology go through its specialized evaluator.
+  void Evaluate(const float *frame, Transform *world) const;
+
+  /// Compute the world transform of the joints kept at a level of detail.
+  /// Transforms of the other joints are left untouched.
+  void Evaluate(const float *frame, int lod, Transform *world) const;
+
+  /// Compute the world transform of every joint for a frame, given the
+  /// frame's batched sines and cosines
+  void Evaluate(const float *frame, const float *s, const float *c,
+                Transform *world) const;
+
+  /// Compute the world transform of every joint for a frame, given the
+  /// frame's rotations (see Rotations), without any trigonometry
+  void Evaluate(const float *frame, const Quaternion *rotations,
+                Transform *world) const;
+
+  /// Compute the world transform of every joint for a frame, given its
+  /// rotations as structure-of-arrays quaternions
+  void Evaluate(const float *frame, const QuaternionArrays &rotations,
+                Transform *world) const;
+
+  /// Compute the world transform of every joint at a fraction t of the way
+  /// from one frame to another: positions are interpolated linearly and
+  /// rotations by slerp, batched across all joints. The rotations of either
+  /// frame may be passed in (see Rotations), or NULL to derive them. With
+  /// holdPositions, positions are those of frame0 as they are, e.g. across
+  /// the seam of a looping clip, where a moving root would otherwise slide
+  /// back across its whole path.
+  void Sample(const float *frame0, const Quaternion *rotations0,
+              const float *frame1, const Quaternion *rotations1, float t,
+              bool holdPositions, Transform *world) const;
+
+  /// Update the local and world transforms evaluated for a previous frame
+  /// to a new frame, recomputing a local transform only if the joint's
+  /// channel values changed and a world transform only if its local
+  /// transform or an ancestor changed. Pass NULL as the previous frame to
+  /// compute everything. The changed array must hold NumJoints() flags and
+  /// is set for every joint whose world transform was recomputed.
+  ChangeCounts EvaluateChanged(const float *frame, const float *previous,
+                               Transform *local, Transform *world,
+                               uint8_t *changed) const;
+};
+
+#endif
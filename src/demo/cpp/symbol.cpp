@@ -0,0 +1,97 @@
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "./memory.h"
+#include "./symbol.h"
+
+using namespace std;
+
+/// FNV-1a hash of a null-terminated string
+static uint32_t HashString(const char *s) {
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h ^= static_cast<unsigned char>(*s++);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+SymbolTable::SymbolTable()
+    : slots(64, kNoSymbol) {}
+
+Symbol SymbolTable::Intern(const char *s) {
+  uint32_t h = HashString(s);
+  uint32_t mask = slots.size() - 1;
+
+  for (uint32_t i = h & mask; ; i = (i + 1) & mask) {
+    Symbol sym = slots[i];
+    if (sym == kNoSymbol)
+      break;
+    if (hashes[sym] == h && strings[sym] == s)
+      return sym;
+  }
+
+  // Keep the load factor at or below one half
+  if (2 * (strings.size() + 1) > slots.size()) {
+    Grow();
+    mask = slots.size() - 1;
+  }
+
+  Symbol sym = strings.size();
+  strings.push_back(s);
+  hashes.push_back(h);
+
+  uint32_t i = h & mask;
+  while (slots[i] != kNoSymbol)
+    i = (i + 1) & mask;
+  slots[i] = sym;
+
+  return sym;
+}
+
+Symbol SymbolTable::Find(const char *s) const {
+  uint32_t h = HashString(s);
+  uint32_t mask = slots.size() - 1;
+
+  for (uint32_t i = h & mask; ; i = (i + 1) & mask) {
+    Symbol sym = slots[i];
+    if (sym == kNoSymbol)
+      return kNoSymbol;
+    if (hashes[sym] == h && strings[sym] == s)
+      return sym;
+  }
+}
+
+const char *SymbolTable::Name(Symbol s) const {
+  return strings[s].c_str();
+}
+
+uint32_t SymbolTable::Size() const {
+  return strings.size();
+}
+
+size_t SymbolTable::MemoryBytes() const {
+  size_t bytes = sizeof(*this) + HeapBytes(hashes) + HeapBytes(slots);
+  for (unsigned int i = 0; i < strings.size(); i++)
+    bytes += sizeof(string) + HeapBytes(strings[i]);
+  return bytes;
+}
+
+SymbolTable &SymbolTable::Shared() {
+  static SymbolTable table;
+  return table;
+}
+
+void SymbolTable::Grow() {
+  slots = vector<Symbol>(2 * slots.size(), kNoSymbol);
+  uint32_t mask = slots.size() - 1;
+
+  for (Symbol sym = 0; sym < strings.size(); sym++) {
+    uint32_t i = hashes[sym] & mask;
+    while (slots[i] != kNoSymbol)
+      i = (i + 1) & mask;
+    slots[i] = sym;
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef __SYMBOL_H__
+#define __SYMBOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// Handle to an interned string
+typedef uint32_t Symbol;
+
+/// Returned when a string has not been interned
+const Symbol kNoSymbol = 0xffffffff;
+
+/// Return a well-mixed hash of a symbol, for use in open-addressing tables
+inline uint32_t HashSymbol(Symbol s) {
+  return s * 2654435761u;
+}
+
+/// Stores exactly one copy of each distinct string and hands out small
+/// integer handles for them.
+///
+/// Lookup is by open addressing with linear probing over a power-of-two
+/// table. Interned strings never move, so pointers returned by Name() stay
+/// valid for the lifetime of the table.
+///
+/// @note Interning is not thread-safe. Lookups are safe to run concurrently
+/// as long as no thread is interning.
+class SymbolTable {
+ private:
+  deque<string> strings;    // interned strings, indexed by symbol
+  vector<uint32_t> hashes;  // hash of each interned string
+  vector<Symbol> slots;     // open-addressing table of symbols
+
+ public:
+  /// Initialize an empty table
+  SymbolTable();
+
+  /// Return the symbol for a string, adding it if not already present
+  Symbol Intern(const char *s);
+
+  /// Return the symbol for a string, or kNoSymbol if it was never interned
+  Symbol Find(const char *s) const;
+
+  /// Return the string a symbol stands for
+  const char *Name(Symbol s) const;
+
+  /// Return the number of interned strings
+  uint32_t Size() const;
+
+  /// Return the number of bytes used by the table
+  size_t MemoryBytes() const;
+
+  /// Return the table shared by all loaded clips
+  static SymbolTable &Shared();
+
+ private:
+  /// Double the number of slots and reinsert every symbol
+  void Grow();
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "./thread_pool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+    : task(NULL), count(0), batch(0), busy(0), exiting(false), next(0) {
+  if (numThreads == 0)
+    numThreads = thread::hardware_concurrency();
+  for (unsigned int i = 1; i < numThreads; i++)
+    workers.push_back(thread(&ThreadPool::WorkerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    unique_lock<mutex> guard(lock);
+    exiting = true;
+  }
+  wake.notify_all();
+  for (unsigned int i = 0; i < workers.size(); i++)
+    workers[i].join();
+}
+
+unsigned int ThreadPool::NumThreads() const {
+  return workers.size() + 1;
+}
+
+void ThreadPool::Work() {
+  for (uint32_t i = next++; i < count; i = next++)
+    (*task)(i);
+}
+
+void ThreadPool::WorkerLoop() {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      unique_lock<mutex> guard(lock);
+      while (!exiting && batch == seen)
+        wake.wait(guard);
+      if (exiting)
+        return;
+      seen = batch;
+    }
+
+    Work();
+
+    unique_lock<mutex> guard(lock);
+    if (--busy == 0)
+      done.notify_one();
+  }
+}
+
+/// A batch too small to share runs on the caller alone, without waking
+/// anyone.
+void ThreadPool::Run(uint32_t count, const function<void(uint32_t)> &task) {
+  if (workers.empty() || count <= 1) {
+    for (uint32_t i = 0; i < count; i++)
+      task(i);
+    return;
+  }
+
+  {
+    unique_lock<mutex> guard(lock);
+    this->task = &task;
+    this->count = count;
+    next = 0;
+    busy = workers.size();
+    batch++;
+  }
+  wake.notify_all();
+
+  Work();
+
+  unique_lock<mutex> guard(lock);
+  while (busy > 0)
+    done.wait(guard);
+  this->task = NULL;
+}
@@ -0,0 +1,58 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/// A fixed set of worker threads that run batches of independent tasks.
+///
+/// Workers sleep between batches, so running a batch every tick costs a
+/// wake-up rather than a thread launch. The calling thread works on the
+/// batch too, and tasks are handed out one index at a time, so uneven tasks
+/// balance themselves.
+class ThreadPool {
+ private:
+  vector<thread> workers;               // threads besides the caller
+  mutex lock;                           // guards the batch fields below
+  condition_variable wake;              // signals a new batch (or exit)
+  condition_variable done;              // signals the batch has finished
+  const function<void(uint32_t)> *task; // task of the current batch
+  uint32_t count;                       // number of tasks in the batch
+  uint64_t batch;                       // number of batches started
+  unsigned int busy;                    // workers still on the batch
+  bool exiting;                         // if true, workers should exit
+  atomic<uint32_t> next;                // next task index to hand out
+
+  ThreadPool(const ThreadPool &);
+  ThreadPool &operator=(const ThreadPool &);
+
+  /// Run tasks of the current batch until none are left
+  void Work();
+
+  /// Body of each worker thread
+  void WorkerLoop();
+
+ public:
+  /// Start a pool running batches on numThreads threads, including the
+  /// caller (0 uses one thread per hardware thread)
+  explicit ThreadPool(unsigned int numThreads = 0);
+
+  /// Stop and join every worker
+  ~ThreadPool();
+
+  /// Return the number of threads running a batch, including the caller
+  unsigned int NumThreads() const;
+
+  /// Call task(i) for every i in [0, count) and return once all calls have
+  /// finished. Only one thread may run batches on a pool at a time.
+  void Run(uint32_t count, const function<void(uint32_t)> &task);
+};
+
+#endif
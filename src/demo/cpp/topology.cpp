@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include <vector>
+
+#include "./skeleton.h"
+#include "./topology.h"
+
+using namespace std;
+
+constexpr int8_t CmuTopology::kParents[];
+constexpr uint8_t CmuTopology::kChannels[];
+
+/// A registered topology
+struct TopologyEntry {
+  bool (*matches)(const Skeleton &skeleton);
+  PoseEvaluator evaluator;
+};
+
+/// Return every registered topology, starting with the built-in ones
+static vector<TopologyEntry> &Topologies() {
+#if defined(__SSE2__)
+  static vector<TopologyEntry> topologies(1, TopologyEntry {
+      MatchesTopology<CmuTopology>, EvaluateTopology<CmuTopology>});
+#else
+  static vector<TopologyEntry> topologies;
+#endif
+  return topologies;
+}
+
+void RegisterTopology(bool (*matches)(const Skeleton &skeleton),
+                      PoseEvaluator evaluator) {
+  TopologyEntry entry = {matches, evaluator};
+  Topologies().push_back(entry);
+}
+
+PoseEvaluator FindPoseEvaluator(const Skeleton &skeleton) {
+  vector<TopologyEntry> &topologies = Topologies();
+  for (uint32_t i = 0; i < topologies.size(); i++) {
+    if (topologies[i].matches(skeleton))
+      return topologies[i].evaluator;
+  }
+  return NULL;
+}
@@ -0,0 +1,219 @@
+#ifndef __TOPOLOGY_H__
+#define __TOPOLOGY_H__
+
+#include <core/euler.h>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <stdint.h>
+#include <vector>
+
+#include "./skeleton.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Channels of a joint in a compile-time topology
+enum TopologyChannels {
+  TOPOLOGY_NONE,      // no channels (end sites)
+  TOPOLOGY_ROTATE,    // three rotations
+  TOPOLOGY_MOVE       // an XYZ position and three rotations (roots)
+};
+
+/// Axes of each rotation order, usable at compile time
+constexpr int kTopologyAxes[6][3] = {
+  {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+/// The skeleton of the CMU motion capture database: 31 joints and 7 end
+/// sites, every joint rotated Z, Y then X, and only the hips positioned.
+///
+/// A topology is a class with kNumJoints and constexpr Parent(j),
+/// Channels(j) and Order(j), listing joints in the order Skeleton
+/// flattens them (depth-first pre-order, first child first).
+struct CmuTopology {
+  static const int kNumJoints = 38;
+  static constexpr int8_t kParents[kNumJoints] = {
+    -1, 0, 1, 2, 3, 4, 5,             // Hips, left leg
+    0, 7, 8, 9, 10, 11,               // right leg
+    0, 13, 14, 15, 16, 17, 18,        // back, neck, head
+    15, 20, 21, 22, 23, 24, 25, 23, 27, // left arm
+    15, 29, 30, 31, 32, 33, 34, 32, 36  // right arm
+  };
+  static constexpr uint8_t kChannels[kNumJoints] = {  // TopologyChannels
+    2, 1, 1, 1, 1, 1, 0,
+    1, 1, 1, 1, 1, 0,
+    1, 1, 1, 1, 1, 1, 0,
+    1, 1, 1, 1, 1, 1, 0, 1, 0,
+    1, 1, 1, 1, 1, 1, 0, 1, 0
+  };
+
+  static constexpr int Parent(int j) { return kParents[j]; }
+  static constexpr TopologyChannels Channels(int j) {
+    return static_cast<TopologyChannels>(kChannels[j]);
+  }
+  static constexpr RotationOrder Order(int) { return ROT_ZYX; }
+};
+
+#if defined(__SSE2__)
+
+/// Return a row with every lane set to lane K of another
+template <int K>
+inline __m128 TopologyBroadcast(__m128 v) {
+  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(K, K, K, K));
+}
+
+/// Evaluate joint J of topology T and every joint after it. Each joint is
+/// its own instantiation, so the hierarchy and channel layout are constants
+/// the compiler folds into one straight-line kernel; only the frame, the
+/// offsets and folded channels are read at run time.
+///
+/// Transforms are kept as three SSE rows (rotation and translation), and
+/// each row of a world transform is the parent's row times the local rows,
+/// summed in the same order as Mul so results match the generic evaluator.
+///
+/// Levels of detail never increase from parent to child, so a joint dropped
+/// at a coarse level only has dropped descendants and is skipped outright.
+template <class T, int J, bool End = (J == T::kNumJoints)>
+struct TopologyJoint {
+  static inline void Evaluate(const Skeleton &skeleton, const float *frame,
+                              const float *s, const float *c, int lod,
+                              __m128 (*world)[3], Transform *out) {
+    if (lod > 0 && skeleton.lods[J] < lod) {
+      TopologyJoint<T, J + 1>::Evaluate(skeleton, frame, s, c, lod, world,
+                                        out);
+      return;
+    }
+
+    const ChannelLayout &layout = skeleton.channels[J];
+    __m128 local[3];
+
+    if (T::Channels(J) != TOPOLOGY_NONE && layout.fixed) {
+      // Nothing animated: use the precomputed bind transform
+      Matrix4x4 m = skeleton.bind[J].Matrix();
+      for (int i = 0; i < 3; i++)
+        local[i] = _mm_loadu_ps(m.m[i]);
+    } else {
+      const Vector &offset = skeleton.bindOffsets[J];
+      float t[3] = {offset.x, offset.y, offset.z};
+      if (T::Channels(J) == TOPOLOGY_MOVE) {
+        for (int i = 0; i < 3; i++) {
+          if (layout.storedPosition[i] >= 0)
+            t[i] += frame[layout.storedPosition[i]];
+        }
+      }
+
+      float r[3][3] = {{1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f}};
+      if (T::Channels(J) != TOPOLOGY_NONE) {
+        constexpr RotationOrder order = T::Order(J);
+        EulerRotation<kTopologyAxes[order][0], kTopologyAxes[order][1],
+                      kTopologyAxes[order][2]>(c + layout.angles,
+                                               s + layout.angles, r);
+      }
+      for (int i = 0; i < 3; i++)
+        local[i] = _mm_setr_ps(r[i][0], r[i][1], r[i][2], t[i]);
+    }
+
+    __m128 *w = world[J];
+    if (T::Parent(J) < 0) {
+      for (int i = 0; i < 3; i++)
+        w[i] = local[i];
+    } else {
+      const __m128 *p = world[T::Parent(J)];
+      const __m128 unit = _mm_setr_ps(0.f, 0.f, 0.f, 1.f);
+      for (int i = 0; i < 3; i++) {
+        __m128 sum = _mm_mul_ps(TopologyBroadcast<0>(p[i]), local[0]);
+        sum = _mm_add_ps(sum, _mm_mul_ps(TopologyBroadcast<1>(p[i]),
+                                         local[1]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(TopologyBroadcast<2>(p[i]),
+                                         local[2]));
+        w[i] = _mm_add_ps(sum, _mm_mul_ps(TopologyBroadcast<3>(p[i]), unit));
+      }
+    }
+
+    // The world transform is rigid, so its inverse is derived on demand
+    Matrix4x4 m;
+    for (int i = 0; i < 3; i++)
+      _mm_storeu_ps(m.m[i], w[i]);
+    out[J] = Rigid(m);
+
+    TopologyJoint<T, J + 1>::Evaluate(skeleton, frame, s, c, lod, world,
+                                      out);
+  }
+};
+
+/// Past the last joint: nothing left to evaluate
+template <class T, int J>
+struct TopologyJoint<T, J, true> {
+  static inline void Evaluate(const Skeleton &, const float *, const float *,
+                              const float *, int, __m128 (*)[3],
+                              Transform *) {}
+};
+
+/// Evaluate the joints of a skeleton with topology T kept at a level of
+/// detail (0 for every joint)
+template <class T>
+void EvaluateTopology(const Skeleton &skeleton, const float *frame, int lod,
+                      Transform *world) {
+  static thread_local vector<float> scratch;
+  const uint32_t n = skeleton.NumAngles();
+  if (scratch.size() < 2 * n + 1)
+    scratch.resize(2 * n + 1);
+
+  __m128 rows[T::kNumJoints][3];
+  if (lod > 0)
+    skeleton.SinCosAtLod(frame, lod, &scratch[0], &scratch[n]);
+  else
+    skeleton.SinCos(frame, 1, &scratch[0], &scratch[n]);
+  TopologyJoint<T, 0>::Evaluate(skeleton, frame, &scratch[0], &scratch[n],
+                                lod, rows, world);
+}
+
+#endif
+
+/// Return true if a skeleton has topology T: the same hierarchy, and the
+/// same channels and rotation order on every joint
+template <class T>
+bool MatchesTopology(const Skeleton &skeleton) {
+  if (skeleton.NumJoints() != static_cast<uint32_t>(T::kNumJoints))
+    return false;
+
+  for (int j = 0; j < T::kNumJoints; j++) {
+    const ChannelLayout &layout = skeleton.channels[j];
+    bool rotates = layout.rotation[0] >= 0;
+    bool moves = layout.position[0] >= 0 || layout.position[1] >= 0 ||
+        layout.position[2] >= 0;
+
+    if (skeleton.parents[j] != T::Parent(j) ||
+        rotates != (T::Channels(j) != TOPOLOGY_NONE) ||
+        moves != (T::Channels(j) == TOPOLOGY_MOVE) ||
+        (rotates && layout.rotationOrder != T::Order(j)))
+      return false;
+  }
+  return true;
+}
+
+/// Add a topology whose skeletons should use the specialized evaluator.
+/// Topologies must be registered before the skeletons using them are
+/// compiled; the CMU skeleton is registered already. Specialized evaluators
+/// need SSE2; without it every skeleton uses the generic one.
+void RegisterTopology(bool (*matches)(const Skeleton &skeleton),
+                      PoseEvaluator evaluator);
+
+#if defined(__SSE2__)
+/// Register topology T
+template <class T>
+void RegisterTopology() {
+  RegisterTopology(MatchesTopology<T>, EvaluateTopology<T>);
+}
+#endif
+
+/// Return the specialized evaluator for a skeleton's topology, or NULL if
+/// no registered topology matches
+PoseEvaluator FindPoseEvaluator(const Skeleton &skeleton);
+
+#endif
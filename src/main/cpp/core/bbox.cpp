@@ -1,6 +1,7 @@
 #include <core/bbox.h>
 #include <core/geometry.h>
 #include <core/common.h>
+#include <core/lanes.h>
 
 namespace ishi {
 
@@ -45,4 +46,42 @@ bool Overlaps(const BBox& b1, const BBox& b2) {
   return x && y && z;
 }
 
+/// Each lane keeps its own bounds, which are merged once at the end
+template <class T>
+static int BoundLanes(const PointArrays &p, int i, int n, BBox *b) {
+  const int w = T::kWidth;
+  if (i + w > n)
+    return i;
+
+  T lo[3] = {T(INFINITY), T(INFINITY), T(INFINITY)};
+  T hi[3] = {T(-INFINITY), T(-INFINITY), T(-INFINITY)};
+  const float *c[3] = {p.x, p.y, p.z};
+  for (; i + w <= n; i += w) {
+    for (int k = 0; k < 3; k++) {
+      T v = T::Load(c[k] + i);
+      lo[k] = Min(lo[k], v);
+      hi[k] = Max(hi[k], v);
+    }
+  }
+
+  float l[3][w], h[3][w];
+  for (int k = 0; k < 3; k++) {
+    lo[k].Store(l[k]);
+    hi[k].Store(h[k]);
+  }
+  for (int j = 0; j < w; j++) {
+    *b = Union(*b, Point(l[0][j], l[1][j], l[2][j]));
+    *b = Union(*b, Point(h[0][j], h[1][j], h[2][j]));
+  }
+  return i;
+}
+
+BBox Bounds(const PointArrays &p, int n) {
+  BBox b;
+  int i = BoundLanes<FloatN>(p, 0, n, &b);
+  for (; i < n; i++)
+    b = Union(b, Point(p.x[i], p.y[i], p.z[i]));
+  return b;
+}
+
 }  // namespace ishi
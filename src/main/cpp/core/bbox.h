@@ -30,6 +30,10 @@ BBox Union(const BBox &b1, const BBox &b2);
 /// Return true if two bounding boxes overlap, false otherwise
 bool Overlaps(const BBox &b1, const BBox &b2);
 
+/// Return the bounds of n points stored as arrays (a degenerate box if n is
+/// 0), several points at a time
+BBox Bounds(const PointArrays &p, int n);
+
 }  // namespace ishi
 
 #endif
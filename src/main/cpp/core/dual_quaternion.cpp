@@ -0,0 +1,115 @@
+#include <core/dual_quaternion.h>
+
+#include <core/lanes.h>
+#include <core/matrix.h>
+#include <core/quaternion.h>
+#include <core/transform.h>
+
+#include <core/point.h>
+#include <core/vector.h>
+
+namespace ishi {
+
+DualQuaternion::DualQuaternion() : real(), dual(0.f, 0.f, 0.f, 0.f) {}
+
+DualQuaternion::DualQuaternion(const Quaternion &q, const Vector &t)
+    : real(q), dual(Quaternion(0.f, t.x, t.y, t.z) * q * 0.5f) {}
+
+DualQuaternion::DualQuaternion(const Quaternion &r, const Quaternion &d)
+    : real(r), dual(d) {}
+
+DualQuaternion::DualQuaternion(const Transform &t) {
+  Matrix4x4 mat = t.Matrix();
+  *this = DualQuaternion(Quaternion(t),
+                         Vector(mat.m[0][3], mat.m[1][3], mat.m[2][3]));
+}
+
+/// (r1 + e d1) (r2 + e d2) = r1 r2 + e (r1 d2 + d1 r2), as e^2 = 0
+DualQuaternion DualQuaternion::operator*(const DualQuaternion &dq) const {
+  return DualQuaternion(real * dq.real, real * dq.dual + dual * dq.real);
+}
+
+DualQuaternion &DualQuaternion::operator*=(const DualQuaternion &dq) {
+  *this = *this * dq;
+  return *this;
+}
+
+bool DualQuaternion::operator==(const DualQuaternion &dq) const {
+  return real == dq.real && dual == dq.dual;
+}
+
+bool DualQuaternion::operator!=(const DualQuaternion &dq) const {
+  return !(*this == dq);
+}
+
+Point DualQuaternion::operator()(const Point &p) const {
+  return real(p) + Translation();
+}
+
+Vector DualQuaternion::operator()(const Vector &v) const {
+  return real(v);
+}
+
+/// t = 2 dual real*
+Vector DualQuaternion::Translation() const {
+  Quaternion t = dual * Conjugate(real);
+  return Vector(2.f * t.x, 2.f * t.y, 2.f * t.z);
+}
+
+Transform DualQuaternion::ToTransform() const {
+  return QuaternionTransform(real, Translation());
+}
+
+std::ostream &operator<<(std::ostream &out, const DualQuaternion &dq) {
+  out << "dq[" << dq.real << " " << dq.dual << "]";
+  return out;
+}
+
+DualQuaternion Inverse(const DualQuaternion &dq) {
+  return DualQuaternion(Conjugate(dq.real), Conjugate(dq.dual));
+}
+
+DualQuaternion Normalize(const DualQuaternion &dq) {
+  float f = 1.f / Length(dq.real);
+  Quaternion r = dq.real * f;
+  Quaternion d = dq.dual * f;
+  return DualQuaternion(r, d - r * Dot(r, d));
+}
+
+template <class T>
+static int MulDualQuaternionLanes(const DualQuaternionArrays &a,
+                                  const DualQuaternionArrays &b, int i,
+                                  int n, const DualQuaternionArrays &r) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T ar[4] = {T::Load(a.real.w + i), T::Load(a.real.x + i),
+               T::Load(a.real.y + i), T::Load(a.real.z + i)};
+    T ad[4] = {T::Load(a.dual.w + i), T::Load(a.dual.x + i),
+               T::Load(a.dual.y + i), T::Load(a.dual.z + i)};
+    T br[4] = {T::Load(b.real.w + i), T::Load(b.real.x + i),
+               T::Load(b.real.y + i), T::Load(b.real.z + i)};
+    T bd[4] = {T::Load(b.dual.w + i), T::Load(b.dual.x + i),
+               T::Load(b.dual.y + i), T::Load(b.dual.z + i)};
+    T rr[4], d0[4], d1[4];
+    QuaternionProduct(ar, br, rr);
+    QuaternionProduct(ar, bd, d0);
+    QuaternionProduct(ad, br, d1);
+    rr[0].Store(r.real.w + i);
+    rr[1].Store(r.real.x + i);
+    rr[2].Store(r.real.y + i);
+    rr[3].Store(r.real.z + i);
+    (d0[0] + d1[0]).Store(r.dual.w + i);
+    (d0[1] + d1[1]).Store(r.dual.x + i);
+    (d0[2] + d1[2]).Store(r.dual.y + i);
+    (d0[3] + d1[3]).Store(r.dual.z + i);
+  }
+  return i;
+}
+
+void MulDualQuaternions(const DualQuaternionArrays &a,
+                        const DualQuaternionArrays &b, int n,
+                        const DualQuaternionArrays &r) {
+  int i = MulDualQuaternionLanes<FloatN>(a, b, 0, n, r);
+  MulDualQuaternionLanes<Float1>(a, b, i, n, r);
+}
+
+}  // namespace ishi
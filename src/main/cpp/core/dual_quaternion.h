@@ -0,0 +1,93 @@
+#ifndef CORE_DUAL_QUATERNION_H_
+#define CORE_DUAL_QUATERNION_H_
+
+#include <core/quaternion.h>
+#include <core/transform.h>
+
+#include <iostream>
+
+namespace ishi {
+
+class Point;
+class Vector;
+
+/// A rigid transform stored as a unit dual quaternion real + e dual, where
+/// real is the rotation and dual = 0.5 (0, t) real encodes the translation
+/// t applied after it.
+///
+/// Eight floats instead of the twelve of a RigidTransform; a composition
+/// takes three quaternion products (48 multiplies) and the inverse of a
+/// unit dual quaternion is just its conjugate.
+class DualQuaternion {
+public:
+  /// Rotation part
+  Quaternion real;
+
+  /// Translation part
+  Quaternion dual;
+
+public:
+  /// Initialize the identity transform
+  DualQuaternion();
+
+  /// Initialize the transform Translate(t) * R(q)
+  DualQuaternion(const Quaternion &q, const Vector &t);
+
+  /// Initialize a dual quaternion using its real and dual parts
+  DualQuaternion(const Quaternion &r, const Quaternion &d);
+
+  /// Initialize the dual quaternion of a rigid transform
+  explicit DualQuaternion(const Transform &t);
+
+  /// Concatenate this and another transform, returning a new transform. As
+  /// with transforms, the right transform is applied first.
+  DualQuaternion operator*(const DualQuaternion &dq) const;
+
+  /// Concatenate this and another transform (in-place)
+  DualQuaternion &operator*=(const DualQuaternion &dq);
+
+  /// Return true if two DualQuaternions are identical (within 0.001)
+  bool operator==(const DualQuaternion &dq) const;
+
+  /// Return true if two DualQuaternions are not identical
+  bool operator!=(const DualQuaternion &dq) const;
+
+  /// Transform a point and return a new point
+  Point operator()(const Point &p) const;
+
+  /// Transform a vector (rotate only) and return a new vector
+  Vector operator()(const Vector &v) const;
+
+  /// Return the translation applied after the rotation
+  Vector Translation() const;
+
+  /// Return the transform as a Transform
+  Transform ToTransform() const;
+
+  /// Overload stream output operator
+  friend std::ostream& operator<< (std::ostream &out,
+                                   const DualQuaternion &dq);
+};
+
+/// Return the inverse of a unit dual quaternion
+DualQuaternion Inverse(const DualQuaternion &dq);
+
+/// Return a dual quaternion scaled to unit length, with its dual part made
+/// orthogonal to the real part so it is again a rigid transform
+DualQuaternion Normalize(const DualQuaternion &dq);
+
+/// Dual quaternions stored part by part and component by component
+/// (structure of arrays)
+struct DualQuaternionArrays {
+  QuaternionArrays real;
+  QuaternionArrays dual;
+};
+
+/// Compute r[i] = a[i] * b[i] for n dual quaternions. r may alias a or b.
+void MulDualQuaternions(const DualQuaternionArrays &a,
+                        const DualQuaternionArrays &b, int n,
+                        const DualQuaternionArrays &r);
+
+}  // namespace ishi
+
+#endif
@@ -0,0 +1,62 @@
+#include <core/euler.h>
+
+#include <core/common.h>
+#include <core/matrix.h>
+#include <core/transform.h>
+#include <core/vector.h>
+
+#include <cmath>
+
+namespace ishi {
+
+// Axes of each rotation order, indexed by RotationOrder
+static const int kRotationAxes[6][3] = {
+  {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+RotationOrder GetRotationOrder(int a0, int a1, int a2) {
+  Assert(a0 != a1 && a1 != a2 && a0 != a2);
+  for (int i = 0; i < 6; i++) {
+    if (kRotationAxes[i][0] == a0 && kRotationAxes[i][1] == a1 &&
+        kRotationAxes[i][2] == a2)
+      return static_cast<RotationOrder>(i);
+  }
+  return ROT_XYZ;
+}
+
+int RotationAxis(RotationOrder order, int i) {
+  return kRotationAxes[order][i];
+}
+
+void EulerRotation(RotationOrder order, const float c[3], const float s[3],
+                   float r[3][3]) {
+  switch (order) {
+    case ROT_XYZ: EulerRotation<0, 1, 2>(c, s, r); break;
+    case ROT_XZY: EulerRotation<0, 2, 1>(c, s, r); break;
+    case ROT_YXZ: EulerRotation<1, 0, 2>(c, s, r); break;
+    case ROT_YZX: EulerRotation<1, 2, 0>(c, s, r); break;
+    case ROT_ZXY: EulerRotation<2, 0, 1>(c, s, r); break;
+    case ROT_ZYX: EulerRotation<2, 1, 0>(c, s, r); break;
+  }
+}
+
+/// The transform is rigid, so its inverse is only derived if it is used
+Transform EulerTransform(RotationOrder order, const float c[3],
+                         const float s[3], const Vector &t) {
+  float r[3][3];
+  EulerRotation(order, c, s, r);
+
+  Matrix4x4 mat = Matrix4x4(r[0][0], r[0][1], r[0][2], t.x,
+                            r[1][0], r[1][1], r[1][2], t.y,
+                            r[2][0], r[2][1], r[2][2], t.z,
+                            0.f, 0.f, 0.f, 1.f);
+  return Rigid(mat);
+}
+
+Transform EulerTransform(RotationOrder order, float a0, float a1, float a2) {
+  float c[3] = {std::cos(a0), std::cos(a1), std::cos(a2)};
+  float s[3] = {std::sin(a0), std::sin(a1), std::sin(a2)};
+  return EulerTransform(order, c, s, Vector());
+}
+
+}  // namespace ishi
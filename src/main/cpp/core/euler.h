@@ -0,0 +1,79 @@
+#ifndef CORE_EULER_H_
+#define CORE_EULER_H_
+
+#include <core/transform.h>
+
+namespace ishi {
+
+class Vector;
+
+/// Order in which three rotations about the principal axes are composed.
+/// Axes are named left to right as they appear in the matrix product, which
+/// is also the order they are listed in a BVH CHANNELS line: ROT_ZYX means
+/// RotateZ(a0) * RotateY(a1) * RotateX(a2).
+enum RotationOrder {
+  ROT_XYZ, ROT_XZY, ROT_YXZ, ROT_YZX, ROT_ZXY, ROT_ZYX
+};
+
+/// Return the rotation order for three distinct axes (0 = X, 1 = Y, 2 = Z)
+RotationOrder GetRotationOrder(int a0, int a1, int a2);
+
+/// Return the axis (0 = X, 1 = Y, 2 = Z) at position i of a rotation order
+int RotationAxis(RotationOrder order, int i);
+
+/// Set a 3x3 matrix to a rotation about one axis, given the cosine and sine
+/// of the angle. T is float or any lane type from core/lanes.h, in which
+/// case each lane holds an independent rotation.
+template <int Axis, class T>
+inline void SetAxisRotation(T r[3][3], T c, T s) {
+  // The columns that rotate into each other: (1, 2) for X, (2, 0) for Y
+  // and (0, 1) for Z
+  const int u = (Axis + 1) % 3;
+  const int v = (Axis + 2) % 3;
+  r[Axis][Axis] = T(1.f);
+  r[Axis][u] = r[Axis][v] = r[u][Axis] = r[v][Axis] = T(0.f);
+  r[u][u] = c; r[u][v] = -s;
+  r[v][u] = s; r[v][v] = c;
+}
+
+/// Multiply a 3x3 matrix on the right by a rotation about one axis.
+/// Only the two columns spanning the plane of rotation change, so this
+/// takes 12 multiplies instead of the 27 of a full product.
+template <int Axis, class T>
+inline void ApplyAxisRotation(T r[3][3], T c, T s) {
+  const int u = (Axis + 1) % 3;
+  const int v = (Axis + 2) % 3;
+  for (int i = 0; i < 3; i++) {
+    T ru = r[i][u], rv = r[i][v];
+    r[i][u] = c * ru + s * rv;
+    r[i][v] = c * rv - s * ru;
+  }
+}
+
+/// Compute Ra0 * Ra1 * Ra2 for a fixed order of axes, given the cosines and
+/// sines of the three angles. The axes are compile-time constants, so each
+/// order compiles to one straight-line kernel.
+template <int A0, int A1, int A2, class T>
+inline void EulerRotation(const T c[3], const T s[3], T r[3][3]) {
+  SetAxisRotation<A0>(r, c[0], s[0]);
+  ApplyAxisRotation<A1>(r, c[1], s[1]);
+  ApplyAxisRotation<A2>(r, c[2], s[2]);
+}
+
+/// Compute the rotation for any order, given the cosines and sines of the
+/// three angles
+void EulerRotation(RotationOrder order, const float c[3], const float s[3],
+                   float r[3][3]);
+
+/// Return the rigid transform Translate(t) * Ra0 * Ra1 * Ra2, given the
+/// cosines and sines of the three angles. The transform is rigid, so its
+/// inverse is derived in closed form if it is ever used.
+Transform EulerTransform(RotationOrder order, const float c[3],
+                         const float s[3], const Vector &t);
+
+/// Return the rotation Ra0(a0) * Ra1(a1) * Ra2(a2), with angles in radian
+Transform EulerTransform(RotationOrder order, float a0, float a1, float a2);
+
+}  // namespace ishi
+
+#endif
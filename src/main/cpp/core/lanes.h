@@ -0,0 +1,144 @@
+#ifndef CORE_LANES_H_
+#define CORE_LANES_H_
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace ishi {
+
+/// A group of floats processed in lock step. Kernels written against the
+/// lane interface (arithmetic operators, Sqrt, Rsqrt, Abs, Sign, Min, Max,
+/// Load and Store) compile to scalar, SSE or AVX code depending on the lane
+/// type they are instantiated with.
+///
+/// Rsqrt is an approximate 1 / Sqrt, within about 1e-6 relative error on
+/// wider lanes: the hardware estimate refined by one Newton-Raphson step.
+///
+/// Float1 is the portable fallback and is also used for leftover elements
+/// that do not fill a whole group.
+struct Float1 {
+  static const int kWidth = 1;
+  float v;
+
+  Float1() {}
+  Float1(float f) : v(f) {}
+
+  static Float1 Load(const float *p) { return Float1(*p); }
+  void Store(float *p) const { *p = v; }
+};
+
+inline Float1 operator+(Float1 a, Float1 b) { return Float1(a.v + b.v); }
+inline Float1 operator-(Float1 a, Float1 b) { return Float1(a.v - b.v); }
+inline Float1 operator*(Float1 a, Float1 b) { return Float1(a.v * b.v); }
+inline Float1 operator/(Float1 a, Float1 b) { return Float1(a.v / b.v); }
+inline Float1 operator-(Float1 a) { return Float1(-a.v); }
+inline Float1 Sqrt(Float1 a) { return Float1(std::sqrt(a.v)); }
+inline Float1 Abs(Float1 a) { return Float1(std::fabs(a.v)); }
+inline Float1 Sign(Float1 a) { return Float1(std::copysign(1.f, a.v)); }
+inline Float1 Rsqrt(Float1 a) { return Float1(1.f / std::sqrt(a.v)); }
+inline Float1 Min(Float1 a, Float1 b) { return a.v < b.v ? a : b; }
+inline Float1 Max(Float1 a, Float1 b) { return a.v > b.v ? a : b; }
+
+#if defined(__SSE2__)
+
+/// Four floats in an SSE register
+struct Float4 {
+  static const int kWidth = 4;
+  __m128 v;
+
+  Float4() {}
+  Float4(float f) : v(_mm_set1_ps(f)) {}
+  Float4(__m128 m) : v(m) {}
+
+  static Float4 Load(const float *p) { return Float4(_mm_loadu_ps(p)); }
+  void Store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a) {
+  return _mm_xor_ps(a.v, _mm_set1_ps(-0.f));
+}
+inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+inline Float4 Abs(Float4 a) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v);
+}
+inline Float4 Sign(Float4 a) {
+  return _mm_or_ps(_mm_and_ps(a.v, _mm_set1_ps(-0.f)), _mm_set1_ps(1.f));
+}
+inline Float4 Rsqrt(Float4 a) {
+  Float4 r = _mm_rsqrt_ps(a.v);
+  return r * (Float4(1.5f) - Float4(0.5f) * a * r * r);
+}
+inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+
+#endif
+
+#if defined(__AVX__)
+
+/// Eight floats in an AVX register
+struct Float8 {
+  static const int kWidth = 8;
+  __m256 v;
+
+  Float8() {}
+  Float8(float f) : v(_mm256_set1_ps(f)) {}
+  Float8(__m256 m) : v(m) {}
+
+  static Float8 Load(const float *p) { return Float8(_mm256_loadu_ps(p)); }
+  void Store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline Float8 operator+(Float8 a, Float8 b) {
+  return _mm256_add_ps(a.v, b.v);
+}
+inline Float8 operator-(Float8 a, Float8 b) {
+  return _mm256_sub_ps(a.v, b.v);
+}
+inline Float8 operator*(Float8 a, Float8 b) {
+  return _mm256_mul_ps(a.v, b.v);
+}
+inline Float8 operator/(Float8 a, Float8 b) {
+  return _mm256_div_ps(a.v, b.v);
+}
+inline Float8 operator-(Float8 a) {
+  return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f));
+}
+inline Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a.v); }
+inline Float8 Abs(Float8 a) {
+  return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v);
+}
+inline Float8 Sign(Float8 a) {
+  return _mm256_or_ps(_mm256_and_ps(a.v, _mm256_set1_ps(-0.f)),
+                      _mm256_set1_ps(1.f));
+}
+inline Float8 Rsqrt(Float8 a) {
+  Float8 r = _mm256_rsqrt_ps(a.v);
+  return r * (Float8(1.5f) - Float8(0.5f) * a * r * r);
+}
+inline Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a.v, b.v); }
+inline Float8 Max(Float8 a, Float8 b) { return _mm256_max_ps(a.v, b.v); }
+
+#endif
+
+/// The widest lane type the build targets
+#if defined(__AVX__)
+typedef Float8 FloatN;
+#elif defined(__SSE2__)
+typedef Float4 FloatN;
+#else
+typedef Float1 FloatN;
+#endif
+
+}  // namespace ishi
+
+#endif
@@ -1,28 +1,9 @@
-#include <core/math.h>
+#include <core/lanes.h>
 #include <core/matrix.h>
 
-namespace ishi {
-
-void swap_row(float (*m)[4][8], int r1, int r2) {
-  float t;
-  for (int j = 0; j < 8; j++) {
-    t = (*m)[r1][j];
-    (*m)[r1][j] = (*m)[r2][j];
-    (*m)[r2][j] = t;
-  }
-}
+#include <cmath>
 
-void scale_row(float (*m)[4][8], int r, float f) {
-  for (int j = 0; j < 8; j++) {
-    (*m)[r][j] = (*m)[r][j] * f;
-  }
-}
-
-void add_row(float (*m)[4][8], int from, int to, float f) {
-  for (int j = 0; j < 8; j++) {
-    (*m)[to][j] = (*m)[to][j] + (*m)[from][j] * f;
-  }
-}
+namespace ishi {
 
 Matrix4x4::Matrix4x4() {
   m[0][0] = 1.f;
@@ -108,56 +89,147 @@ bool Matrix4x4::operator!=(const Matrix4x4 &mat) const {
   return !(*this == mat);
 }
 
-/// This implementation uses the Gauss-Jordan elimination routine for
-/// numerical stability
-Matrix4x4 Inverse(const Matrix4x4 &mat) {
-  Matrix4x4 I = Matrix4x4();
-  float matI[4][8];
-
-  // Augment matrix with the identity matrix
-  for (int i = 0; i < 4; i++) {
-    for (int j = 0; j < 4; j++) {
-      matI[i][j] = mat.m[i][j];
-      matI[i][j + 4] = I.m[i][j];
-    }
+/// Below this ratio of the determinant to the product of the row lengths
+/// (1 for a rotation, whatever the scale of each row), a single-precision
+/// inverse is meaningless and the matrix is treated as singular
+static const double kSingularRatio = 1e-6;
+
+/// Below this ratio, the inverse is computed but may have lost most of its
+/// precision
+static const double kIllConditionedRatio = 1e-3;
+
+/// The adjugate (transposed cofactors) of a matrix, one matrix per lane,
+/// with elements a[4 * i + j]. The cofactors are built from the 2x2
+/// determinants of the top two rows (s) and bottom two rows (c), which
+/// also give the determinant by Laplace expansion.
+template <class T>
+static inline void Adjugate(const T *a, T *r, T *det) {
+  T s0 = a[0] * a[5] - a[4] * a[1];
+  T s1 = a[0] * a[6] - a[4] * a[2];
+  T s2 = a[0] * a[7] - a[4] * a[3];
+  T s3 = a[1] * a[6] - a[5] * a[2];
+  T s4 = a[1] * a[7] - a[5] * a[3];
+  T s5 = a[2] * a[7] - a[6] * a[3];
+
+  T c5 = a[10] * a[15] - a[14] * a[11];
+  T c4 = a[9] * a[15] - a[13] * a[11];
+  T c3 = a[9] * a[14] - a[13] * a[10];
+  T c2 = a[8] * a[15] - a[12] * a[11];
+  T c1 = a[8] * a[14] - a[12] * a[10];
+  T c0 = a[8] * a[13] - a[12] * a[9];
+
+  *det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+  r[0] = a[5] * c5 - a[6] * c4 + a[7] * c3;
+  r[1] = a[2] * c4 - a[1] * c5 - a[3] * c3;
+  r[2] = a[13] * s5 - a[14] * s4 + a[15] * s3;
+  r[3] = a[10] * s4 - a[9] * s5 - a[11] * s3;
+
+  r[4] = a[6] * c2 - a[4] * c5 - a[7] * c1;
+  r[5] = a[0] * c5 - a[2] * c2 + a[3] * c1;
+  r[6] = a[14] * s2 - a[12] * s5 - a[15] * s1;
+  r[7] = a[8] * s5 - a[10] * s2 + a[11] * s1;
+
+  r[8] = a[4] * c4 - a[5] * c2 + a[7] * c0;
+  r[9] = a[1] * c2 - a[0] * c4 - a[3] * c0;
+  r[10] = a[12] * s4 - a[13] * s2 + a[15] * s0;
+  r[11] = a[9] * s2 - a[8] * s4 - a[11] * s0;
+
+  r[12] = a[5] * c1 - a[4] * c3 - a[6] * c0;
+  r[13] = a[0] * c3 - a[1] * c1 + a[2] * c0;
+  r[14] = a[13] * s1 - a[12] * s3 - a[14] * s0;
+  r[15] = a[8] * s3 - a[9] * s1 + a[10] * s0;
+}
+
+/// Classify a matrix from its determinant. By Hadamard's inequality, the
+/// determinant is at most the product of the row lengths, with equality
+/// for orthogonal rows; how far below it falls estimates how close the rows
+/// are to being dependent. An affine matrix (bottom row 0 0 0 1) has the
+/// determinant of its 3x3 linear part, which is what is measured: its
+/// translation has no bearing on how well it inverts, but would dominate
+/// the row lengths. The products are formed in double so rows of any
+/// magnitude neither overflow nor underflow.
+static InverseStatus Classify(const Matrix4x4 &mat, float det) {
+  if (!(std::fabs(det) > 0.f) || !std::isfinite(det))
+    return INVERSE_SINGULAR;
+
+  bool affine = mat.m[3][0] == 0.f && mat.m[3][1] == 0.f &&
+      mat.m[3][2] == 0.f && mat.m[3][3] == 1.f;
+  int size = affine ? 3 : 4;
+
+  double lengths = 1.0;
+  for (int i = 0; i < size; i++) {
+    double row = 0.0;
+    for (int j = 0; j < size; j++)
+      row += static_cast<double>(mat.m[i][j]) * mat.m[i][j];
+    lengths *= row;
   }
 
-  // Perform elementary row operations on the matrix until it reaches
-  // reduced row echelon form.
-  // Reduced row echelon form:
-  // - all rows of all zeroes, if any, are at the bottom of the matrix
-  // - every leading coefficient is 1 and is the only nonzero entry in its column
-  for (int i = 0; i < 4; i++) {
-    // Make sure the ith value in the ith row is not 0
-    if (feq(matI[i][i], 0.0f)) {
-      for (int k = i; k < 4; k++) {
-        if (!feq(matI[k][i], 0.0f)) {
-          swap_row(&matI, i, k);
-          break;
-        }
-      }
-    }
+  double ratio = static_cast<double>(det) * det / lengths;
+  if (ratio < kSingularRatio * kSingularRatio)
+    return INVERSE_SINGULAR;
+  if (ratio < kIllConditionedRatio * kIllConditionedRatio)
+    return INVERSE_ILL_CONDITIONED;
+  return INVERSE_OK;
+}
 
-    // TODO: if matrix is singular, the next statement will divide by 0
+/// Groups of T::kWidth matrices are transposed into one lane per matrix,
+/// inverted together, and written back one at a time once classified.
+template <class T>
+static int InverseLanes(const Matrix4x4 *mat, int i, int n, Matrix4x4 *inv,
+                        InverseStatus *status, int *singular) {
+  const int w = T::kWidth;
+  float a[16][w], r[16][w], d[w];
 
-    // Scale the ith row so the ith value is 1
-    if (!feq(matI[i][i], 1.0f)) {
-      scale_row(&matI, i, 1 / matI[i][i]);
-    }
+  for (; i + w <= n; i += w) {
+    for (int k = 0; k < w; k++)
+      for (int e = 0; e < 16; e++)
+        a[e][k] = mat[i + k].m[e / 4][e % 4];
+
+    T in[16], out[16], det;
+    for (int e = 0; e < 16; e++)
+      in[e] = T::Load(a[e]);
+    Adjugate(in, out, &det);
+    T f = T(1.f) / det;
+    for (int e = 0; e < 16; e++)
+      (out[e] * f).Store(r[e]);
+    det.Store(d);
 
-    // Zero out the ith value in all the other rows
-    for (int j = 0; j < 4; j++) {
-      if (j != i) {
-        add_row(&matI, i, j, -matI[j][i]);
+    for (int k = 0; k < w; k++) {
+      InverseStatus s = Classify(mat[i + k], d[k]);
+      if (status)
+        status[i + k] = s;
+      if (s == INVERSE_SINGULAR) {
+        (*singular)++;
+        continue;
       }
+      for (int e = 0; e < 16; e++)
+        inv[i + k].m[e / 4][e % 4] = r[e][k];
     }
   }
+  return i;
+}
+
+InverseStatus Inverse(const Matrix4x4 &mat, Matrix4x4 *inv) {
+  InverseStatus status;
+  int singular = 0;
+  InverseLanes<Float1>(&mat, 0, 1, inv, &status, &singular);
+  return status;
+}
 
-  // Extract and return matrix
-  return Matrix4x4(matI[0][4], matI[0][5], matI[0][6], matI[0][7],
-                   matI[1][4], matI[1][5], matI[1][6], matI[1][7],
-                   matI[2][4], matI[2][5], matI[2][6], matI[2][7],
-                   matI[3][4], matI[3][5], matI[3][6], matI[3][7]);
+int InverseMatrices(const Matrix4x4 *mat, int n, Matrix4x4 *inv,
+                    InverseStatus *status) {
+  int singular = 0;
+  int i = InverseLanes<FloatN>(mat, 0, n, inv, status, &singular);
+  InverseLanes<Float1>(mat, i, n, inv, status, &singular);
+  return singular;
+}
+
+/// A singular matrix leaves inv as the identity
+Matrix4x4 Inverse(const Matrix4x4 &mat) {
+  Matrix4x4 inv;
+  Inverse(mat, &inv);
+  return inv;
 }
 
 Matrix4x4 Transpose(const Matrix4x4 &mat) {
@@ -167,19 +239,85 @@ Matrix4x4 Transpose(const Matrix4x4 &mat) {
                    mat.m[0][3], mat.m[1][3], mat.m[2][3], mat.m[3][3]);
 }
 
-Matrix4x4 Mul(const Matrix4x4 &m1, const Matrix4x4 &m2) {
-  Matrix4x4 r;
-
+/// Row i of the product is the sum of the rows of m2 weighted by the
+/// elements of row i of m1. Each row is summed in the same order whatever
+/// the lane width, so every path gives the same result.
+template <class T>
+static inline void MulRows(const Matrix4x4 &m1, const Matrix4x4 &m2,
+                           Matrix4x4 *r) {
   for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      r.m[i][j] = m1.m[i][0] * m2.m[0][j] +
-          m1.m[i][1] * m2.m[1][j] +
-          m1.m[i][2] * m2.m[2][j] +
-          m1.m[i][3] * m2.m[3][j];
+    for (int j = 0; j < 4; j += T::kWidth) {
+      T row = T(m1.m[i][0]) * T::Load(&m2.m[0][j]) +
+          T(m1.m[i][1]) * T::Load(&m2.m[1][j]) +
+          T(m1.m[i][2]) * T::Load(&m2.m[2][j]) +
+          T(m1.m[i][3]) * T::Load(&m2.m[3][j]);
+      row.Store(&r->m[i][j]);
     }
   }
+}
+
+#if defined(__AVX__)
+
+/// With AVX, two rows of the product are computed at once: each half of a
+/// register holds one row of m1, whose elements are broadcast within their
+/// half, against a row of m2 repeated in both halves.
+static inline void MulRowPairs(const Matrix4x4 &m1, const Matrix4x4 &m2,
+                               Matrix4x4 *r) {
+  __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[0]));
+  __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[1]));
+  __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[2]));
+  __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[3]));
+
+  for (int i = 0; i < 4; i += 2) {
+    __m256 a = _mm256_loadu_ps(m1.m[i]);
+    __m256 row = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), b0);
+    row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x55), b1));
+    row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xaa), b2));
+    row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xff), b3));
+    _mm256_storeu_ps(r->m[i], row);
+  }
+}
 
+#endif
+
+/// Multiply into a result that must not be either input
+static inline void MulInto(const Matrix4x4 &m1, const Matrix4x4 &m2,
+                           Matrix4x4 *r) {
+#if defined(__AVX__)
+  MulRowPairs(m1, m2, r);
+#elif defined(__SSE2__)
+  MulRows<Float4>(m1, m2, r);
+#else
+  MulRows<Float1>(m1, m2, r);
+#endif
+}
+
+Matrix4x4 Mul(const Matrix4x4 &m1, const Matrix4x4 &m2) {
+  Matrix4x4 r;
+  MulInto(m1, m2, &r);
   return r;
 }
 
+void MulMatrices(const Matrix4x4 *a, const Matrix4x4 *b, int n,
+                 Matrix4x4 *r) {
+  Matrix4x4 t;
+  for (int i = 0; i < n; i++) {
+    MulInto(a[i], b[i], &t);
+    r[i] = t;
+  }
+}
+
+void MulMatrixChain(const Matrix4x4 *local, const int32_t *parents, int n,
+                    Matrix4x4 *r) {
+  Matrix4x4 t;
+  for (int i = 0; i < n; i++) {
+    if (parents[i] < 0) {
+      r[i] = local[i];
+    } else {
+      MulInto(r[parents[i]], local[i], &t);
+      r[i] = t;
+    }
+  }
+}
+
 }  // namespace ishi
@@ -1,14 +1,14 @@
 #ifndef CORE_MATRIX_H_
 #define CORE_MATRIX_H_
 
-namespace ishi {
+#include <stddef.h>
+#include <stdint.h>
 
-// Low-level matrix elementary row operations
-void swap_row(float (*m)[4][8], int r1, int r2);
-void scale_row(float (*m)[4][8], int r, float f);
-void add_row(float (*m)[4][8], int from, int to, float f);
+namespace ishi {
 
-struct Matrix4x4 {
+/// A 4x4 matrix stored row after row. Matrices are 16-byte aligned, so
+/// each row fills one SSE register.
+struct alignas(16) Matrix4x4 {
 public:
   float m[4][4];
 
@@ -35,12 +35,47 @@ public:
 /// Return the transpose of the matrix
 Matrix4x4 Transpose(const Matrix4x4 &mat);
 
-/// Return the inverse of the matrix
+/// Result of inverting a matrix
+enum InverseStatus {
+  INVERSE_OK,               // the inverse is accurate
+  INVERSE_ILL_CONDITIONED,  // the inverse was computed but the rows are
+                            // nearly dependent, so it may be inaccurate
+  INVERSE_SINGULAR          // the matrix has no usable inverse
+};
+
+/// Return the inverse of the matrix.
+///
+/// A singular matrix has no inverse, and this returns the identity for it
+/// without any other signal. The identity is then not an inverse, so code
+/// that may see singular matrices (scales of zero, degenerate bases) must
+/// use the overload returning a status instead.
 Matrix4x4 Inverse(const Matrix4x4 &mat);
 
+/// Compute the inverse of the matrix in closed form, from its cofactors,
+/// into inv. If the matrix is singular, inv is left untouched.
+InverseStatus Inverse(const Matrix4x4 &mat, Matrix4x4 *inv);
+
+/// Invert an array of matrices, several at a time. inv may be mat. The
+/// status of each matrix is written to status unless it is NULL, and
+/// singular matrices are left untouched in inv. Returns the number of
+/// singular matrices.
+int InverseMatrices(const Matrix4x4 *mat, int n, Matrix4x4 *inv,
+                    InverseStatus *status = NULL);
+
 /// Multiply two matrices, returning a new matrix
 Matrix4x4 Mul(const Matrix4x4 &m1, const Matrix4x4 &m2);
 
+/// Multiply arrays of matrices pairwise: r[i] = a[i] b[i]. The result may
+/// overwrite either input.
+void MulMatrices(const Matrix4x4 *a, const Matrix4x4 *b, int n,
+                 Matrix4x4 *r);
+
+/// Compose matrices down a hierarchy: r[i] = r[parents[i]] local[i], or
+/// local[i] where parents[i] is negative. Every parent must come before its
+/// children (e.g. the joints of a skeleton). The result may overwrite local.
+void MulMatrixChain(const Matrix4x4 *local, const int32_t *parents, int n,
+                    Matrix4x4 *r);
+
 }  // namespace ishi
 
 #endif
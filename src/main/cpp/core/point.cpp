@@ -1,6 +1,7 @@
 #include <core/point.h>
 #include <core/vector.h>
 #include <core/common.h>
+#include <core/lanes.h>
 
 namespace ishi {
 
@@ -80,4 +81,77 @@ float Distance(const Point &p1, const Point &p2) {
   return Length(p2-p1);
 }
 
+/// Load the i-th group of T::kWidth points or vectors
+template <class T, class A>
+static inline void LoadLanes(const A &a, int i, T r[3]) {
+  r[0] = T::Load(a.x + i);
+  r[1] = T::Load(a.y + i);
+  r[2] = T::Load(a.z + i);
+}
+
+/// Store the i-th group of T::kWidth points or vectors
+template <class T, class A>
+static inline void StoreLanes(const T v[3], int i, const A &r) {
+  v[0].Store(r.x + i);
+  v[1].Store(r.y + i);
+  v[2].Store(r.z + i);
+}
+
+template <class T>
+static int TranslatePointLanes(const PointArrays &p, const VectorArrays &v,
+                               int i, int n, const PointArrays &r) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T vp[3], vv[3];
+    LoadLanes(p, i, vp);
+    LoadLanes(v, i, vv);
+    T vr[3] = {vp[0] + vv[0], vp[1] + vv[1], vp[2] + vv[2]};
+    StoreLanes(vr, i, r);
+  }
+  return i;
+}
+
+void TranslatePoints(const PointArrays &p, const VectorArrays &v, int n,
+                     const PointArrays &r) {
+  int i = TranslatePointLanes<FloatN>(p, v, 0, n, r);
+  TranslatePointLanes<Float1>(p, v, i, n, r);
+}
+
+template <class T>
+static int SubtractPointLanes(const PointArrays &a, const PointArrays &b,
+                              int i, int n, const VectorArrays &r) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T va[3], vb[3];
+    LoadLanes(a, i, va);
+    LoadLanes(b, i, vb);
+    T vr[3] = {va[0] - vb[0], va[1] - vb[1], va[2] - vb[2]};
+    StoreLanes(vr, i, r);
+  }
+  return i;
+}
+
+void SubtractPoints(const PointArrays &a, const PointArrays &b, int n,
+                    const VectorArrays &r) {
+  int i = SubtractPointLanes<FloatN>(a, b, 0, n, r);
+  SubtractPointLanes<Float1>(a, b, i, n, r);
+}
+
+template <class T>
+static int DistancePointLanes(const PointArrays &a, const PointArrays &b,
+                              int i, int n, float *d) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T va[3], vb[3];
+    LoadLanes(a, i, va);
+    LoadLanes(b, i, vb);
+    T dx = vb[0] - va[0], dy = vb[1] - va[1], dz = vb[2] - va[2];
+    Sqrt(dx * dx + dy * dy + dz * dz).Store(d + i);
+  }
+  return i;
+}
+
+void DistancePoints(const PointArrays &a, const PointArrays &b, int n,
+                    float *d) {
+  int i = DistancePointLanes<FloatN>(a, b, 0, n, d);
+  DistancePointLanes<Float1>(a, b, i, n, d);
+}
+
 }  // namespace ishi
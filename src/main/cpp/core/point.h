@@ -4,6 +4,7 @@
 namespace ishi {
 
 class Vector;
+struct VectorArrays;
 
 class Point {
  public:
@@ -58,6 +59,27 @@ Point operator*(float f, const Point &p);
 /// Return the distance between two points
 float Distance(const Point &p1, const Point &p2);
 
+/// Points stored component by component (structure of arrays): the i-th
+/// point is (x[i], y[i], z[i]). As with VectorArrays, batch functions work
+/// on whole lanes and their results may overwrite their inputs.
+struct PointArrays {
+  float *x;
+  float *y;
+  float *z;
+};
+
+/// Compute r[i] = p[i] + v[i] for n points
+void TranslatePoints(const PointArrays &p, const VectorArrays &v, int n,
+                     const PointArrays &r);
+
+/// Compute r[i] = a[i] - b[i], the vectors from b[i] to a[i], for n points
+void SubtractPoints(const PointArrays &a, const PointArrays &b, int n,
+                    const VectorArrays &r);
+
+/// Compute d[i] = Distance(a[i], b[i]) for n points
+void DistancePoints(const PointArrays &a, const PointArrays &b, int n,
+                    float *d);
+
 }  // namespace ishi
 
 #endif
@@ -0,0 +1,331 @@
+#include <core/quaternion.h>
+
+#include <core/common.h>
+#include <core/euler.h>
+#include <core/lanes.h>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <core/point.h>
+#include <core/vector.h>
+
+namespace ishi {
+
+Quaternion::Quaternion() : w(1.f), x(0.f), y(0.f), z(0.f) {}
+
+Quaternion::Quaternion(float ww, float xx, float yy, float zz)
+    : w(ww), x(xx), y(yy), z(zz) {}
+
+/// Shepperd's method: the largest of w, x, y and z is recovered from the
+/// diagonal first, so the division is always by a value of at least 1/2
+Quaternion::Quaternion(const Transform &t) {
+  Matrix4x4 mat = t.Matrix();
+  const float (*r)[4] = mat.m;
+  float trace = r[0][0] + r[1][1] + r[2][2];
+
+  if (trace > 0.f) {
+    float f = 0.5f / std::sqrt(trace + 1.f);
+    w = 0.25f / f;
+    x = (r[2][1] - r[1][2]) * f;
+    y = (r[0][2] - r[2][0]) * f;
+    z = (r[1][0] - r[0][1]) * f;
+  } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+    float f = 0.5f / std::sqrt(1.f + r[0][0] - r[1][1] - r[2][2]);
+    w = (r[2][1] - r[1][2]) * f;
+    x = 0.25f / f;
+    y = (r[0][1] + r[1][0]) * f;
+    z = (r[0][2] + r[2][0]) * f;
+  } else if (r[1][1] > r[2][2]) {
+    float f = 0.5f / std::sqrt(1.f + r[1][1] - r[0][0] - r[2][2]);
+    w = (r[0][2] - r[2][0]) * f;
+    x = (r[0][1] + r[1][0]) * f;
+    y = 0.25f / f;
+    z = (r[1][2] + r[2][1]) * f;
+  } else {
+    float f = 0.5f / std::sqrt(1.f + r[2][2] - r[0][0] - r[1][1]);
+    w = (r[1][0] - r[0][1]) * f;
+    x = (r[0][2] + r[2][0]) * f;
+    y = (r[1][2] + r[2][1]) * f;
+    z = 0.25f / f;
+  }
+}
+
+Quaternion Quaternion::operator*(const Quaternion &q) const {
+  float a[4] = {w, x, y, z};
+  float b[4] = {q.w, q.x, q.y, q.z};
+  float r[4];
+  QuaternionProduct(a, b, r);
+  return Quaternion(r[0], r[1], r[2], r[3]);
+}
+
+Quaternion &Quaternion::operator*=(const Quaternion &q) {
+  *this = *this * q;
+  return *this;
+}
+
+Quaternion Quaternion::operator*(float f) const {
+  return Quaternion(w * f, x * f, y * f, z * f);
+}
+
+Quaternion Quaternion::operator+(const Quaternion &q) const {
+  return Quaternion(w + q.w, x + q.x, y + q.y, z + q.z);
+}
+
+Quaternion Quaternion::operator-(const Quaternion &q) const {
+  return Quaternion(w - q.w, x - q.x, y - q.y, z - q.z);
+}
+
+Quaternion Quaternion::operator-() const {
+  return Quaternion(-w, -x, -y, -z);
+}
+
+bool Quaternion::operator==(const Quaternion &q) const {
+  return ((w - q.w > -0.001) && (w - q.w < 0.001) &&
+          (x - q.x > -0.001) && (x - q.x < 0.001) &&
+          (y - q.y > -0.001) && (y - q.y < 0.001) &&
+          (z - q.z > -0.001) && (z - q.z < 0.001));
+}
+
+bool Quaternion::operator!=(const Quaternion &q) const {
+  return !(*this == q);
+}
+
+/// v' = v + 2w (u x v) + 2 u x (u x v), where u = (x, y, z): 15
+/// multiplies, against 27 for forming the matrix and applying it
+Vector Quaternion::operator()(const Vector &v) const {
+  float tx = 2.f * (y * v.z - z * v.y);
+  float ty = 2.f * (z * v.x - x * v.z);
+  float tz = 2.f * (x * v.y - y * v.x);
+  return Vector(v.x + w * tx + (y * tz - z * ty),
+                v.y + w * ty + (z * tx - x * tz),
+                v.z + w * tz + (x * ty - y * tx));
+}
+
+Point Quaternion::operator()(const Point &p) const {
+  Vector v = (*this)(Vector(p.x, p.y, p.z));
+  return Point(v.x, v.y, v.z);
+}
+
+Matrix4x4 Quaternion::Matrix() const {
+  float q[4] = {w, x, y, z};
+  float r[3][3];
+  QuaternionRotation(q, r);
+  return Matrix4x4(r[0][0], r[0][1], r[0][2], 0.f,
+                   r[1][0], r[1][1], r[1][2], 0.f,
+                   r[2][0], r[2][1], r[2][2], 0.f,
+                   0.f, 0.f, 0.f, 1.f);
+}
+
+std::ostream &operator<<(std::ostream &out, const Quaternion &q) {
+  out << "q[" << q.w << " " << q.x << " " << q.y << " " << q.z << "]";
+  return out;
+}
+
+Quaternion operator*(float f, const Quaternion &q) {
+  return q * f;
+}
+
+float Dot(const Quaternion &q1, const Quaternion &q2) {
+  return q1.w * q2.w + q1.x * q2.x + q1.y * q2.y + q1.z * q2.z;
+}
+
+float Length(const Quaternion &q) {
+  return std::sqrt(Dot(q, q));
+}
+
+Quaternion Normalize(const Quaternion &q) {
+  return q * (1.f / Length(q));
+}
+
+Quaternion Conjugate(const Quaternion &q) {
+  return Quaternion(q.w, -q.x, -q.y, -q.z);
+}
+
+Quaternion AxisAngle(const Vector &axis, float angle) {
+  Vector a = Normalize(axis);
+  float s = std::sin(0.5f * angle);
+  return Quaternion(std::cos(0.5f * angle), a.x * s, a.y * s, a.z * s);
+}
+
+/// Nearly parallel quaternions fall back to Nlerp, where sin(theta) would
+/// lose all precision
+Quaternion Slerp(float t, const Quaternion &q1, const Quaternion &q2) {
+  float cosTheta = Dot(q1, q2);
+  Quaternion q = q2;
+  if (cosTheta < 0.f) {
+    cosTheta = -cosTheta;
+    q = -q2;
+  }
+  if (cosTheta > 0.9995f)
+    return Normalize(q1 * (1.f - t) + q * t);
+
+  float theta = std::acos(cosTheta);
+  float invSin = 1.f / std::sin(theta);
+  return q1 * (std::sin((1.f - t) * theta) * invSin) +
+      q * (std::sin(t * theta) * invSin);
+}
+
+Quaternion Nlerp(float t, const Quaternion &q1, const Quaternion &q2) {
+  Quaternion q = (Dot(q1, q2) < 0.f) ? -q2 : q2;
+  return Normalize(q1 * (1.f - t) + q * t);
+}
+
+Transform QuaternionTransform(const Quaternion &q, const Vector &t) {
+  Matrix4x4 mat = q.Matrix();
+  mat.m[0][3] = t.x;
+  mat.m[1][3] = t.y;
+  mat.m[2][3] = t.z;
+  return Rigid(mat);
+}
+
+Quaternion EulerQuaternion(RotationOrder order, const float c[3],
+                           const float s[3]) {
+  // An order out of range gives the identity
+  float q[4] = {1.f, 0.f, 0.f, 0.f};
+  switch (order) {
+    case ROT_XYZ: EulerQuaternion<0, 1, 2>(c, s, q); break;
+    case ROT_XZY: EulerQuaternion<0, 2, 1>(c, s, q); break;
+    case ROT_YXZ: EulerQuaternion<1, 0, 2>(c, s, q); break;
+    case ROT_YZX: EulerQuaternion<1, 2, 0>(c, s, q); break;
+    case ROT_ZXY: EulerQuaternion<2, 0, 1>(c, s, q); break;
+    case ROT_ZYX: EulerQuaternion<2, 1, 0>(c, s, q); break;
+  }
+  return Quaternion(q[0], q[1], q[2], q[3]);
+}
+
+Quaternion EulerQuaternion(RotationOrder order, float a0, float a1,
+                           float a2) {
+  float c[3] = {std::cos(0.5f * a0), std::cos(0.5f * a1),
+                std::cos(0.5f * a2)};
+  float s[3] = {std::sin(0.5f * a0), std::sin(0.5f * a1),
+                std::sin(0.5f * a2)};
+  return EulerQuaternion(order, c, s);
+}
+
+/// For R = Ri(a0) Rj(a1) Rk(a2), sin(a1) is +/-r[i][k], and a0 and a2
+/// follow from the rest of row i and column k. The signs flip with the
+/// parity of the order (even when j follows i cyclically).
+void EulerAngles(const Quaternion &q, RotationOrder order, float a[3]) {
+  int i = RotationAxis(order, 0);
+  int j = RotationAxis(order, 1);
+  int k = RotationAxis(order, 2);
+  float sign = (j == (i + 1) % 3) ? 1.f : -1.f;
+
+  float v[4] = {q.w, q.x, q.y, q.z};
+  float r[3][3];
+  QuaternionRotation(v, r);
+
+  float s1 = Clamp(sign * r[i][k], -1.f, 1.f);
+  a[1] = std::asin(s1);
+  if (std::fabs(s1) < 0.9999f) {
+    a[0] = std::atan2(-sign * r[j][k], r[k][k]);
+    a[2] = std::atan2(-sign * r[i][j], r[i][i]);
+  } else {
+    // Gimbal lock: only a0 + a2 (or a0 - a2) is defined
+    a[0] = std::atan2(sign * r[k][j], r[j][j]);
+    a[2] = 0.f;
+  }
+}
+
+/// Kernel over whole lanes of structure-of-arrays quaternions, with a
+/// scalar pass for the leftovers
+template <class T>
+static int MulQuaternionLanes(const QuaternionArrays &a,
+                              const QuaternionArrays &b, int i, int n,
+                              const QuaternionArrays &r) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T qa[4] = {T::Load(a.w + i), T::Load(a.x + i), T::Load(a.y + i),
+               T::Load(a.z + i)};
+    T qb[4] = {T::Load(b.w + i), T::Load(b.x + i), T::Load(b.y + i),
+               T::Load(b.z + i)};
+    T qr[4];
+    QuaternionProduct(qa, qb, qr);
+    qr[0].Store(r.w + i);
+    qr[1].Store(r.x + i);
+    qr[2].Store(r.y + i);
+    qr[3].Store(r.z + i);
+  }
+  return i;
+}
+
+void MulQuaternions(const QuaternionArrays &a, const QuaternionArrays &b,
+                    int n, const QuaternionArrays &r) {
+  int i = MulQuaternionLanes<FloatN>(a, b, 0, n, r);
+  MulQuaternionLanes<Float1>(a, b, i, n, r);
+}
+
+void NormalizeQuaternions(const QuaternionArrays &q, int n) {
+  for (int i = 0; i < n; i++) {
+    float f = 1.f / std::sqrt(q.w[i] * q.w[i] + q.x[i] * q.x[i] +
+                              q.y[i] * q.y[i] + q.z[i] * q.z[i]);
+    q.w[i] *= f;
+    q.x[i] *= f;
+    q.y[i] *= f;
+    q.z[i] *= f;
+  }
+}
+
+template <class T>
+static int SlerpQuaternionLanes(float t, const QuaternionArrays &a,
+                                const QuaternionArrays &b, int i, int n,
+                                const QuaternionArrays &r) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T qa[4] = {T::Load(a.w + i), T::Load(a.x + i), T::Load(a.y + i),
+               T::Load(a.z + i)};
+    T qb[4] = {T::Load(b.w + i), T::Load(b.x + i), T::Load(b.y + i),
+               T::Load(b.z + i)};
+    T qr[4];
+    QuaternionSlerp(T(t), qa, qb, qr);
+    qr[0].Store(r.w + i);
+    qr[1].Store(r.x + i);
+    qr[2].Store(r.y + i);
+    qr[3].Store(r.z + i);
+  }
+  return i;
+}
+
+void SlerpQuaternions(float t, const QuaternionArrays &a,
+                      const QuaternionArrays &b, int n,
+                      const QuaternionArrays &r) {
+  int i = SlerpQuaternionLanes<FloatN>(t, a, b, 0, n, r);
+  SlerpQuaternionLanes<Float1>(t, a, b, i, n, r);
+}
+
+template <int A0, int A1, int A2, class T>
+static int EulerQuaternionLanes(const float *const c[3],
+                                const float *const s[3], int i, int n,
+                                const QuaternionArrays &q) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T ct[3] = {T::Load(c[0] + i), T::Load(c[1] + i), T::Load(c[2] + i)};
+    T st[3] = {T::Load(s[0] + i), T::Load(s[1] + i), T::Load(s[2] + i)};
+    T qt[4];
+    EulerQuaternion<A0, A1, A2>(ct, st, qt);
+    qt[0].Store(q.w + i);
+    qt[1].Store(q.x + i);
+    qt[2].Store(q.y + i);
+    qt[3].Store(q.z + i);
+  }
+  return i;
+}
+
+template <int A0, int A1, int A2>
+static void EulerQuaternions(const float *const c[3], const float *const s[3],
+                             int n, const QuaternionArrays &q) {
+  int i = EulerQuaternionLanes<A0, A1, A2, FloatN>(c, s, 0, n, q);
+  EulerQuaternionLanes<A0, A1, A2, Float1>(c, s, i, n, q);
+}
+
+void EulerQuaternions(RotationOrder order, const float *const c[3],
+                      const float *const s[3], int n,
+                      const QuaternionArrays &q) {
+  switch (order) {
+    case ROT_XYZ: EulerQuaternions<0, 1, 2>(c, s, n, q); break;
+    case ROT_XZY: EulerQuaternions<0, 2, 1>(c, s, n, q); break;
+    case ROT_YXZ: EulerQuaternions<1, 0, 2>(c, s, n, q); break;
+    case ROT_YZX: EulerQuaternions<1, 2, 0>(c, s, n, q); break;
+    case ROT_ZXY: EulerQuaternions<2, 0, 1>(c, s, n, q); break;
+    case ROT_ZYX: EulerQuaternions<2, 1, 0>(c, s, n, q); break;
+  }
+}
+
+}  // namespace ishi
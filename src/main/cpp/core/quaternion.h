@@ -0,0 +1,229 @@
+#ifndef CORE_QUATERNION_H_
+#define CORE_QUATERNION_H_
+
+#include <core/euler.h>
+#include <core/lanes.h>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <iostream>
+
+namespace ishi {
+
+class Point;
+class Vector;
+
+/// A rotation stored as a unit quaternion w + xi + yj + zk.
+///
+/// Four floats instead of the nine of a rotation matrix, and a product of
+/// two rotations takes 16 multiplies instead of 27 (64 for a Matrix4x4).
+/// q and -q are the same rotation.
+class Quaternion {
+public:
+  /// Quaternion components
+  float w, x, y, z;
+
+public:
+  /// Initialize the identity rotation
+  Quaternion();
+
+  /// Initialize a quaternion using its components
+  Quaternion(float ww, float xx, float yy, float zz);
+
+  /// Initialize the quaternion of the rotation part of a rigid transform
+  explicit Quaternion(const Transform &t);
+
+  /// Compose this and another rotation (Hamilton product), returning a new
+  /// quaternion. As with transforms, the right rotation is applied first.
+  Quaternion operator*(const Quaternion &q) const;
+
+  /// Compose this and another rotation (in-place)
+  Quaternion &operator*=(const Quaternion &q);
+
+  /// Multiply with scalar and return new Quaternion
+  Quaternion operator*(float f) const;
+
+  /// Add to another Quaternion and return a new Quaternion
+  Quaternion operator+(const Quaternion &q) const;
+
+  /// Subtract another Quaternion and return a new Quaternion
+  Quaternion operator-(const Quaternion &q) const;
+
+  /// Return the additive inverse (the same rotation)
+  Quaternion operator-() const;
+
+  /// Return true if two Quaternions are identical (within 0.001)
+  bool operator==(const Quaternion &q) const;
+
+  /// Return true if two Quaternions are not identical
+  bool operator!=(const Quaternion &q) const;
+
+  /// Rotate a vector and return a new vector
+  Vector operator()(const Vector &v) const;
+
+  /// Rotate a point about the origin and return a new point
+  Point operator()(const Point &p) const;
+
+  /// Return the rotation as a 4x4 matrix
+  Matrix4x4 Matrix() const;
+
+  /// Overload stream output operator
+  friend std::ostream& operator<< (std::ostream &out, const Quaternion &q);
+};
+
+/// Multiply with a scalar and return new Quaternion (when scalar comes
+/// first)
+Quaternion operator*(float f, const Quaternion &q);
+
+/// Return the dot product of two quaternions
+float Dot(const Quaternion &q1, const Quaternion &q2);
+
+/// Return the length of a quaternion
+float Length(const Quaternion &q);
+
+/// Return a quaternion scaled to unit length
+Quaternion Normalize(const Quaternion &q);
+
+/// Return the conjugate of a quaternion, which is the inverse rotation of a
+/// unit quaternion
+Quaternion Conjugate(const Quaternion &q);
+
+/// Return a rotation by an angle (in radian) around an axis
+Quaternion AxisAngle(const Vector &axis, float angle);
+
+/// Interpolate along the shortest arc between two unit quaternions, at a
+/// constant angular rate (t = 0 gives q1, t = 1 gives q2)
+Quaternion Slerp(float t, const Quaternion &q1, const Quaternion &q2);
+
+/// Interpolate linearly between two unit quaternions along the shortest
+/// arc and normalize. Cheaper than Slerp, but not at a constant rate.
+Quaternion Nlerp(float t, const Quaternion &q1, const Quaternion &q2);
+
+/// Return the rigid transform Translate(t) * R(q)
+Transform QuaternionTransform(const Quaternion &q, const Vector &t);
+
+/// Return the rotation Ra0 * Ra1 * Ra2 as a quaternion, given the cosines
+/// and sines of the three half angles
+Quaternion EulerQuaternion(RotationOrder order, const float c[3],
+                           const float s[3]);
+
+/// Return the rotation Ra0(a0) * Ra1(a1) * Ra2(a2), with angles in radian
+Quaternion EulerQuaternion(RotationOrder order, float a0, float a1,
+                           float a2);
+
+/// Compute the angles (in radian) of a rotation decomposed in a rotation
+/// order, so EulerQuaternion(order, a[0], a[1], a[2]) gives the rotation
+/// back. The middle angle is in [-pi/2, pi/2]; when it is at either end the
+/// decomposition is not unique, and the last angle is set to 0.
+void EulerAngles(const Quaternion &q, RotationOrder order, float a[3]);
+
+/// Quaternions stored component by component (structure of arrays): the
+/// i-th quaternion is (w[i], x[i], y[i], z[i]). Batch functions read and
+/// write whole lanes of each array at once.
+struct QuaternionArrays {
+  float *w;
+  float *x;
+  float *y;
+  float *z;
+};
+
+/// Compute r[i] = a[i] * b[i] for n quaternions. r may alias a or b.
+void MulQuaternions(const QuaternionArrays &a, const QuaternionArrays &b,
+                    int n, const QuaternionArrays &r);
+
+/// Scale n quaternions to unit length (in-place)
+void NormalizeQuaternions(const QuaternionArrays &q, int n);
+
+/// Interpolate n pairs of unit quaternions at the same t, as with Slerp
+/// (see QuaternionSlerp for the accuracy). r may alias a or b.
+void SlerpQuaternions(float t, const QuaternionArrays &a,
+                      const QuaternionArrays &b, int n,
+                      const QuaternionArrays &r);
+
+/// Compute the rotations Ra0 * Ra1 * Ra2 of n sets of angles in one rotation
+/// order, given the cosines and sines of the half angles: c[k][i] and
+/// s[k][i] are for angle k of rotation i.
+void EulerQuaternions(RotationOrder order, const float *const c[3],
+                      const float *const s[3], int n,
+                      const QuaternionArrays &q);
+
+/// Compute r = a * b for quaternions stored as {w, x, y, z}. T is float or
+/// any lane type from core/lanes.h, in which case each lane holds an
+/// independent quaternion.
+template <class T>
+inline void QuaternionProduct(const T a[4], const T b[4], T r[4]) {
+  T w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+  T x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+  T y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+  T z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+  r[0] = w; r[1] = x; r[2] = y; r[3] = z;
+}
+
+/// Multiply a quaternion {w, x, y, z} on the right by a rotation about one
+/// axis, given the cosine and sine of the half angle. Only three products
+/// per component are needed, as the axis quaternion has two zero terms.
+template <int Axis, class T>
+inline void ApplyAxisQuaternion(T q[4], T c, T s) {
+  const int u = (Axis + 1) % 3;
+  const int v = (Axis + 2) % 3;
+  T w = q[0], qa = q[1 + Axis], qu = q[1 + u], qv = q[1 + v];
+  q[0] = c * w - s * qa;
+  q[1 + Axis] = c * qa + s * w;
+  q[1 + u] = c * qu + s * qv;
+  q[1 + v] = c * qv - s * qu;
+}
+
+/// Compute Ra0 * Ra1 * Ra2 as a quaternion {w, x, y, z} for a fixed order
+/// of axes, given the cosines and sines of the three half angles
+template <int A0, int A1, int A2, class T>
+inline void EulerQuaternion(const T c[3], const T s[3], T q[4]) {
+  q[0] = c[0];
+  q[1] = q[2] = q[3] = T(0.f);
+  q[1 + A0] = s[0];
+  ApplyAxisQuaternion<A1>(q, c[1], s[1]);
+  ApplyAxisQuaternion<A2>(q, c[2], s[2]);
+}
+
+/// Interpolate between two unit quaternions {w, x, y, z} along the
+/// shortest arc at a nearly constant rate, without trigonometry: Nlerp at
+/// a parameter corrected by a cubic in t whose coefficients are fitted to
+/// the angle between the quaternions. The result is within 0.0005 of Slerp
+/// for any pair, and matches it exactly at t = 0, 1/2 and 1. T is a lane
+/// type from core/lanes.h.
+template <class T>
+inline void QuaternionSlerp(T t, const T a[4], const T b[4], T r[4]) {
+  T dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+  T d = Abs(dot);
+  T ka = T(1.0904f) + d * (T(-3.2452f) + d * (T(3.55645f) -
+                                             d * T(1.43519f)));
+  T kb = T(0.848013f) + d * (T(-1.06021f) + d * T(0.215638f));
+  T h = t - T(0.5f);
+  T u = t + t * h * (t - T(1.f)) * (ka * h * h + kb);
+
+  T wa = T(1.f) - u;
+  T wb = Sign(dot) * u;
+  T q[4];
+  for (int i = 0; i < 4; i++)
+    q[i] = wa * a[i] + wb * b[i];
+  T f = T(1.f) / Sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (int i = 0; i < 4; i++)
+    r[i] = q[i] * f;
+}
+
+/// Set a 3x3 matrix to the rotation of a unit quaternion {w, x, y, z}
+template <class T>
+inline void QuaternionRotation(const T q[4], T r[3][3]) {
+  T x2 = q[1] + q[1], y2 = q[2] + q[2], z2 = q[3] + q[3];
+  T xx = q[1] * x2, yy = q[2] * y2, zz = q[3] * z2;
+  T xy = q[1] * y2, xz = q[1] * z2, yz = q[2] * z2;
+  T wx = q[0] * x2, wy = q[0] * y2, wz = q[0] * z2;
+  T one = T(1.f);
+
+  r[0][0] = one - (yy + zz); r[0][1] = xy - wz; r[0][2] = xz + wy;
+  r[1][0] = xy + wz; r[1][1] = one - (xx + zz); r[1][2] = yz - wx;
+  r[2][0] = xz - wy; r[2][1] = yz + wx; r[2][2] = one - (xx + yy);
+}
+
+}  // namespace ishi
+
+#endif
@@ -0,0 +1,142 @@
+#include <core/rigid.h>
+
+#include <core/lanes.h>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <core/point.h>
+#include <core/vector.h>
+
+namespace ishi {
+
+RigidTransform::RigidTransform() {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++)
+      m[i][j] = (i == j) ? 1.f : 0.f;
+  }
+}
+
+RigidTransform::RigidTransform(const Matrix4x4 &mat) {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++)
+      m[i][j] = mat.m[i][j];
+  }
+}
+
+RigidTransform::RigidTransform(const Transform &t) {
+  Matrix4x4 mat = t.Matrix();
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++)
+      m[i][j] = mat.m[i][j];
+  }
+}
+
+Point RigidTransform::operator()(const Point &p) const {
+  float x = p.x, y = p.y, z = p.z;
+  return Point(m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3],
+               m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3],
+               m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3]);
+}
+
+Vector RigidTransform::operator()(const Vector &v) const {
+  float x = v.x, y = v.y, z = v.z;
+  return Vector(m[0][0] * x + m[0][1] * y + m[0][2] * z,
+                m[1][0] * x + m[1][1] * y + m[1][2] * z,
+                m[2][0] * x + m[2][1] * y + m[2][2] * z);
+}
+
+Point& RigidTransform::Apply(Point *p) const {
+  *p = (*this)(*p);
+  return *p;
+}
+
+Vector& RigidTransform::Apply(Vector *v) const {
+  *v = (*this)(*v);
+  return *v;
+}
+
+/// R^T (p - t), without forming the inverse
+Point RigidTransform::Invert(const Point &p) const {
+  float x = p.x - m[0][3], y = p.y - m[1][3], z = p.z - m[2][3];
+  return Point(m[0][0] * x + m[1][0] * y + m[2][0] * z,
+               m[0][1] * x + m[1][1] * y + m[2][1] * z,
+               m[0][2] * x + m[1][2] * y + m[2][2] * z);
+}
+
+Vector RigidTransform::Invert(const Vector &v) const {
+  float x = v.x, y = v.y, z = v.z;
+  return Vector(m[0][0] * x + m[1][0] * y + m[2][0] * z,
+                m[0][1] * x + m[1][1] * y + m[2][1] * z,
+                m[0][2] * x + m[1][2] * y + m[2][2] * z);
+}
+
+/// [R1 | t1] [R2 | t2] = [R1 R2 | R1 t2 + t1]. With SSE each row of the
+/// result is one combination of the rows of t2, with t1 added through the
+/// implicit bottom row [0 0 0 1]; the sums are formed in the same order as
+/// the scalar loop, so both give identical results.
+RigidTransform RigidTransform::operator*(const RigidTransform &t2) const {
+  RigidTransform r;
+#if defined(__SSE2__)
+  Float4 b0 = Float4::Load(t2.m[0]);
+  Float4 b1 = Float4::Load(t2.m[1]);
+  Float4 b2 = Float4::Load(t2.m[2]);
+  Float4 b3 = _mm_set_ps(1.f, 0.f, 0.f, 0.f);
+  for (int i = 0; i < 3; i++) {
+    Float4 row = Float4(m[i][0]) * b0 + Float4(m[i][1]) * b1 +
+        Float4(m[i][2]) * b2 + Float4(m[i][3]) * b3;
+    row.Store(r.m[i]);
+  }
+#else
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      r.m[i][j] = m[i][0] * t2.m[0][j] + m[i][1] * t2.m[1][j] +
+          m[i][2] * t2.m[2][j];
+    }
+    r.m[i][3] += m[i][3];
+  }
+#endif
+  return r;
+}
+
+RigidTransform& RigidTransform::operator*=(const RigidTransform &t2) {
+  *this = *this * t2;
+  return *this;
+}
+
+bool RigidTransform::operator==(const RigidTransform &t2) const {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      if (m[i][j] != t2.m[i][j])
+        return false;
+    }
+  }
+  return true;
+}
+
+bool RigidTransform::operator!=(const RigidTransform &t2) const {
+  return !(*this == t2);
+}
+
+Matrix4x4 RigidTransform::Matrix() const {
+  return Matrix4x4(m[0][0], m[0][1], m[0][2], m[0][3],
+                   m[1][0], m[1][1], m[1][2], m[1][3],
+                   m[2][0], m[2][1], m[2][2], m[2][3],
+                   0.f, 0.f, 0.f, 1.f);
+}
+
+Transform RigidTransform::ToTransform() const {
+  return Rigid(Matrix());
+}
+
+RigidTransform Inverse(const RigidTransform &t) {
+  RigidTransform r;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++)
+      r.m[i][j] = t.m[j][i];
+    r.m[i][3] = -(t.m[0][i] * t.m[0][3] + t.m[1][i] * t.m[1][3] +
+                  t.m[2][i] * t.m[2][3]);
+  }
+  return r;
+}
+
+}  // namespace ishi
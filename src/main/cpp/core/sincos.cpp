@@ -0,0 +1,105 @@
+#include <core/sincos.h>
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ishi {
+
+// Minimax coefficients on [-pi/4, pi/4] (from Cephes sinf/cosf)
+static const float kSin1 = -1.6666654611e-1f;
+static const float kSin2 = 8.3321608736e-3f;
+static const float kSin3 = -1.9515295891e-4f;
+static const float kCos1 = 4.166664568298827e-2f;
+static const float kCos2 = -1.388731625493765e-3f;
+static const float kCos3 = 2.443315711809948e-5f;
+
+static const float kDegToRad = 0.017453292519943295f;
+static const float kInv90 = 1.f / 90.f;
+
+/// Evaluate one angle. The reduction r = d - 90 q is exact because q * 90
+/// needs at most 24 bits for the supported range and is close to d.
+static inline void SinCosDegree(float d, float *s, float *c) {
+  float q = std::floor(d * kInv90 + 0.5f);
+  float x = (d - q * 90.f) * kDegToRad;
+  float x2 = x * x;
+
+  float ps = x + x * x2 * (kSin1 + x2 * (kSin2 + x2 * kSin3));
+  float pc = 1.f - 0.5f * x2 + x2 * x2 * (kCos1 + x2 * (kCos2 + x2 * kCos3));
+
+  // Rotate the result by the quadrant
+  switch (static_cast<int>(q) & 3) {
+    case 0: *s = ps;  *c = pc;  break;
+    case 1: *s = pc;  *c = -ps; break;
+    case 2: *s = -ps; *c = -pc; break;
+    case 3: *s = -pc; *c = ps;  break;
+  }
+}
+
+#if defined(__SSE2__)
+
+/// Evaluate four angles at once, with the same arithmetic as SinCosDegree
+static inline void SinCosDegree4(const float *d, float *s, float *c) {
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 signBit = _mm_set1_ps(-0.f);
+
+  __m128 deg = _mm_loadu_ps(d);
+
+  // Round to the nearest quadrant (floor of x + 0.5, as in the scalar path)
+  __m128 t = _mm_add_ps(_mm_mul_ps(deg, _mm_set1_ps(kInv90)), half);
+  __m128i qi = _mm_cvttps_epi32(t);
+  __m128 qf = _mm_cvtepi32_ps(qi);
+  __m128 adjust = _mm_cmpgt_ps(qf, t);
+  qf = _mm_sub_ps(qf, _mm_and_ps(adjust, one));
+  qi = _mm_sub_epi32(qi, _mm_and_si128(_mm_castps_si128(adjust),
+                                       _mm_set1_epi32(1)));
+
+  __m128 x = _mm_mul_ps(_mm_sub_ps(deg, _mm_mul_ps(qf, _mm_set1_ps(90.f))),
+                        _mm_set1_ps(kDegToRad));
+  __m128 x2 = _mm_mul_ps(x, x);
+
+  __m128 ps = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(kSin3)),
+                         _mm_set1_ps(kSin2));
+  ps = _mm_add_ps(_mm_mul_ps(x2, ps), _mm_set1_ps(kSin1));
+  ps = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), ps));
+
+  __m128 pc = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(kCos3)),
+                         _mm_set1_ps(kCos2));
+  pc = _mm_add_ps(_mm_mul_ps(x2, pc), _mm_set1_ps(kCos1));
+  pc = _mm_add_ps(_mm_sub_ps(one, _mm_mul_ps(half, x2)),
+                  _mm_mul_ps(_mm_mul_ps(x2, x2), pc));
+
+  // Odd quadrants swap sine and cosine; quadrants 2 and 3 negate the sine,
+  // quadrants 1 and 2 negate the cosine
+  __m128i q1 = _mm_and_si128(qi, _mm_set1_epi32(1));
+  __m128i q2 = _mm_and_si128(qi, _mm_set1_epi32(2));
+  __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(q1, _mm_set1_epi32(1)));
+  __m128 sinNeg = _mm_castsi128_ps(_mm_slli_epi32(q2, 30));
+  __m128 cosNeg = _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_xor_si128(q2, _mm_slli_epi32(q1, 1)), 30));
+
+  __m128 rs = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+  __m128 rc = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+  rs = _mm_xor_ps(rs, _mm_and_ps(sinNeg, signBit));
+  rc = _mm_xor_ps(rc, _mm_and_ps(cosNeg, signBit));
+
+  _mm_storeu_ps(s, rs);
+  _mm_storeu_ps(c, rc);
+}
+
+#endif
+
+void SinCosDegrees(const float *degrees, int n, float *s, float *c) {
+  int i = 0;
+#if defined(__SSE2__)
+  for (; i + 4 <= n; i += 4)
+    SinCosDegree4(degrees + i, s + i, c + i);
+#endif
+  for (; i < n; i++)
+    SinCosDegree(degrees[i], s + i, c + i);
+}
+
+}  // namespace ishi
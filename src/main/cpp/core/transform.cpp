@@ -1,6 +1,7 @@
 #include <core/transform.h>
 
 #include <core/common.h>
+#include <core/lanes.h>
 #include <core/matrix.h>
 
 #include <core/point.h>
@@ -9,14 +10,45 @@
 
 namespace ishi {
 
+/// Return the inverse [R^T | -R^T t] of a rigid matrix [R | t]
+static Matrix4x4 RigidInverse(const Matrix4x4& mat) {
+  const float (*r)[4] = mat.m;
+  return Matrix4x4(
+      r[0][0], r[1][0], r[2][0],
+      -(r[0][0] * r[0][3] + r[1][0] * r[1][3] + r[2][0] * r[2][3]),
+      r[0][1], r[1][1], r[2][1],
+      -(r[0][1] * r[0][3] + r[1][1] * r[1][3] + r[2][1] * r[2][3]),
+      r[0][2], r[1][2], r[2][2],
+      -(r[0][2] * r[0][3] + r[1][2] * r[1][3] + r[2][2] * r[2][3]),
+      0.f, 0.f, 0.f, 1.f);
+}
+
 Transform::Transform()
-    : m(Matrix4x4()), mInv(Matrix4x4()) {}
+    : m(Matrix4x4()), mInv(Matrix4x4()), rigid(true), hasInverse(true),
+      status(INVERSE_OK) {}
 
 Transform::Transform(const Matrix4x4& mat)
-    : m(mat), mInv(Inverse(mat)) {}
+    : m(mat), rigid(false), hasInverse(false), status(INVERSE_OK) {}
 
 Transform::Transform(const Matrix4x4& mat, const Matrix4x4& matInv)
-    : m(mat), mInv(matInv) {}
+    : m(mat), mInv(matInv), rigid(false), hasInverse(true),
+      status(INVERSE_OK) {}
+
+/// Only general transforms come here: rigid ones derive their inverse in
+/// place, so that they never write the cache and can be shared by threads
+const Matrix4x4& Transform::InverseMatrix() const {
+  if (!hasInverse) {
+    mInv = Matrix4x4();
+    status = Inverse(m, &mInv);
+    hasInverse = true;
+  }
+  return mInv;
+}
+
+/// The status of a product is that of its worse factor
+static InverseStatus Worse(InverseStatus a, InverseStatus b) {
+  return a > b ? a : b;
+}
 
 Point Transform::operator()(const Point& p) const {
   float x = p.x, y = p.y, z = p.z;
@@ -80,26 +112,54 @@ Vector& Transform::Apply(Vector *v) const {
   return *v;
 }
 
+/// The product of rigid transforms is rigid, so its inverse is left to be
+/// derived when needed. Otherwise the inverse is the product of the
+/// inverses, formed now if neither needs a general inversion and left
+/// pending if one does.
 Transform Transform::operator*(const Transform& t2) const {
-  Matrix4x4 mat = Mul(m, t2.m);
-  Matrix4x4 matInv = Mul(t2.mInv, mInv);
-  return Transform(mat, matInv);
+  Transform t = Transform(Mul(m, t2.m));
+  t.rigid = rigid && t2.rigid;
+  if (!t.rigid && (hasInverse || rigid) && (t2.hasInverse || t2.rigid)) {
+    t.mInv = Mul(t2.hasInverse ? t2.mInv : RigidInverse(t2.m),
+                 hasInverse ? mInv : RigidInverse(m));
+    t.hasInverse = true;
+    t.status = Worse(status, t2.status);
+  }
+  return t;
 }
 
 Transform& Transform::operator*=(const ishi::Transform& t2) {
+  bool product = rigid && t2.rigid;
+  bool known = !product && (hasInverse || rigid) &&
+      (t2.hasInverse || t2.rigid);
+  if (known) {
+    mInv = Mul(t2.hasInverse ? t2.mInv : RigidInverse(t2.m),
+               hasInverse ? mInv : RigidInverse(m));
+    status = Worse(status, t2.status);
+  }
   m = Mul(m, t2.m);
-  mInv = Mul(t2.mInv, mInv);
+  rigid = product;
+  hasInverse = known;
   return *this;
 }
 
 Point Transform::Invert(const Point& p) const {
+  // R^T (p - t), without forming the inverse
+  if (rigid) {
+    float x = p.x - m.m[0][3], y = p.y - m.m[1][3], z = p.z - m.m[2][3];
+    return Point(m.m[0][0] * x + m.m[1][0] * y + m.m[2][0] * z,
+                 m.m[0][1] * x + m.m[1][1] * y + m.m[2][1] * z,
+                 m.m[0][2] * x + m.m[1][2] * y + m.m[2][2] * z);
+  }
+
+  const Matrix4x4& inv = InverseMatrix();
   float x = p.x, y = p.y, z = p.z;
 
   // Implicitly convert point to homogeneous coordinates
-  float xp = mInv.m[0][0]*x + mInv.m[0][1]*y + mInv.m[0][2]*z + mInv.m[0][3];
-  float yp = mInv.m[1][0]*x + mInv.m[1][1]*y + mInv.m[1][2]*z + mInv.m[1][3];
-  float zp = mInv.m[2][0]*x + mInv.m[2][1]*y + mInv.m[2][2]*z + mInv.m[2][3];
-  float wp = mInv.m[3][0]*x + mInv.m[3][1]*y + mInv.m[3][2]*z + mInv.m[3][3];
+  float xp = inv.m[0][0]*x + inv.m[0][1]*y + inv.m[0][2]*z + inv.m[0][3];
+  float yp = inv.m[1][0]*x + inv.m[1][1]*y + inv.m[1][2]*z + inv.m[1][3];
+  float zp = inv.m[2][0]*x + inv.m[2][1]*y + inv.m[2][2]*z + inv.m[2][3];
+  float wp = inv.m[3][0]*x + inv.m[3][1]*y + inv.m[3][2]*z + inv.m[3][3];
 
   // Implicitly convert point back to non-homogeneous coordinates
   if (wp == 1.f)
@@ -110,19 +170,32 @@ Point Transform::Invert(const Point& p) const {
 
 Vector Transform::Invert(const Vector& v) const {
   float x = v.x, y = v.y, z = v.z;
-  return Vector(mInv.m[0][0] * x + mInv.m[0][1] * y + mInv.m[0][2] * z,
-                mInv.m[1][0] * x + mInv.m[1][1] * y + mInv.m[1][2] * z,
-                mInv.m[2][0] * x + mInv.m[2][1] * y + mInv.m[2][2] * z);
+  if (rigid) {
+    return Vector(m.m[0][0] * x + m.m[1][0] * y + m.m[2][0] * z,
+                  m.m[0][1] * x + m.m[1][1] * y + m.m[2][1] * z,
+                  m.m[0][2] * x + m.m[1][2] * y + m.m[2][2] * z);
+  }
+
+  const Matrix4x4& inv = InverseMatrix();
+  return Vector(inv.m[0][0] * x + inv.m[0][1] * y + inv.m[0][2] * z,
+                inv.m[1][0] * x + inv.m[1][1] * y + inv.m[1][2] * z,
+                inv.m[2][0] * x + inv.m[2][1] * y + inv.m[2][2] * z);
 }
 
 Point& Transform::ApplyInvert(Point* p) const {
+  if (rigid) {
+    *p = Invert(*p);
+    return *p;
+  }
+
+  const Matrix4x4& inv = InverseMatrix();
   float x = p->x, y = p->y, z = p->z;
 
   // Implicitly convert point to homogeneous coordinates
-  float xp = mInv.m[0][0]*x + mInv.m[0][1]*y + mInv.m[0][2]*z + mInv.m[0][3];
-  float yp = mInv.m[1][0]*x + mInv.m[1][1]*y + mInv.m[1][2]*z + mInv.m[1][3];
-  float zp = mInv.m[2][0]*x + mInv.m[2][1]*y + mInv.m[2][2]*z + mInv.m[2][3];
-  float wp = mInv.m[3][0]*x + mInv.m[3][1]*y + mInv.m[3][2]*z + mInv.m[3][3];
+  float xp = inv.m[0][0]*x + inv.m[0][1]*y + inv.m[0][2]*z + inv.m[0][3];
+  float yp = inv.m[1][0]*x + inv.m[1][1]*y + inv.m[1][2]*z + inv.m[1][3];
+  float zp = inv.m[2][0]*x + inv.m[2][1]*y + inv.m[2][2]*z + inv.m[2][3];
+  float wp = inv.m[3][0]*x + inv.m[3][1]*y + inv.m[3][2]*z + inv.m[3][3];
 
   // Implicitly convert point back to non-homogeneous coordinates
   if (wp == 1.f) {
@@ -140,10 +213,16 @@ Point& Transform::ApplyInvert(Point* p) const {
 }
 
 Vector& Transform::ApplyInvert(Vector* v) const {
+  if (rigid) {
+    *v = Invert(*v);
+    return *v;
+  }
+
+  const Matrix4x4& inv = InverseMatrix();
   float x = v->x, y = v->y, z = v->z;
-  v->x = mInv.m[0][0] * x + mInv.m[0][1] * y + mInv.m[0][2] * z;
-  v->y = mInv.m[1][0] * x + mInv.m[1][1] * y + mInv.m[1][2] * z;
-  v->z = mInv.m[2][0] * x + mInv.m[2][1] * y + mInv.m[2][2] * z;
+  v->x = inv.m[0][0] * x + inv.m[0][1] * y + inv.m[0][2] * z;
+  v->y = inv.m[1][0] * x + inv.m[1][1] * y + inv.m[1][2] * z;
+  v->z = inv.m[2][0] * x + inv.m[2][1] * y + inv.m[2][2] * z;
   return *v;
 }
 
@@ -151,8 +230,31 @@ Matrix4x4 Transform::Matrix() const {
   return m;
 }
 
+bool Transform::IsRigid() const {
+  return rigid;
+}
+
+InverseStatus Transform::Invertibility() const {
+  if (rigid)
+    return INVERSE_OK;
+  InverseMatrix();
+  return status;
+}
+
+/// A rigid transform's inverse is rigid too, and its own inverse is the
+/// original matrix
 Transform Inverse(const Transform& t) {
-  return Transform(t.mInv, t.m);
+  Transform inv = Transform(t.rigid ? RigidInverse(t.m) : t.InverseMatrix(),
+                            t.m);
+  inv.rigid = t.rigid;
+  inv.status = t.status;
+  return inv;
+}
+
+Transform Rigid(const Matrix4x4& mat) {
+  Transform t = Transform(mat);
+  t.rigid = true;
+  return t;
 }
 
 Transform Translate(const Vector& delta) {
@@ -160,11 +262,7 @@ Transform Translate(const Vector& delta) {
                             0.f, 1.f, 0.f, delta.y,
                             0.f, 0.f, 1.f, delta.z,
                             0.f, 0.f, 0.f, 1.0f);
-  Matrix4x4 matInv = Matrix4x4(1.f, 0.f, 0.f, -delta.x,
-                               0.f, 1.f, 0.f, -delta.y,
-                               0.f, 0.f, 1.f, -delta.z,
-                               0.f, 0.f, 0.f, 1.0f);
-  return Transform(mat, matInv);
+  return Rigid(mat);
 }
 
 Transform RotateX(float angle) {
@@ -175,11 +273,7 @@ Transform RotateX(float angle) {
                             0.f, c, -s, 0.f,
                             0.f, s, c, 0.f,
                             0.f, 0.f, 0.f, 1.f);
-  Matrix4x4 matInv = Matrix4x4(1.f, 0.f, 0.f, 0.f,
-                               0.f,   c,   s, 0.f,
-                               0.f,  -s,   c, 0.f,
-                               0.f, 0.f, 0.f, 1.f);
-  return Transform(mat, matInv);
+  return Rigid(mat);
 }
 
 Transform RotateY(float angle) {
@@ -190,11 +284,7 @@ Transform RotateY(float angle) {
                             0.f, 1.f, 0.f, 0.f,
                             -s, 0.f, c, 0.f,
                             0.f, 0.f, 0.f, 1.f);
-  Matrix4x4 matInv = Matrix4x4(c, 0.f, -s, 0.f,
-                               0.f, 1.f, 0.f, 0.f,
-                               s, 0.f, c, 0.f,
-                               0.f, 0.f, 0.f, 1.f);
-  return Transform(mat, matInv);
+  return Rigid(mat);
 }
 
 Transform RotateZ(float angle) {
@@ -205,11 +295,7 @@ Transform RotateZ(float angle) {
                             s,  c, 0.f, 0.f,
                             0.f, 0.f, 1.f, 0.f,
                             0.f, 0.f, 0.f, 1.f);
-  Matrix4x4 matInv = Matrix4x4(c,  s, 0.f, 0.f,
-                               -s, c, 0.f, 0.f,
-                               0.f, 0.f, 1.f, 0.f,
-                               0.f, 0.f, 0.f, 1.f);
-  return Transform(mat, matInv);
+  return Rigid(mat);
 }
 
 
@@ -276,7 +362,7 @@ Transform Rotate(float angle, const Vector& axis) {
   m[3][3] = 1.f;
 
   Matrix4x4 mat = Matrix4x4(m);
-  return Transform(mat, Transpose(mat));
+  return Rigid(mat);
 }
 
 /*
@@ -298,7 +384,7 @@ Transform AlignX(const Vector& v) {
                             v1.y, v2.y, v3.y, 0,
                             v1.z, v2.z, v3.z, 0,
                             0, 0, 0, 1);
-  return Transform(Transpose(mat), mat);
+  return Rigid(Transpose(mat));
 }
 
 Transform AlignY(const Vector& v) {
@@ -314,7 +400,7 @@ Transform AlignY(const Vector& v) {
                             v3.y, v1.y, v2.y, 0,
                             v3.z, v1.z, v2.z, 0,
                             0, 0, 0, 1);
-  return Transform(Transpose(mat), mat);
+  return Rigid(Transpose(mat));
 }
 
 Transform AlignZ(const Vector& v) {
@@ -330,8 +416,68 @@ Transform AlignZ(const Vector& v) {
                             v2.y, v3.y, v1.y, 0,
                             v2.z, v3.z, v1.z, 0,
                             0, 0, 0, 1);
-  return Transform(Transpose(mat), mat);
+  return Rigid(Transpose(mat));
 }
 
+/// Every element of the matrix is broadcast over the lanes once, and each
+/// coordinate is summed in the same order as Transform::operator().
+template <class T>
+static int TransformPointLanes(const Matrix4x4 &mat, const PointArrays &p,
+                               int i, int n, const PointArrays &r) {
+  T m[4][4];
+  for (int j = 0; j < 4; j++)
+    for (int k = 0; k < 4; k++)
+      m[j][k] = T(mat.m[j][k]);
+  bool affine = mat.m[3][0] == 0.f && mat.m[3][1] == 0.f &&
+      mat.m[3][2] == 0.f && mat.m[3][3] == 1.f;
+
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T x = T::Load(p.x + i), y = T::Load(p.y + i), z = T::Load(p.z + i);
+    T xp = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+    T yp = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+    T zp = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+    if (!affine) {
+      T f = T(1.f) / (m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3]);
+      xp = xp * f;
+      yp = yp * f;
+      zp = zp * f;
+    }
+    xp.Store(r.x + i);
+    yp.Store(r.y + i);
+    zp.Store(r.z + i);
+  }
+  return i;
+}
+
+void TransformPoints(const Transform &t, const PointArrays &p, int n,
+                     const PointArrays &r) {
+  Matrix4x4 mat = t.Matrix();
+  int i = TransformPointLanes<FloatN>(mat, p, 0, n, r);
+  TransformPointLanes<Float1>(mat, p, i, n, r);
+}
+
+template <class T>
+static int TransformVectorLanes(const Matrix4x4 &mat, const VectorArrays &v,
+                                int i, int n, const VectorArrays &r) {
+  T m[3][3];
+  for (int j = 0; j < 3; j++)
+    for (int k = 0; k < 3; k++)
+      m[j][k] = T(mat.m[j][k]);
+
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T x = T::Load(v.x + i), y = T::Load(v.y + i), z = T::Load(v.z + i);
+    (m[0][0] * x + m[0][1] * y + m[0][2] * z).Store(r.x + i);
+    (m[1][0] * x + m[1][1] * y + m[1][2] * z).Store(r.y + i);
+    (m[2][0] * x + m[2][1] * y + m[2][2] * z).Store(r.z + i);
+  }
+  return i;
+}
+
+void TransformVectors(const Transform &t, const VectorArrays &v, int n,
+                      const VectorArrays &r) {
+  Matrix4x4 mat = t.Matrix();
+  int i = TransformVectorLanes<FloatN>(mat, v, 0, n, r);
+  TransformVectorLanes<Float1>(mat, v, i, n, r);
+}
 
 }  // namespace ishi
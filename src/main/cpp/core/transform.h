@@ -8,16 +8,36 @@ namespace ishi {
 class Point;
 class Vector;
 class BBox;
-
+struct PointArrays;
+struct VectorArrays;
+
+/// A 4x4 transformation matrix together with its inverse.
+///
+/// The inverse is only formed when it is used. Rigid transforms (rotations
+/// and translations, and compositions of them) derive it in closed form
+/// each time and never store it, so composing them costs one matrix product
+/// and they can be shared between threads freely. A transform built from a
+/// general matrix computes its inverse on first use and caches it; the
+/// cache is written by const methods, so such a transform must not have its
+/// inverse first used from several threads at once. A singular matrix has
+/// the identity as its inverse, which Invertibility reports.
 class Transform {
  private:
-  Matrix4x4 m, mInv;
+  Matrix4x4 m;
+  mutable Matrix4x4 mInv;
+  bool rigid;                 // if true, m is a rotation and translation
+  mutable bool hasInverse;    // if true, mInv holds the inverse of m
+  mutable InverseStatus status;  // how well mInv inverts m, once known
+
+  /// Return the inverse matrix, computing and caching it if needed
+  const Matrix4x4 &InverseMatrix() const;
 
  public:
   /// Initialize an identity transform
   Transform();
 
-  /// Initialize a transform with a matrix, calculating its inverse
+  /// Initialize a transform with a matrix. Its inverse is calculated the
+  /// first time it is needed.
   explicit Transform(const Matrix4x4 &mat);
 
   /// Initialize a transform with a matrix and its inverse
@@ -59,12 +79,25 @@ class Transform {
   /// Return the transformation matrix as a 4x4 Matrix
   Matrix4x4 Matrix() const;
 
+  /// Return true if the transform is known to be rigid
+  bool IsRigid() const;
+
+  /// Return how well the transform can be inverted, computing its inverse
+  /// if needed. INVERSE_SINGULAR means inverting it leaves points and
+  /// vectors unchanged.
+  InverseStatus Invertibility() const;
+
   friend Transform Inverse(const Transform &t);
+  friend Transform Rigid(const Matrix4x4 &mat);
 };
 
 /// Return the inverse a transform as a new transform
 Transform Inverse(const Transform &t);
 
+/// Return a transform of a rigid matrix [R | t] (R orthonormal), whose
+/// inverse [R^T | -R^T t] is derived in closed form when needed
+Transform Rigid(const Matrix4x4 &mat);
+
 /// Return a transform representing a translation by a vector
 Transform Translate(const Vector &delta);
 
@@ -99,6 +132,16 @@ Transform AlignY(const Vector &v);
 /// being colinear to the Z axis
 Transform AlignZ(const Vector &v);
 
+/// Apply a transform to n points stored as arrays, as Transform does to
+/// each Point (including the division of a projective transform). r may
+/// be p.
+void TransformPoints(const Transform &t, const PointArrays &p, int n,
+                     const PointArrays &r);
+
+/// Apply a transform to n vectors stored as arrays. r may be v.
+void TransformVectors(const Transform &t, const VectorArrays &v, int n,
+                      const VectorArrays &r);
+
 }  // namespace ishi
 
 #endif
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include <core/common.h>
+#include <core/lanes.h>
 #include <core/math.h>
 #include <core/vector.h>
 
@@ -131,4 +132,134 @@ void CoordinateSystem(const Vector& v1, Vector* v2, Vector* v3) {
   *v3 = Cross(v1, *v2);
 }
 
+/// Load the i-th group of T::kWidth vectors
+template <class T>
+static inline void LoadVectors(const VectorArrays &v, int i, T r[3]) {
+  r[0] = T::Load(v.x + i);
+  r[1] = T::Load(v.y + i);
+  r[2] = T::Load(v.z + i);
+}
+
+/// Store the i-th group of T::kWidth vectors
+template <class T>
+static inline void StoreVectors(const T v[3], int i, const VectorArrays &r) {
+  v[0].Store(r.x + i);
+  v[1].Store(r.y + i);
+  v[2].Store(r.z + i);
+}
+
+template <class T>
+static int AddVectorLanes(const VectorArrays &a, const VectorArrays &b,
+                          int i, int n, const VectorArrays &r) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T va[3], vb[3];
+    LoadVectors(a, i, va);
+    LoadVectors(b, i, vb);
+    T vr[3] = {va[0] + vb[0], va[1] + vb[1], va[2] + vb[2]};
+    StoreVectors(vr, i, r);
+  }
+  return i;
+}
+
+void AddVectors(const VectorArrays &a, const VectorArrays &b, int n,
+                const VectorArrays &r) {
+  int i = AddVectorLanes<FloatN>(a, b, 0, n, r);
+  AddVectorLanes<Float1>(a, b, i, n, r);
+}
+
+template <class T>
+static int ScaleVectorLanes(const VectorArrays &v, float f, int i, int n,
+                            const VectorArrays &r) {
+  T s = T(f);
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T vv[3];
+    LoadVectors(v, i, vv);
+    T vr[3] = {vv[0] * s, vv[1] * s, vv[2] * s};
+    StoreVectors(vr, i, r);
+  }
+  return i;
+}
+
+void ScaleVectors(const VectorArrays &v, float f, int n,
+                  const VectorArrays &r) {
+  int i = ScaleVectorLanes<FloatN>(v, f, 0, n, r);
+  ScaleVectorLanes<Float1>(v, f, i, n, r);
+}
+
+template <class T>
+static int DotVectorLanes(const VectorArrays &a, const VectorArrays &b,
+                          int i, int n, float *d) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T va[3], vb[3];
+    LoadVectors(a, i, va);
+    LoadVectors(b, i, vb);
+    (va[0] * vb[0] + va[1] * vb[1] + va[2] * vb[2]).Store(d + i);
+  }
+  return i;
+}
+
+void DotVectors(const VectorArrays &a, const VectorArrays &b, int n,
+                float *d) {
+  int i = DotVectorLanes<FloatN>(a, b, 0, n, d);
+  DotVectorLanes<Float1>(a, b, i, n, d);
+}
+
+template <class T>
+static int CrossVectorLanes(const VectorArrays &a, const VectorArrays &b,
+                            int i, int n, const VectorArrays &r) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T va[3], vb[3];
+    LoadVectors(a, i, va);
+    LoadVectors(b, i, vb);
+    T vr[3] = {va[1] * vb[2] - va[2] * vb[1],
+               va[2] * vb[0] - va[0] * vb[2],
+               va[0] * vb[1] - va[1] * vb[0]};
+    StoreVectors(vr, i, r);
+  }
+  return i;
+}
+
+void CrossVectors(const VectorArrays &a, const VectorArrays &b, int n,
+                  const VectorArrays &r) {
+  int i = CrossVectorLanes<FloatN>(a, b, 0, n, r);
+  CrossVectorLanes<Float1>(a, b, i, n, r);
+}
+
+template <class T>
+static int LengthVectorLanes(const VectorArrays &v, int i, int n, float *l) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T vv[3];
+    LoadVectors(v, i, vv);
+    Sqrt(vv[0] * vv[0] + vv[1] * vv[1] + vv[2] * vv[2]).Store(l + i);
+  }
+  return i;
+}
+
+void LengthVectors(const VectorArrays &v, int n, float *l) {
+  int i = LengthVectorLanes<FloatN>(v, 0, n, l);
+  LengthVectorLanes<Float1>(v, i, n, l);
+}
+
+/// Zero vectors are kept zero without a branch by clamping the squared
+/// length to FLT_MIN, whose inverse square root is still finite.
+template <class T>
+static int NormalizeVectorLanes(const VectorArrays &v, int i, int n,
+                                const VectorArrays &r, bool approximate) {
+  for (; i + T::kWidth <= n; i += T::kWidth) {
+    T vv[3];
+    LoadVectors(v, i, vv);
+    T l2 = Max(vv[0] * vv[0] + vv[1] * vv[1] + vv[2] * vv[2], T(FLT_MIN));
+    T f = approximate ? Rsqrt(l2) : T(1.f) / Sqrt(l2);
+    T vr[3] = {vv[0] * f, vv[1] * f, vv[2] * f};
+    StoreVectors(vr, i, r);
+  }
+  return i;
+}
+
+void NormalizeVectors(const VectorArrays &v, int n, const VectorArrays &r,
+                      bool approximate) {
+  int i = NormalizeVectorLanes<FloatN>(v, 0, n, r, approximate);
+  NormalizeVectorLanes<Float1>(v, i, n, r, approximate);
+}
+
 }  // namespace ishi
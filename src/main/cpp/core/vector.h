@@ -81,6 +81,40 @@ Vector Normalize(const Vector &v);
 /// @note The function assumes that the input vector is already normalized.
 void CoordinateSystem(const Vector &v1, Vector *v2, Vector *v3);
 
+/// Vectors stored component by component (structure of arrays): the i-th
+/// vector is (x[i], y[i], z[i]). Batch functions read and write whole lanes
+/// of each array at once, and their results may overwrite their inputs.
+struct VectorArrays {
+  float *x;
+  float *y;
+  float *z;
+};
+
+/// Compute r[i] = a[i] + b[i] for n vectors
+void AddVectors(const VectorArrays &a, const VectorArrays &b, int n,
+                const VectorArrays &r);
+
+/// Compute r[i] = v[i] * f for n vectors
+void ScaleVectors(const VectorArrays &v, float f, int n,
+                  const VectorArrays &r);
+
+/// Compute d[i] = Dot(a[i], b[i]) for n vectors
+void DotVectors(const VectorArrays &a, const VectorArrays &b, int n,
+                float *d);
+
+/// Compute r[i] = Cross(a[i], b[i]) for n vectors
+void CrossVectors(const VectorArrays &a, const VectorArrays &b, int n,
+                  const VectorArrays &r);
+
+/// Compute l[i] = Length(v[i]) for n vectors
+void LengthVectors(const VectorArrays &v, int n, float *l);
+
+/// Compute r[i] = Normalize(v[i]) for n vectors. Zero vectors stay zero.
+/// If approximate, lengths are inverted with Rsqrt (see lanes.h), faster
+/// but off by up to about 1e-6.
+void NormalizeVectors(const VectorArrays &v, int n, const VectorArrays &r,
+                      bool approximate = false);
+
 }  // namespace ishi
 
 #endif
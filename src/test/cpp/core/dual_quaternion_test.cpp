@@ -0,0 +1,123 @@
+#include <catch/catch.hpp>
+#include <core/common.h>
+#include <core/dual_quaternion.h>
+#include <core/matrix.h>
+#include <core/quaternion.h>
+#include <core/transform.h>
+#include <core/vector.h>
+#include <core/point.h>
+
+#include "../helpers.h"
+
+using namespace ishi;
+
+// Verify the default dual quaternion is the identity
+TEST_CASE("DualQuaternionIdentity", "[dual_quaternion]") {
+  DualQuaternion dq;
+  Point p = Point(5.1, 6.2, 7.3);
+  Vector v = Vector(-1.5, 2.5, 0.5);
+
+  CHECK(dq(p) == p);
+  CHECK(NearlyEqual(dq(v), v));
+  CHECK(NearlyEqual(dq.Translation(), Vector(0, 0, 0)));
+  CHECK(Inverse(dq) == dq);
+  CHECK(DualQuaternion(Transform()) == dq);
+}
+
+// Verify a dual quaternion acts on points and vectors like the Transform it
+// was made from, and converts back to it
+TEST_CASE("DualQuaternionMatchesTransform", "[dual_quaternion]") {
+  float range = 2.f;
+  float step = 0.25f;
+
+  for (float i = -range; i < range; i+=step) {
+    for (float j = -range; j < range; j+=step) {
+      Point p = Point(i, j, i * j);
+      Vector v = Vector(j, i, 1.f);
+      Vector delta = Vector(j, i, 3.f);
+      Transform t = RigidSample(i, delta);
+      DualQuaternion dq = DualQuaternion(t);
+
+      CHECK(dq(p) == t(p));
+      CHECK(NearlyEqual(dq(v), t(v)));
+      CHECK(NearlyEqual(dq.Translation(), delta));
+      CHECK(NearlyEqual(dq.ToTransform().Matrix(), t.Matrix()));
+      CHECK(DualQuaternion(Quaternion(t), delta) == dq);
+    }
+  }
+}
+
+// Verify composition and inversion match those of transforms
+TEST_CASE("DualQuaternionConcatenation", "[dual_quaternion]") {
+  float range = 2.f;
+  float step = 0.25f;
+
+  for (float i = -range; i < range; i+=step) {
+    Transform a = RigidSample(i, Vector(i, 1.f, -2.f));
+    Transform b = RigidSample(-0.5f * i, Vector(0.5f, i, i));
+    DualQuaternion da = DualQuaternion(a);
+    DualQuaternion db = DualQuaternion(b);
+    Point p = Point(i, 2.f, -i);
+
+    CHECK(NearlyEqual((da * db).ToTransform().Matrix(), (a * b).Matrix()));
+    CHECK((da * db)(p) == da(db(p)));
+    CHECK((da * Inverse(da))(p) == p);
+    CHECK(NearlyEqual(Inverse(da).ToTransform().Matrix(),
+                      Inverse(a).Matrix()));
+
+    DualQuaternion c = da;
+    c *= db;
+    CHECK(c == da * db);
+  }
+}
+
+// Verify normalization restores a rigid transform from a scaled and
+// perturbed dual quaternion
+TEST_CASE("DualQuaternionNormalize", "[dual_quaternion]") {
+  DualQuaternion dq = DualQuaternion(RigidSample(0.8f, Vector(1, 2, 3)));
+  DualQuaternion scaled = DualQuaternion(dq.real * 2.f, dq.dual * 2.f);
+
+  CHECK(Normalize(scaled) == dq);
+  CHECK(Normalize(dq) == dq);
+
+  DualQuaternion skewed = DualQuaternion(dq.real, dq.dual + dq.real * 0.1f);
+  DualQuaternion n = Normalize(skewed);
+  CHECK(std::fabs(Dot(n.real, n.dual)) < 0.0001f);
+  CHECK(NearlyEqual(n.Translation(), dq.Translation()));
+}
+
+// Verify the structure-of-arrays batch matches the scalar product
+TEST_CASE("DualQuaternionArrays", "[dual_quaternion]") {
+  const int n = 13;
+  float a[8][n], b[8][n], r[8][n];
+  DualQuaternionArrays da = {{a[0], a[1], a[2], a[3]},
+                             {a[4], a[5], a[6], a[7]}};
+  DualQuaternionArrays db = {{b[0], b[1], b[2], b[3]},
+                             {b[4], b[5], b[6], b[7]}};
+  DualQuaternionArrays dr = {{r[0], r[1], r[2], r[3]},
+                             {r[4], r[5], r[6], r[7]}};
+  DualQuaternion expected[n];
+
+  for (int i = 0; i < n; i++) {
+    DualQuaternion p = DualQuaternion(RigidSample(0.3f * i, Vector(i, 1, 2)));
+    DualQuaternion q = DualQuaternion(RigidSample(-0.1f * i,
+                                                  Vector(0, -i, 1)));
+    const Quaternion *pq[2] = {&p.real, &p.dual};
+    const Quaternion *qq[2] = {&q.real, &q.dual};
+    for (int k = 0; k < 2; k++) {
+      a[4 * k][i] = pq[k]->w; a[4 * k + 1][i] = pq[k]->x;
+      a[4 * k + 2][i] = pq[k]->y; a[4 * k + 3][i] = pq[k]->z;
+      b[4 * k][i] = qq[k]->w; b[4 * k + 1][i] = qq[k]->x;
+      b[4 * k + 2][i] = qq[k]->y; b[4 * k + 3][i] = qq[k]->z;
+    }
+    expected[i] = p * q;
+  }
+
+  MulDualQuaternions(da, db, n, dr);
+  for (int i = 0; i < n; i++) {
+    DualQuaternion dq = DualQuaternion(
+        Quaternion(r[0][i], r[1][i], r[2][i], r[3][i]),
+        Quaternion(r[4][i], r[5][i], r[6][i], r[7][i]));
+    CHECK(dq == expected[i]);
+  }
+}
@@ -0,0 +1,121 @@
+#include <catch/catch.hpp>
+#include <core/euler.h>
+#include <core/lanes.h>
+#include <core/transform.h>
+#include <core/vector.h>
+#include <core/point.h>
+
+using namespace ishi;
+
+// Return the rotation about one principal axis (0 = X, 1 = Y, 2 = Z)
+static Transform RotateAxis(int axis, float angle) {
+  if (axis == 0)
+    return RotateX(angle);
+  else if (axis == 1)
+    return RotateY(angle);
+  return RotateZ(angle);
+}
+
+// Verify that the order of axes survives a round trip through RotationOrder
+TEST_CASE("RotationOrderAxes", "[euler]") {
+  int orders[6][3] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+  };
+
+  for (int i = 0; i < 6; i++) {
+    RotationOrder order = GetRotationOrder(orders[i][0], orders[i][1],
+                                           orders[i][2]);
+    CHECK(RotationAxis(order, 0) == orders[i][0]);
+    CHECK(RotationAxis(order, 1) == orders[i][1]);
+    CHECK(RotationAxis(order, 2) == orders[i][2]);
+  }
+}
+
+// Verify that the fused kernel of every order matches the product of
+// rotations about the principal axes
+TEST_CASE("EulerTransformMatchesConcatenation", "[euler]") {
+  Point p = Point(1, 2, 3);
+  Vector v = Vector(4, 5, 6);
+  float range = 3.f;
+  float step = 0.7f;
+
+  for (int o = ROT_XYZ; o <= ROT_ZYX; o++) {
+    RotationOrder order = static_cast<RotationOrder>(o);
+    int a0 = RotationAxis(order, 0);
+    int a1 = RotationAxis(order, 1);
+    int a2 = RotationAxis(order, 2);
+
+    for (float i = -range; i < range; i+=step) {
+      for (float j = -range; j < range; j+=step) {
+        for (float k = -range; k < range; k+=step) {
+          Transform t = RotateAxis(a0, i) * RotateAxis(a1, j) *
+              RotateAxis(a2, k);
+          Transform e = EulerTransform(order, i, j, k);
+
+          CHECK(e(p) == t(p));
+          CHECK(e(v) == t(v));
+          CHECK(e.Invert(p) == t.Invert(p));
+        }
+      }
+    }
+  }
+}
+
+// Verify that the translation is applied after the rotation and that the
+// closed-form inverse undoes the whole transform
+TEST_CASE("EulerTransformWithTranslation", "[euler]") {
+  Point p = Point(1, 2, 3);
+  Vector delta = Vector(-7, 0.5, 2);
+  float angles[3] = {0.3f, -1.2f, 2.5f};
+  float c[3], s[3];
+
+  for (int i = 0; i < 3; i++) {
+    c[i] = cos(angles[i]);
+    s[i] = sin(angles[i]);
+  }
+
+  for (int o = ROT_XYZ; o <= ROT_ZYX; o++) {
+    RotationOrder order = static_cast<RotationOrder>(o);
+    Transform e = EulerTransform(order, c, s, delta);
+    Transform t = Translate(delta) *
+        EulerTransform(order, angles[0], angles[1], angles[2]);
+
+    CHECK(e(p) == t(p));
+    CHECK(e.Invert(e(p)) == p);
+    CHECK((e * Inverse(e))(p) == p);
+  }
+}
+
+// Verify that the kernels evaluated in SIMD lanes match the scalar kernels
+// lane for lane
+TEST_CASE("EulerRotationLanes", "[euler]") {
+  const int w = FloatN::kWidth;
+  float c[3][FloatN::kWidth], s[3][FloatN::kWidth];
+  FloatN cl[3], sl[3], rl[3][3];
+
+  for (int i = 0; i < 3; i++) {
+    for (int l = 0; l < w; l++) {
+      float angle = 0.4f * l - 1.3f * i + 0.2f;
+      c[i][l] = cos(angle);
+      s[i][l] = sin(angle);
+    }
+    cl[i] = FloatN::Load(c[i]);
+    sl[i] = FloatN::Load(s[i]);
+  }
+  EulerRotation<2, 0, 1>(cl, sl, rl);
+
+  for (int l = 0; l < w; l++) {
+    float cs[3] = {c[0][l], c[1][l], c[2][l]};
+    float ss[3] = {s[0][l], s[1][l], s[2][l]};
+    float r[3][3];
+    EulerRotation<2, 0, 1>(cs, ss, r);
+
+    for (int i = 0; i < 3; i++) {
+      for (int k = 0; k < 3; k++) {
+        float lanes[FloatN::kWidth];
+        rl[i][k].Store(lanes);
+        CHECK(lanes[l] == r[i][k]);
+      }
+    }
+  }
+}
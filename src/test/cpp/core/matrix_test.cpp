@@ -1,6 +1,8 @@
 #include <catch/catch.hpp>
 #include <core/matrix.h>
 
+#include <cmath>
+
 using namespace ishi;
 
 TEST_CASE("Matrix4x4DefaultConstructor", "[matrix]") {
@@ -156,6 +158,56 @@ TEST_CASE("Matrix4x4Multiply", "[matrix]") {
   CHECK(Transpose(Mul(m1, m2)) == Mul(Transpose(m2), Transpose(m1)));
 }
 
+/// Return a matrix whose elements depend on a seed
+static Matrix4x4 Sample(float seed) {
+  Matrix4x4 mat;
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      mat.m[i][j] = (i == j) + 0.1f * seed * (j - i) + 0.01f * i * j;
+  return mat;
+}
+
+/// Return true if two matrices have exactly the same elements (operator==
+/// is relative, and rejects equal negative elements)
+static bool Same(const Matrix4x4 &a, const Matrix4x4 &b) {
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      if (a.m[i][j] != b.m[i][j])
+        return false;
+  return true;
+}
+
+// Verify the batched products match Mul, including in place, and that
+// matrices in arrays are aligned for vector loads
+TEST_CASE("Matrix4x4MultiplyArrays", "[matrix]") {
+  const int n = 9;
+  Matrix4x4 a[n], b[n], r[n];
+  int32_t parents[n] = {-1, 0, 1, 2, 1, 4, 0, -1, 7};
+
+  for (int i = 0; i < n; i++) {
+    a[i] = Sample(i);
+    b[i] = Sample(-0.5f * i);
+    CHECK(reinterpret_cast<uintptr_t>(&a[i]) % 16 == 0);
+  }
+
+  MulMatrices(a, b, n, r);
+  for (int i = 0; i < n; i++)
+    CHECK(Same(r[i], Mul(a[i], b[i])));
+  MulMatrices(a, b, n, b);
+  for (int i = 0; i < n; i++)
+    CHECK(Same(b[i], r[i]));
+
+  MulMatrixChain(a, parents, n, r);
+  CHECK(Same(r[0], a[0]));
+  CHECK(Same(r[3], Mul(Mul(Mul(a[0], a[1]), a[2]), a[3])));
+  CHECK(Same(r[5], Mul(Mul(Mul(a[0], a[1]), a[4]), a[5])));
+  CHECK(Same(r[6], Mul(a[0], a[6])));
+  CHECK(Same(r[8], Mul(a[7], a[8])));
+  MulMatrixChain(a, parents, n, a);
+  for (int i = 0; i < n; i++)
+    CHECK(Same(a[i], r[i]));
+}
+
 TEST_CASE("inverse of identity matrix is itself", "[matrix]") {
   Matrix4x4 m1, m2, i;
 
@@ -207,12 +259,13 @@ TEST_CASE("Inverse of singular matrix", "[matrix]") {
                   5.0f,  6.0f,  7.0f,  8.0f,
                   9.0f, 10.0f, 11.0f, 12.0f,
                   13.0f, 14.0f, 15.0f, 16.0f);
-  m2 = Inverse(m1);
+  CHECK(Inverse(m1, &m2) == INVERSE_SINGULAR);
 
-  const Matrix4x4 &mul2 = Mul(m1, m2);
+  // Its inverse is reported as the identity
+  m2 = Inverse(m1);
   for (int x = 0; x < 4; ++x) {
     for (int y = 0; y < 4; ++y) {
-      CHECK(mul2.m[x][y] == Approx(i.m[x][y]).epsilon(0.0001));
+      CHECK(m2.m[x][y] == i.m[x][y]);
     }
   }
 }
@@ -223,19 +276,134 @@ TEST_CASE("Inverse of matrix with zero-rows in elimination routine", "[matrix]")
 
   i = Matrix4x4();
 
-  // This matrix has no inverse (singular) ??
+  // This matrix has no inverse (singular): every row is a combination of
+  // (1, 1, 1, 1) and (0, 1, 2, 3)
   m1 = Matrix4x4(1.f, 2.f, 3.f, 4.f,
                  5.f, 6.f, 7.f, 8.f,
                  1.5, 2.6, 3.7, 4.8,
                  5.1, 6.2, 7.3, 8.4);
-  m2 = Inverse(m1);
+  CHECK(Inverse(m1, &m2) == INVERSE_SINGULAR);
 
-  const Matrix4x4 &mul2 = Mul(m1, m2);
+  m2 = Inverse(m1);
   for (int x = 0; x < 4; ++x) {
     for (int y = 0; y < 4; ++y) {
-      CHECK(mul2.m[x][y] == Approx(i.m[x][y]).epsilon(0.0001));
+      CHECK(m2.m[x][y] == i.m[x][y]);
+    }
+  }
+}
+
+/// Return true if the product of two matrices is the identity, within a
+/// tolerance
+static bool IsIdentityProduct(const Matrix4x4 &a, const Matrix4x4 &b,
+                              float tolerance) {
+  Matrix4x4 p = Mul(a, b);
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      if (std::fabs(p.m[i][j] - (i == j)) > tolerance)
+        return false;
+  return true;
+}
+
+// Verify the closed-form inverse and the status it reports for regular,
+// scaled, nearly dependent and singular matrices
+TEST_CASE("Matrix4x4InverseStatus", "[matrix]") {
+  Matrix4x4 inv, mat;
+
+  mat = Matrix4x4( 2.0f, 3.0f,  1.0f, 5.0f,
+                   1.0f, 0.0f,  3.0f, 1.0f,
+                   0.0f, 2.0f, -3.0f, 2.0f,
+                   0.0f, 2.0f,  3.0f, 1.0f);
+  CHECK(Inverse(mat, &inv) == INVERSE_OK);
+  CHECK(IsIdentityProduct(mat, inv, 0.0001f));
+  CHECK(IsIdentityProduct(inv, mat, 0.0001f));
+  CHECK(Same(Inverse(mat), inv));
+
+  // Scaling rows does not make a matrix any harder to invert
+  mat = Matrix4x4(0.001f, 0.f, 0.f, 0.f,
+                  0.f, 1000.f, 0.f, 0.f,
+                  0.f, 0.f, 1.f, 5.f,
+                  0.f, 0.f, 0.f, 1.f);
+  CHECK(Inverse(mat, &inv) == INVERSE_OK);
+  CHECK(inv.m[0][0] == Approx(1000.f));
+  CHECK(inv.m[1][1] == Approx(0.001f));
+  CHECK(inv.m[2][3] == Approx(-5.f));
+
+  mat = Matrix4x4(1.f, 2.f, 3.f, 4.f,
+                  1.f, 2.f, 3.f, 4.0001f,
+                  0.f, 0.f, 1.f, 0.f,
+                  0.f, 1.f, 0.f, 1.f);
+  CHECK(Inverse(mat, &inv) == INVERSE_ILL_CONDITIONED);
+  CHECK(IsIdentityProduct(mat, inv, 0.01f));
+
+  // Affine matrices are judged on their linear part, so large translations
+  // (a character placed far from the origin) invert as accurately as small
+  // ones
+  float c = std::cos(0.7f), s = std::sin(0.7f);
+  const float offsets[3] = {10.f, 100.f, 500.f};
+  for (int k = 0; k < 3; k++) {
+    float t = offsets[k];
+    mat = Matrix4x4(1.f, 0.f, 0.f, t,
+                    0.f, 1.f, 0.f, t,
+                    0.f, 0.f, 1.f, t,
+                    0.f, 0.f, 0.f, 1.f);
+    CHECK(Inverse(mat, &inv) == INVERSE_OK);
+    CHECK(inv.m[0][3] == -t);
+    CHECK(IsIdentityProduct(mat, inv, 0.0001f));
+
+    mat = Matrix4x4(  c, 0.f,   s, t,
+                    0.f, 1.f, 0.f, 0.18f * t,
+                     -s, 0.f,   c, 0.6f * t,
+                    0.f, 0.f, 0.f, 1.f);
+    CHECK(Inverse(mat, &inv) == INVERSE_OK);
+    CHECK(IsIdentityProduct(mat, inv, 0.0001f));
+    CHECK(IsIdentityProduct(inv, mat, 0.0001f));
+  }
+
+  // Singular matrices leave the output untouched
+  Matrix4x4 singular[2] = {
+    Matrix4x4( 1.0f,  2.0f,  3.0f,  4.0f,
+               5.0f,  6.0f,  7.0f,  8.0f,
+               9.0f, 10.0f, 11.0f, 12.0f,
+              13.0f, 14.0f, 15.0f, 16.0f),
+    Matrix4x4(1.f, 2.f, 3.f, 4.f,
+              0.f, 0.f, 0.f, 0.f,
+              1.f, 0.f, 1.f, 0.f,
+              0.f, 1.f, 0.f, 1.f)};
+  for (int k = 0; k < 2; k++) {
+    inv = Matrix4x4();
+    CHECK(Inverse(singular[k], &inv) == INVERSE_SINGULAR);
+    CHECK(Same(inv, Matrix4x4()));
+  }
+}
+
+// Verify batch inversion matches inverting one matrix at a time, including
+// in place and with singular matrices among the others
+TEST_CASE("Matrix4x4InverseArrays", "[matrix]") {
+  const int n = 19;
+  Matrix4x4 mat[n], inv[n], expected[n];
+  InverseStatus status[n], single[n];
+
+  for (int i = 0; i < n; i++) {
+    mat[i] = Sample(i + 1);
+    if (i % 5 == 3)
+      mat[i].m[2][0] = mat[i].m[2][1] = mat[i].m[2][2] = mat[i].m[2][3] = 0;
+    single[i] = Inverse(mat[i], &expected[i]);
+  }
+
+  CHECK(InverseMatrices(mat, n, inv, status) == 4);
+  for (int i = 0; i < n; i++) {
+    CHECK(status[i] == single[i]);
+    CHECK(status[i] == (i % 5 == 3 ? INVERSE_SINGULAR : INVERSE_OK));
+    if (status[i] != INVERSE_SINGULAR) {
+      CHECK(Same(inv[i], expected[i]));
+      CHECK(IsIdentityProduct(mat[i], inv[i], 0.0001f));
     }
   }
+
+  CHECK(InverseMatrices(mat, n, mat) == 4);
+  for (int i = 0; i < n; i++)
+    if (status[i] != INVERSE_SINGULAR)
+      CHECK(Same(mat[i], inv[i]));
 }
 
 /// Verify that we can access the underlying data through pointer arithmetic
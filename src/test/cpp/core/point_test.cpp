@@ -1,6 +1,9 @@
 #include <catch/catch.hpp>
 
+#include <core/bbox.h>
+#include <core/common.h>
 #include <core/point.h>
+#include <core/vector.h>
 
 using namespace ishi;
 
@@ -84,3 +87,43 @@ TEST_CASE("PointIndexAccessor", "[point]") {
 }
 
 
+
+// Verify the structure-of-arrays batches match the functions on single
+// points, including the leftovers that do not fill a lane
+TEST_CASE("PointArrays", "[point]") {
+  const int n = 19;
+  float a[3][n], b[3][n], v[3][n], r[3][n], d[n];
+  PointArrays pa = {a[0], a[1], a[2]};
+  PointArrays pb = {b[0], b[1], b[2]};
+  PointArrays pr = {r[0], r[1], r[2]};
+  VectorArrays vv = {v[0], v[1], v[2]};
+  Point p[n], q[n];
+
+  for (int i = 0; i < n; i++) {
+    p[i] = Point(0.5f * i, 1.f - i, (i % 3) - 1.f);
+    q[i] = Point(-1.f, 0.25f * i, 3.f - i);
+    a[0][i] = p[i].x; a[1][i] = p[i].y; a[2][i] = p[i].z;
+    b[0][i] = q[i].x; b[1][i] = q[i].y; b[2][i] = q[i].z;
+  }
+
+  SubtractPoints(pa, pb, n, vv);
+  for (int i = 0; i < n; i++)
+    CHECK(Vector(v[0][i], v[1][i], v[2][i]) == p[i] - q[i]);
+
+  TranslatePoints(pb, vv, n, pr);
+  for (int i = 0; i < n; i++)
+    CHECK(Point(r[0][i], r[1][i], r[2][i]) == p[i]);
+
+  DistancePoints(pa, pb, n, d);
+  for (int i = 0; i < n; i++)
+    CHECK(d[i] == Approx(Distance(p[i], q[i])));
+
+  for (int m = 1; m <= n; m++) {
+    BBox b = Bounds(pa, m), e;
+    for (int i = 0; i < m; i++)
+      e = Union(e, p[i]);
+    CHECK(b.pMin == e.pMin);
+    CHECK(b.pMax == e.pMax);
+  }
+  CHECK(Bounds(pa, 0).pMin.x == INFINITY);
+}
@@ -0,0 +1,263 @@
+#include <catch/catch.hpp>
+#include <core/common.h>
+#include <core/euler.h>
+#include <core/matrix.h>
+#include <core/quaternion.h>
+#include <core/transform.h>
+#include <core/vector.h>
+#include <core/point.h>
+
+#include "../helpers.h"
+
+using namespace ishi;
+
+/// Return true if two quaternions are the same rotation
+static bool SameRotation(const Quaternion &a, const Quaternion &b) {
+  return a == b || a == -b;
+}
+
+// Verify the default quaternion is the identity rotation
+TEST_CASE("QuaternionIdentity", "[quaternion]") {
+  Quaternion q;
+  Point p = Point(5.1, 6.2, 7.3);
+  Vector v = Vector(-1.5, 2.5, 0.5);
+
+  CHECK(q.Matrix() == Matrix4x4());
+  CHECK(q(p) == p);
+  CHECK(NearlyEqual(q(v), v));
+  CHECK(q * q == q);
+  CHECK(Quaternion(Transform()) == q);
+}
+
+// Verify rotations about an axis match the rotation transforms
+TEST_CASE("QuaternionAxisAngle", "[quaternion]") {
+  float range = 4.f;
+  float step = 0.25f;
+  Point p = Point(1, 2, 3);
+  Vector v = Vector(-3, 0.5, 2);
+
+  for (float a = -range; a < range; a+=step) {
+    CHECK(AxisAngle(Vector(1, 0, 0), a)(p) == RotateX(a)(p));
+    CHECK(AxisAngle(Vector(0, 1, 0), a)(p) == RotateY(a)(p));
+    CHECK(NearlyEqual(AxisAngle(Vector(0, 0, 1), a)(v), RotateZ(a)(v)));
+    CHECK(NearlyEqual(AxisAngle(Vector(0, 0, 2), a).Matrix(),
+                      RotateZ(a).Matrix()));
+  }
+}
+
+// Verify conversion from a transform and back, including rotations of
+// nearly pi where the trace is close to -1
+TEST_CASE("QuaternionTransformRoundTrip", "[quaternion]") {
+  float range = PI;
+  float step = 0.3f;
+  Vector t = Vector(1, -2, 3);
+
+  for (float i = -range; i < range; i+=step) {
+    for (float j = -range; j < range; j+=step) {
+      Transform r = RotateX(i) * RotateY(j) * RotateZ(0.5f * i - j);
+      Quaternion q = Quaternion(r);
+
+      CHECK(Length(q) == Approx(1.f).epsilon(0.001));
+      CHECK(NearlyEqual(q.Matrix(), r.Matrix()));
+      CHECK(NearlyEqual(QuaternionTransform(q, t).Matrix(),
+                        (Translate(t) * r).Matrix()));
+      CHECK(QuaternionTransform(q, t).IsRigid());
+    }
+  }
+
+  for (int axis = 0; axis < 3; axis++) {
+    Vector a = Vector(axis == 0, axis == 1, axis == 2);
+    Quaternion q = AxisAngle(a + Vector(0.01f, 0.02f, 0.f), PI - 0.0001f);
+    CHECK(SameRotation(Quaternion(QuaternionTransform(q, t)), q));
+  }
+}
+
+// Verify composition matches the composition of transforms, in the same
+// order, and the conjugate is the inverse rotation
+TEST_CASE("QuaternionConcatenation", "[quaternion]") {
+  float range = 3.f;
+  float step = 0.25f;
+  Point p = Point(2, -1, 0.5);
+
+  for (float i = -range; i < range; i+=step) {
+    Quaternion a = AxisAngle(Vector(1, 2, 3), i);
+    Quaternion b = AxisAngle(Vector(-2, 0.5, 1), 0.7f * i);
+
+    CHECK(NearlyEqual((a * b).Matrix(), (Transform(a.Matrix()) *
+                                         Transform(b.Matrix())).Matrix()));
+    CHECK((a * b)(p) == a(b(p)));
+    CHECK((Conjugate(a) * a) == Quaternion());
+
+    Quaternion c = a;
+    c *= b;
+    CHECK(c == a * b);
+  }
+}
+
+// Verify the Euler quaternions of every order match EulerTransform, and
+// EulerAngles recovers angles giving the same rotation
+TEST_CASE("QuaternionEulerRoundTrip", "[quaternion]") {
+  float range = 3.f;
+  float step = 0.7f;
+
+  for (int o = ROT_XYZ; o <= ROT_ZYX; o++) {
+    RotationOrder order = static_cast<RotationOrder>(o);
+
+    for (float i = -range; i < range; i+=step) {
+      for (float j = -range; j < range; j+=step) {
+        for (float k = -range; k < range; k+=step) {
+          Transform e = EulerTransform(order, i, j, k);
+          Quaternion q = EulerQuaternion(order, i, j, k);
+          CHECK(NearlyEqual(q.Matrix(), e.Matrix()));
+          CHECK(SameRotation(q, Quaternion(e)));
+
+          float a[3];
+          EulerAngles(q, order, a);
+          CHECK(a[1] >= -PI / 2.f);
+          CHECK(a[1] <= PI / 2.f);
+          CHECK(NearlyEqual(EulerTransform(order, a[0], a[1], a[2]).Matrix(),
+                            e.Matrix()));
+        }
+      }
+    }
+  }
+}
+
+// Verify EulerAngles in gimbal lock, where the middle angle is +/-pi/2 and
+// only a combination of the outer angles is defined
+TEST_CASE("QuaternionEulerGimbalLock", "[quaternion]") {
+  float range = 3.f;
+  float step = 0.5f;
+  float middle[2] = {-PI / 2.f, PI / 2.f};
+
+  for (int o = ROT_XYZ; o <= ROT_ZYX; o++) {
+    RotationOrder order = static_cast<RotationOrder>(o);
+
+    for (float i = -range; i < range; i+=step) {
+      for (float k = -range; k < range; k+=step) {
+        for (int m = 0; m < 2; m++) {
+          float j = middle[m];
+          Transform e = EulerTransform(order, i, j, k);
+          float a[3];
+          EulerAngles(EulerQuaternion(order, i, j, k), order, a);
+
+          CHECK(a[2] == 0.f);
+          CHECK(NearlyEqual(EulerTransform(order, a[0], a[1], a[2]).Matrix(),
+                            e.Matrix()));
+        }
+      }
+    }
+  }
+}
+
+// Verify interpolation ends at either rotation, takes the shortest arc and
+// runs at a constant rate for Slerp
+TEST_CASE("QuaternionSlerp", "[quaternion]") {
+  Vector axis = Vector(1, 1, 0);
+  Quaternion a = AxisAngle(axis, 0.2f);
+  Quaternion b = AxisAngle(axis, 1.4f);
+
+  CHECK(Slerp(0.f, a, b) == a);
+  CHECK(Slerp(1.f, a, b) == b);
+  CHECK(Nlerp(0.f, a, b) == a);
+  CHECK(Nlerp(1.f, a, b) == b);
+  CHECK(SameRotation(Slerp(1.f, a, -b), b));
+
+  for (float t = 0.f; t <= 1.f; t+=0.125f) {
+    Quaternion expected = AxisAngle(axis, 0.2f + 1.2f * t);
+    CHECK(Slerp(t, a, b) == expected);
+    CHECK(Slerp(t, a, -b) == expected);
+    CHECK(NearlyEqual(Nlerp(t, a, b)(axis), axis));
+    CHECK(Length(Nlerp(t, a, b)) == Approx(1.f).epsilon(0.001));
+  }
+  CHECK(Nlerp(0.5f, a, b) == Slerp(0.5f, a, b));
+
+  // Nearly identical rotations
+  Quaternion c = AxisAngle(axis, 0.2001f);
+  CHECK(Slerp(0.5f, a, c) == a);
+}
+
+// Verify the structure-of-arrays batches match the scalar functions,
+// including the leftovers that do not fill a lane
+TEST_CASE("QuaternionArrays", "[quaternion]") {
+  const int n = 19;
+  float a[4][n], b[4][n], r[4][n];
+  float c[3][n], s[3][n];
+  QuaternionArrays qa = {a[0], a[1], a[2], a[3]};
+  QuaternionArrays qb = {b[0], b[1], b[2], b[3]};
+  QuaternionArrays qr = {r[0], r[1], r[2], r[3]};
+
+  for (int i = 0; i < n; i++) {
+    Quaternion p = AxisAngle(Vector(1, i, 2), 0.3f * i);
+    Quaternion q = AxisAngle(Vector(-i, 1, 0.5), -0.2f * i);
+    a[0][i] = p.w; a[1][i] = p.x; a[2][i] = p.y; a[3][i] = p.z;
+    b[0][i] = q.w; b[1][i] = q.x; b[2][i] = q.y; b[3][i] = q.z;
+    for (int k = 0; k < 3; k++) {
+      c[k][i] = std::cos(0.5f * (i - k));
+      s[k][i] = std::sin(0.5f * (i - k));
+    }
+  }
+
+  MulQuaternions(qa, qb, n, qr);
+  for (int i = 0; i < n; i++) {
+    Quaternion p = Quaternion(a[0][i], a[1][i], a[2][i], a[3][i]);
+    Quaternion q = Quaternion(b[0][i], b[1][i], b[2][i], b[3][i]);
+    CHECK(Quaternion(r[0][i], r[1][i], r[2][i], r[3][i]) == p * q);
+  }
+
+  for (int i = 0; i < n; i++)
+    r[0][i] *= 3.f;
+  NormalizeQuaternions(qr, n);
+  for (int i = 0; i < n; i++) {
+    Quaternion q = Quaternion(r[0][i], r[1][i], r[2][i], r[3][i]);
+    CHECK(Length(q) == Approx(1.f).epsilon(0.001));
+  }
+
+  const float *cs[3] = {c[0], c[1], c[2]};
+  const float *ss[3] = {s[0], s[1], s[2]};
+  for (int o = ROT_XYZ; o <= ROT_ZYX; o++) {
+    RotationOrder order = static_cast<RotationOrder>(o);
+    EulerQuaternions(order, cs, ss, n, qr);
+    for (int i = 0; i < n; i++) {
+      Quaternion q = EulerQuaternion(order, i, i - 1.f, i - 2.f);
+      CHECK(Quaternion(r[0][i], r[1][i], r[2][i], r[3][i]) == q);
+    }
+  }
+}
+
+// Verify the batched interpolation stays close to Slerp for pairs at any
+// angle, on either side of the shortest arc
+TEST_CASE("QuaternionSlerpArrays", "[quaternion]") {
+  const int n = 23;
+  float a[4][n], b[4][n], r[4][n];
+  QuaternionArrays qa = {a[0], a[1], a[2], a[3]};
+  QuaternionArrays qb = {b[0], b[1], b[2], b[3]};
+  QuaternionArrays qr = {r[0], r[1], r[2], r[3]};
+
+  for (int i = 0; i < n; i++) {
+    Quaternion p = AxisAngle(Vector(1, i, 2), 0.4f * i);
+    Quaternion q = AxisAngle(Vector(-i, 1, 0.5), -0.3f * i);
+    if (i % 2)
+      q = -q;
+    a[0][i] = p.w; a[1][i] = p.x; a[2][i] = p.y; a[3][i] = p.z;
+    b[0][i] = q.w; b[1][i] = q.x; b[2][i] = q.y; b[3][i] = q.z;
+  }
+
+  for (float t = 0.f; t <= 1.f; t+=0.1f) {
+    SlerpQuaternions(t, qa, qb, n, qr);
+    for (int i = 0; i < n; i++) {
+      Quaternion p = Quaternion(a[0][i], a[1][i], a[2][i], a[3][i]);
+      Quaternion q = Quaternion(b[0][i], b[1][i], b[2][i], b[3][i]);
+      Quaternion s = Quaternion(r[0][i], r[1][i], r[2][i], r[3][i]);
+      CHECK(s == Slerp(t, p, q));
+      CHECK(Length(s) == Approx(1.f).epsilon(0.001));
+    }
+  }
+
+  SlerpQuaternions(1.f, qa, qb, n, qa);
+  for (int i = 0; i < n; i++) {
+    Quaternion p = Quaternion(a[0][i], a[1][i], a[2][i], a[3][i]);
+    Quaternion q = Quaternion(b[0][i], b[1][i], b[2][i], b[3][i]);
+    CHECK((p == q || p == -q));
+  }
+}
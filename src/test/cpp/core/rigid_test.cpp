@@ -0,0 +1,98 @@
+#include <catch/catch.hpp>
+#include <core/matrix.h>
+#include <core/rigid.h>
+#include <core/transform.h>
+#include <core/vector.h>
+#include <core/point.h>
+
+#include "../helpers.h"
+
+using namespace ishi;
+
+// Verify the default transform is the identity
+TEST_CASE("RigidIdentity", "[rigid]") {
+  RigidTransform t;
+  Point p = Point(5.1, 6.2, 7.3);
+  Vector v = Vector(-1.5, 2.5, 0.5);
+
+  CHECK(t.Matrix() == Matrix4x4());
+  CHECK(t(p) == p);
+  CHECK(t(v) == v);
+  CHECK(Inverse(t) == t);
+}
+
+// Verify a rigid transform acts on points and vectors like the Transform
+// it was made from
+TEST_CASE("RigidMatchesTransform", "[rigid]") {
+  float range = 2.f;
+  float step = 0.25f;
+
+  for (float i = -range; i < range; i+=step) {
+    for (float j = -range; j < range; j+=step) {
+      Point p = Point(i, j, i * j);
+      Vector v = Vector(j, i, 1.f);
+      Transform t = RigidSample(i, Vector(j, i, 3.f));
+      RigidTransform r = RigidTransform(t);
+
+      CHECK(r(p) == t(p));
+      CHECK(r(v) == t(v));
+      CHECK(r.Invert(p) == t.Invert(p));
+      CHECK(r.Invert(v) == t.Invert(v));
+      CHECK(NearlyEqual(r.Matrix(), t.Matrix()));
+      CHECK(RigidTransform(t.Matrix()) == r);
+
+      Point q = p;
+      Vector w = v;
+      CHECK(r.Apply(&q) == t(p));
+      CHECK(r.Apply(&w) == t(v));
+    }
+  }
+}
+
+// Verify composition matches the composition of general transforms, in
+// the same order
+TEST_CASE("RigidConcatenation", "[rigid]") {
+  float range = 2.f;
+  float step = 0.25f;
+
+  for (float i = -range; i < range; i+=step) {
+    Transform a = RigidSample(i, Vector(i, 1.f, -2.f));
+    Transform b = RigidSample(-0.5f * i, Vector(0.5f, i, i));
+    RigidTransform ra = RigidTransform(a);
+    RigidTransform rb = RigidTransform(b);
+    Point p = Point(i, 2.f, -i);
+
+    CHECK(NearlyEqual((ra * rb).Matrix(), (a * b).Matrix()));
+    CHECK((ra * rb)(p) == ra(rb(p)));
+
+    RigidTransform c = ra;
+    c *= rb;
+    CHECK(c == ra * rb);
+  }
+}
+
+// Verify the closed-form inverse undoes the transform and matches the
+// inverse of the general transform
+TEST_CASE("RigidInverse", "[rigid]") {
+  float range = 2.f;
+  float step = 0.25f;
+
+  for (float i = -range; i < range; i+=step) {
+    Transform t = RigidSample(i, Vector(-i, 4.f, i));
+    RigidTransform r = RigidTransform(t);
+    Point p = Point(1.f, i, 3.f);
+
+    CHECK((r * Inverse(r))(p) == p);
+    CHECK((Inverse(r) * r)(p) == p);
+    CHECK(NearlyEqual(Inverse(r).Matrix(), Inverse(t).Matrix()));
+
+    Transform back = r.ToTransform();
+    CHECK(NearlyEqual(back.Matrix(), t.Matrix()));
+    CHECK(NearlyEqual(Inverse(back).Matrix(), Inverse(t).Matrix()));
+  }
+}
+
+// Verify the transform takes 48 bytes
+TEST_CASE("RigidSize", "[rigid]") {
+  CHECK(sizeof(RigidTransform) == 48);
+}
@@ -0,0 +1,58 @@
+#include <catch/catch.hpp>
+#include <core/sincos.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace ishi;
+
+// Verify the documented error bound against double precision, over a range
+// wide enough to cover accumulated BVH angles. The count is not a multiple
+// of four so both the SIMD and the scalar path are exercised.
+TEST_CASE("SinCosDegreesAccuracy", "[sincos]") {
+  std::vector<float> degrees;
+  for (double d = -100000.0; d <= 100000.0; d += 0.37)
+    degrees.push_back(static_cast<float>(d));
+  degrees.push_back(1e-30f);
+  degrees.push_back(-45.f);
+
+  std::vector<float> s(degrees.size()), c(degrees.size());
+  SinCosDegrees(&degrees[0], degrees.size(), &s[0], &c[0]);
+
+  double maxError = 0.0;
+  for (size_t i = 0; i < degrees.size(); i++) {
+    double radian = degrees[i] * M_PI / 180.0;
+    maxError = std::max(maxError, std::fabs(s[i] - std::sin(radian)));
+    maxError = std::max(maxError, std::fabs(c[i] - std::cos(radian)));
+  }
+  CHECK(maxError < 1.2e-7);
+}
+
+// Verify exact results at multiples of 90 degrees
+TEST_CASE("SinCosDegreesQuadrants", "[sincos]") {
+  float degrees[9] = {0, 90, 180, 270, 360, -90, -180, -270, 720};
+  float sines[9] = {0, 1, 0, -1, 0, -1, 0, 1, 0};
+  float cosines[9] = {1, 0, -1, 0, 1, 0, -1, 0, 1};
+  float s[9], c[9];
+
+  SinCosDegrees(degrees, 9, s, c);
+  for (int i = 0; i < 9; i++) {
+    CHECK(s[i] == sines[i]);
+    CHECK(c[i] == cosines[i]);
+  }
+}
+
+// Verify that the SIMD and scalar paths agree bit for bit
+TEST_CASE("SinCosDegreesBatchMatchesSingle", "[sincos]") {
+  float degrees[8] = {-721.5f, -33.3f, 0.1f, 44.9f, 45.1f, 135.f, 290.7f,
+                      12345.6f};
+  float s[8], c[8];
+
+  SinCosDegrees(degrees, 8, s, c);
+  for (int i = 0; i < 8; i++) {
+    float si, ci;
+    SinCosDegrees(degrees + i, 1, &si, &ci);
+    CHECK(s[i] == si);
+    CHECK(c[i] == ci);
+  }
+}
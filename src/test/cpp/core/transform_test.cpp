@@ -1,9 +1,11 @@
 #include <catch/catch.hpp>
+#include <core/matrix.h>
 #include <core/transform.h>
 #include <core/vector.h>
 #include <core/point.h>
 
 #include <cstdio>
+#include <cstring>
 
 using namespace ishi;
 
@@ -149,4 +151,135 @@ TEST_CASE("AlignNonParallel", "[transform]") {
 
   CHECK(Vector(0.f, 0.f, 5.6) == AlignZ(Vector(0.f, 5.6, 0.f))(Vector(0.f, 5.6, 0.f)));
   CHECK(Vector(0.f, 0.f, 5.6) == AlignZ(Vector(5.6, 0.f, 0.f))(Vector(5.6, 0.f, 0.f)));
-}
\ No newline at end of file
+}
+
+// Verify that rigid transforms stay rigid under composition and inversion,
+// and that mixing in a general matrix does not
+TEST_CASE("RigidnessTracked", "[transform]") {
+  Transform rigid = Translate(Vector(1.f, 2.f, 3.f)) * RotateX(0.5f) *
+                    AlignY(Vector(1.f, 1.f, 0.f));
+  CHECK(Transform().IsRigid());
+  CHECK(rigid.IsRigid());
+  CHECK(Inverse(rigid).IsRigid());
+
+  Matrix4x4 scale = Matrix4x4(2.f, 0.f, 0.f, 0.f,
+                              0.f, 3.f, 0.f, 0.f,
+                              0.f, 0.f, 4.f, 0.f,
+                              0.f, 0.f, 0.f, 1.f);
+  CHECK(!Transform(scale).IsRigid());
+  CHECK(!(rigid * Transform(scale)).IsRigid());
+  CHECK(Rigid(rigid.Matrix()).IsRigid());
+}
+
+// Verify that inverses formed on demand match inverses given up front, for
+// general, rigid and mixed compositions
+TEST_CASE("LazyInverses", "[transform]") {
+  Matrix4x4 mat = Matrix4x4(2.f, 0.f, 0.f, 1.f,
+                            0.f, 0.5f, 0.f, -2.f,
+                            0.f, 0.f, 4.f, 3.f,
+                            0.f, 0.f, 0.f, 1.f);
+  Transform general = Transform(mat);
+  Transform given = Transform(mat, Inverse(mat));
+  Transform rigid = Translate(Vector(-1.f, 0.5f, 2.f)) * RotateZ(1.1f) *
+                    RotateY(-0.3f);
+  Point p = Point(0.3f, -1.7f, 2.9f);
+  Vector v = Vector(1.5f, 0.25f, -0.75f);
+
+  CHECK(general.Invert(p) == given.Invert(p));
+  CHECK(general.Invert(v) == given.Invert(v));
+  CHECK(general(general.Invert(p)) == p);
+  CHECK(rigid(rigid.Invert(p)) == p);
+  CHECK(Length(rigid(rigid.Invert(v)) - v) < 0.001f);
+
+  Transform mixed = rigid * general * rigid;
+  Transform mixedGiven = rigid * given * rigid;
+  CHECK(mixed.Invert(p) == mixedGiven.Invert(p));
+  CHECK(mixed(Inverse(mixed)(p)) == p);
+  CHECK(Inverse(Inverse(mixed))(p) == mixed(p));
+
+  Point q = mixed(p);
+  Vector w = mixed(v);
+  CHECK(mixed.ApplyInvert(&q) == p);
+  CHECK(Length(mixed.ApplyInvert(&w) - v) < 0.001f);
+}
+
+// Verify that a transform reports whether its matrix could be inverted,
+// through compositions and inversion
+TEST_CASE("InvertibilityReported", "[transform]") {
+  Matrix4x4 flat = Matrix4x4(1.f, 0.f, 0.f, 2.f,
+                             0.f, 1.f, 0.f, 0.f,
+                             0.f, 0.f, 0.f, 0.f,
+                             0.f, 0.f, 0.f, 1.f);
+  Transform rigid = Translate(Vector(500.f, 90.f, 300.f)) * RotateY(0.7f);
+  Point p = Point(0.3f, -1.7f, 2.9f);
+
+  CHECK(rigid.Invertibility() == INVERSE_OK);
+  CHECK(Transform(rigid.Matrix()).Invertibility() == INVERSE_OK);
+  CHECK(Transform(flat).Invertibility() == INVERSE_SINGULAR);
+  CHECK(Transform(flat).Invert(p) == p);
+  CHECK((rigid * Transform(flat)).Invertibility() == INVERSE_SINGULAR);
+  CHECK(Inverse(Transform(flat)).Invertibility() == INVERSE_SINGULAR);
+
+  Transform singular = Transform(flat);
+  singular.Invert(p);
+  CHECK((rigid * singular).Invertibility() == INVERSE_SINGULAR);
+  CHECK((singular * rigid).Invertibility() == INVERSE_SINGULAR);
+}
+
+// Verify that inverting a rigid transform leaves it untouched, so that
+// threads may share it
+TEST_CASE("RigidInverseNotCached", "[transform]") {
+  const Transform rigid = Translate(Vector(1.f, -2.f, 0.5f)) * RotateX(0.4f);
+  unsigned char before[sizeof(Transform)];
+  memcpy(before, &rigid, sizeof(Transform));
+  Point p = Point(0.3f, -1.7f, 2.9f);
+  Vector v = Vector(1.5f, 0.25f, -0.75f);
+
+  rigid.Invert(p);
+  rigid.Invert(v);
+  Inverse(rigid);
+  CHECK(rigid.Invertibility() == INVERSE_OK);
+  CHECK(memcmp(&rigid, before, sizeof(Transform)) == 0);
+}
+
+// Verify transforming arrays of points and vectors matches transforming
+// them one at a time, for rigid and projective transforms
+TEST_CASE("TransformArrays", "[transform]") {
+  const int n = 17;
+  float a[3][n], r[3][n];
+  PointArrays pa = {a[0], a[1], a[2]};
+  PointArrays pr = {r[0], r[1], r[2]};
+  VectorArrays va = {a[0], a[1], a[2]};
+  VectorArrays vr = {r[0], r[1], r[2]};
+  Transform transforms[2] = {
+    Translate(Vector(1, -2, 3)) * RotateY(0.7f) * RotateX(-0.3f),
+    Transform(Matrix4x4(1.f, 0.f, 0.f, 0.f,
+                        0.f, 2.f, 0.f, 1.f,
+                        0.f, 0.f, 1.f, 0.f,
+                        0.f, 0.f, 0.5f, 2.f))};
+
+  for (int t = 0; t < 2; t++) {
+    const Transform &tr = transforms[t];
+    for (int i = 0; i < n; i++) {
+      a[0][i] = 0.5f * i;
+      a[1][i] = 1.f - i;
+      a[2][i] = 0.25f * i;
+    }
+
+    TransformPoints(tr, pa, n, pr);
+    for (int i = 0; i < n; i++)
+      CHECK(Point(r[0][i], r[1][i], r[2][i]) ==
+            tr(Point(a[0][i], a[1][i], a[2][i])));
+
+    TransformVectors(tr, va, n, vr);
+    for (int i = 0; i < n; i++) {
+      Vector e = tr(Vector(a[0][i], a[1][i], a[2][i]));
+      CHECK(Length(Vector(r[0][i], r[1][i], r[2][i]) - e) < 0.001f);
+    }
+
+    TransformPoints(tr, pa, n, pa);
+    for (int i = 0; i < n; i++)
+      CHECK(Point(a[0][i], a[1][i], a[2][i]) ==
+            tr(Point(0.5f * i, 1.f - i, 0.25f * i)));
+  }
+}
@@ -2,6 +2,8 @@
 
 #include <core/vector.h>
 
+#include <cmath>
+
 using namespace ishi;
 
 TEST_CASE("VectorConstructor", "[vector]") {
@@ -247,3 +249,53 @@ TEST_CASE("CoordinateSystemBasesUnitLength", "[vector]") {
   CHECK(Length(v2) == Approx(1).epsilon(0.001));
   CHECK(Length(v3) == Approx(1).epsilon(0.001));
 }
+
+// Verify the structure-of-arrays batches match the functions on single
+// vectors, including the leftovers that do not fill a lane and in place
+TEST_CASE("VectorArrays", "[vector]") {
+  const int n = 21;
+  float a[3][n], b[3][n], r[3][n], d[n];
+  VectorArrays va = {a[0], a[1], a[2]};
+  VectorArrays vb = {b[0], b[1], b[2]};
+  VectorArrays vr = {r[0], r[1], r[2]};
+  Vector u[n], v[n];
+
+  for (int i = 0; i < n; i++) {
+    u[i] = Vector(0.5f * i, 1.f - i, 2.f);
+    v[i] = (i % 7 == 3) ? Vector() : Vector(-1.f, 0.25f * i, 3.f - i);
+    a[0][i] = u[i].x; a[1][i] = u[i].y; a[2][i] = u[i].z;
+    b[0][i] = v[i].x; b[1][i] = v[i].y; b[2][i] = v[i].z;
+  }
+
+  AddVectors(va, vb, n, vr);
+  for (int i = 0; i < n; i++)
+    CHECK(Vector(r[0][i], r[1][i], r[2][i]) == u[i] + v[i]);
+
+  ScaleVectors(va, -1.5f, n, vr);
+  for (int i = 0; i < n; i++)
+    CHECK(Vector(r[0][i], r[1][i], r[2][i]) == u[i] * -1.5f);
+
+  DotVectors(va, vb, n, d);
+  for (int i = 0; i < n; i++)
+    CHECK(d[i] == Dot(u[i], v[i]));
+
+  CrossVectors(va, vb, n, vr);
+  for (int i = 0; i < n; i++)
+    CHECK(Vector(r[0][i], r[1][i], r[2][i]) == Cross(u[i], v[i]));
+
+  LengthVectors(vb, n, d);
+  for (int i = 0; i < n; i++)
+    CHECK(d[i] == Approx(Length(v[i])));
+
+  NormalizeVectors(vb, n, vr);
+  for (int i = 0; i < n; i++)
+    CHECK(Vector(r[0][i], r[1][i], r[2][i]) == Normalize(v[i]));
+
+  NormalizeVectors(vb, n, vb, true);
+  for (int i = 0; i < n; i++) {
+    Vector e = Normalize(v[i]);
+    CHECK(std::fabs(b[0][i] - e.x) < 0.00001f);
+    CHECK(std::fabs(b[1][i] - e.y) < 0.00001f);
+    CHECK(std::fabs(b[2][i] - e.z) < 0.00001f);
+  }
+}
@@ -0,0 +1,73 @@
+#include <catch/catch.hpp>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "clip_view.h"
+#include "joint.h"
+#include "playback.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+// Verify views map their frames onto the ranges they were built from,
+// without copying any
+TEST_CASE("ClipViewFrames", "[clip_view]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  ClipView view(sg->clip, 2, 5);
+
+  REQUIRE(view.Append(sg->clip, 8, 12));
+  REQUIRE(view.Append(ClipView(sg->clip, 0, 1)));
+  CHECK(view.NumFrames() == 8);
+  CHECK(view.FrameSize() == sg->clip->FrameSize());
+  CHECK(view.Frame(0) == sg->Frame(2));
+  CHECK(view.Frame(3) == sg->Frame(8));
+  CHECK(view.Frame(7) == sg->Frame(0));
+  CHECK_FALSE(view.Append(sg->clip, 10, 13));
+  CHECK(view.NumFrames() == 8);
+
+  ClipView trimmed = view.Trim(1, 5);
+  CHECK(trimmed.NumFrames() == 4);
+  CHECK(trimmed.Frame(0) == sg->Frame(3));
+  CHECK(trimmed.Frame(3) == sg->Frame(9));
+
+  vector<float> frames;
+  trimmed.Materialize(&frames);
+  REQUIRE(frames.size() == 4 * trimmed.FrameSize());
+  for (uint32_t f = 0; f < trimmed.NumFrames(); f++) {
+    CHECK(memcmp(&frames[f * trimmed.FrameSize()], trimmed.Frame(f),
+                 trimmed.FrameSize() * sizeof(float)) == 0);
+  }
+}
+
+// Verify playing a view evaluates the frames it maps to, and views of
+// another skeleton are refused
+TEST_CASE("ClipViewPlayback", "[clip_view]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  unique_ptr<SceneGraph> folded = LoadFixture(0.f);
+  const Skeleton &skeleton = sg->clip->skeleton;
+  ClipView view(sg->clip, 6, 12);
+  REQUIRE(view.Append(sg->clip, 0, 3));
+  PlaybackInstance instance(sg->clip);
+  vector<Transform> world(skeleton.NumJoints());
+
+  REQUIRE(instance.Play(&view));
+  CHECK(instance.NumFrames() == 9);
+  for (uint32_t f = 0; f < view.NumFrames(); f++) {
+    instance.SetCurrentFrame(f);
+    skeleton.Evaluate(view.Frame(f), &world[0]);
+    CHECK(NearlyEqual(&instance.world[0], &world[0], skeleton.NumJoints()));
+  }
+
+  ClipView foreign(folded->clip);
+  CHECK_FALSE(instance.Play(&foreign));
+  CHECK(instance.NumFrames() == 9);
+  REQUIRE(instance.Play(NULL));
+  CHECK(instance.NumFrames() == sg->NumFrames());
+}
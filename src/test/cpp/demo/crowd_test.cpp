@@ -0,0 +1,95 @@
+#include <catch/catch.hpp>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "crowd.h"
+#include "joint.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Return a root placing a member at x along the X axis
+static Matrix4x4 RootAt(float x) {
+  return Translate(Vector(x, 0.f, 0.f)).Matrix();
+}
+
+// Verify every member's pose is its frame's evaluation placed at its root,
+// at the frame its own time offset and rate give
+TEST_CASE("CrowdMatchesSkeleton", "[crowd]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  uint32_t n = skeleton.NumJoints();
+  float duration = sg->NumFrames() * sg->MsPerFrame();
+  Crowd crowd(2);
+  vector<Transform> world(n);
+
+  for (int i = 0; i < 40; i++)
+    crowd.Add(sg->clip, 11.f * i, (i % 3) ? 1.f : 0.5f, RootAt(i));
+  crowd.SetLod(5, 1);
+  crowd.SetLod(6, 3);
+  crowd.Update(100.f);
+
+  for (uint32_t i = 0; i < crowd.Size(); i++) {
+    const CrowdMember &m = crowd.Member(i);
+    float t = fmod(m.timeOffset + m.rate * 100.f, duration);
+    CHECK(m.currentFrame == static_cast<uint32_t>(t / sg->MsPerFrame()));
+
+    skeleton.Evaluate(sg->Frame(m.currentFrame), &world[0]);
+    for (uint32_t j = 0; j < n; j++) {
+      if (skeleton.lods[j] >= m.lod)
+        CHECK(NearlyEqual(Mul(m.root, world[j].Matrix()), crowd.Pose(i)[j]));
+    }
+  }
+  CHECK(crowd.Stats().evaluated == crowd.Size());
+}
+
+// Verify a budget updates every foreground member and only the allowed
+// number of background ones each tick, reaching all of them in turn, and
+// that reused poses follow their root
+TEST_CASE("CrowdBudgetScheduling", "[crowd]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  Crowd crowd(2);
+  UpdateBudget budget;
+
+  for (int i = 0; i < 30; i++)
+    crowd.Add(sg->clip, 7.f * i, 1.f, RootAt(i));
+  crowd.Update(0.f);
+  for (uint32_t i = 0; i < crowd.Size(); i++)
+    crowd.SetPriority(i, (i < 5) ? kForegroundPriority : 0.5f);
+  budget.maxMembers = 5;
+  crowd.SetBudget(budget);
+
+  vector<uint32_t> updates(crowd.Size(), 0);
+  for (int tick = 0; tick < 10; tick++) {
+    vector<uint32_t> before(crowd.Size());
+    for (uint32_t i = 0; i < crowd.Size(); i++)
+      before[i] = crowd.Member(i).currentFrame;
+    crowd.Update(sg->MsPerFrame());
+    CHECK(crowd.Stats().evaluated == 10);
+    CHECK(crowd.Stats().reused == 20);
+    for (uint32_t i = 0; i < crowd.Size(); i++)
+      updates[i] += crowd.Member(i).currentFrame != before[i];
+  }
+  for (uint32_t i = 0; i < crowd.Size(); i++)
+    CHECK(updates[i] == ((i < 5) ? 10u : 2u));
+
+  // A member left out of the tick is moved with its root
+  budget.maxMembers = 0;
+  budget.maxMs = 1e-9f;
+  crowd.SetBudget(budget);
+  Matrix4x4 pose = crowd.Pose(20)[3];
+  uint32_t frame = crowd.Member(20).currentFrame;
+  crowd.SetRoot(20, RootAt(120.f));
+  crowd.Update(sg->MsPerFrame());
+  CHECK(crowd.Member(20).currentFrame == frame);
+  CHECK(crowd.Stats().moved == 1);
+  CHECK(crowd.Pose(20)[3].m[0][3] == Approx(pose.m[0][3] + 100.f));
+}
@@ -0,0 +1,67 @@
+#include <catch/catch.hpp>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "joint.h"
+#include "loader.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+unique_ptr<SceneGraph> LoadFixture(float staticEpsilon, bool storeRotations) {
+  unique_ptr<SceneGraph> sg(new SceneGraph());
+  sg->staticEpsilon = staticEpsilon;
+  sg->storeRotations = storeRotations;
+  BVHLoader::loadBVH(TEST_DATA_DIR "/fixture.bvh", sg.get());
+  REQUIRE(sg->root);
+  REQUIRE(sg->NumFrames() == 12);
+  return sg;
+}
+
+/// Segments are indexed by id while walking the tree, since the skeleton
+/// records the id of the segment behind each joint.
+vector<Matrix4x4> SegmentPose(SceneGraph *sg, uint32_t frameNumber) {
+  const Skeleton &skeleton = sg->clip->skeleton;
+  vector<float> source(skeleton.sourceFrameSize);
+  skeleton.Unpack(sg->Frame(frameNumber), &source[0]);
+  sg->root->Update(&source[0]);
+
+  vector<Segment*> byId;
+  vector<Segment*> stack(1, sg->root);
+  while (!stack.empty()) {
+    Segment *s = stack.back();
+    stack.pop_back();
+    if (s->id >= byId.size())
+      byId.resize(s->id + 1);
+    byId[s->id] = s;
+    stack.insert(stack.end(), s->chd.begin(), s->chd.end());
+  }
+
+  vector<Matrix4x4> pose(skeleton.NumJoints());
+  for (uint32_t j = 0; j < skeleton.NumJoints(); j++)
+    pose[j] = byId[skeleton.ids[j]]->w2o.Matrix();
+  return pose;
+}
+
+bool NearlyEqual(const Transform *a, const Transform *b, uint32_t n) {
+  for (uint32_t j = 0; j < n; j++) {
+    if (!NearlyEqual(a[j].Matrix(), b[j].Matrix()))
+      return false;
+  }
+  return true;
+}
+
+bool NearlyEqual(const Transform *a, const Matrix4x4 *b, uint32_t n) {
+  for (uint32_t j = 0; j < n; j++) {
+    if (!NearlyEqual(a[j].Matrix(), b[j]))
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,34 @@
+#ifndef TEST_DEMO_FIXTURE_H_
+#define TEST_DEMO_FIXTURE_H_
+
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "joint.h"
+
+using namespace std;
+using namespace ishi;
+
+/// Load the small motion the demo tests share: nine joints and five end
+/// sites over twelve frames, with a static head, one joint in another
+/// rotation order, a right leg held from frame 5 on and frame 7 repeating
+/// frame 6. Static channels are folded with staticEpsilon (negative leaves
+/// them) and rotations stored if requested.
+unique_ptr<SceneGraph> LoadFixture(float staticEpsilon = -1.f,
+                                   bool storeRotations = false);
+
+/// Return the world matrix of every joint at a frame as Segment::Update
+/// computes it, in the skeleton's joint order
+vector<Matrix4x4> SegmentPose(SceneGraph *sg, uint32_t frameNumber);
+
+/// Return true if two poses of n joints nearly match at every joint
+bool NearlyEqual(const Transform *a, const Transform *b, uint32_t n);
+
+/// Return true if a pose nearly matches world matrices at every joint
+bool NearlyEqual(const Transform *a, const Matrix4x4 *b, uint32_t n);
+
+#endif
@@ -0,0 +1,71 @@
+#include <catch/catch.hpp>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "joint.h"
+#include "joint_query.h"
+#include "thread_pool.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+// Verify queried joints get the world transforms of a full evaluation, with
+// or without a pool, evaluating only them and their ancestors
+TEST_CASE("JointQueryMatchesSkeleton", "[joint_query]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const char *names[] = {"LeftFoot", "Head", "Hips", "Tail"};
+  int32_t ids[4];
+  sg->JointIndices(names, 4, ids);
+  JointQuery query(skeleton, ids, 4);
+  ThreadPool pool(2);
+  const uint32_t begin = 2, end = 11, numFrames = end - begin;
+  vector<float> out(query.OutputSize(numFrames));
+  vector<float> pooled(query.OutputSize(numFrames));
+  vector<Transform> world(skeleton.NumJoints());
+
+  // LeftFoot and Head share the root; Tail is unknown
+  CHECK(query.NumQueried() == 4);
+  CHECK(query.NumEvaluated() == 6);
+  CHECK(out.size() == 4 * kQueryValues * numFrames);
+  REQUIRE(query.Run(*sg->clip, begin, end, &out[0]));
+  REQUIRE(query.Run(*sg->clip, begin, end, &pooled[0], &pool));
+  CHECK(out == pooled);
+
+  for (uint32_t f = begin; f < end; f++) {
+    skeleton.Evaluate(sg->Frame(f), &world[0]);
+    for (uint32_t q = 0; q < 4; q++) {
+      Matrix4x4 expected = (ids[q] >= 0) ? world[ids[q]].Matrix() :
+          Matrix4x4();
+      Matrix4x4 queried;
+      for (uint32_t e = 0; e < kQueryValues; e++)
+        queried.m[e / 4][e % 4] = out[(q * kQueryValues + e) * numFrames +
+                                      f - begin];
+      CHECK(NearlyEqual(expected, queried));
+    }
+  }
+}
+
+// Verify queries refuse ranges outside the clip and clips of another
+// skeleton, writing nothing
+TEST_CASE("JointQueryRejection", "[joint_query]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  unique_ptr<SceneGraph> folded = LoadFixture(0.f);
+  int32_t ids[1] = {sg->JointIndex("LeftHand")};
+  JointQuery query(sg->clip->skeleton, ids, 1);
+  vector<float> out(query.OutputSize(sg->NumFrames()), -1.f);
+
+  CHECK_FALSE(query.Run(*sg->clip, 4, sg->NumFrames() + 1, &out[0]));
+  CHECK_FALSE(query.Run(*sg->clip, 5, 4, &out[0]));
+  CHECK_FALSE(query.Run(*folded->clip, 0, 4, &out[0]));
+  CHECK_FALSE(sg->QueryJointWorld(ids, 1, 0, sg->NumFrames() + 1, &out[0]));
+  CHECK(out == vector<float>(out.size(), -1.f));
+  CHECK(sg->QueryJointWorld(ids, 1, 0, sg->NumFrames(), &out[0]));
+}
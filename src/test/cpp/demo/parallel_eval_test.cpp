@@ -0,0 +1,39 @@
+#include <catch/catch.hpp>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "joint.h"
+#include "parallel_eval.h"
+#include "thread_pool.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+// Verify a skeleton split across a pool evaluates like the serial pass,
+// and is only split when it is large enough and there is a pool
+TEST_CASE("ParallelEvaluatorMatchesSkeleton", "[parallel_eval]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  uint32_t n = skeleton.NumJoints();
+  ThreadPool pool(2);
+  ParallelEvaluator split(skeleton, &pool, 0);
+  vector<Transform> expected(n), world(n);
+
+  REQUIRE(split.IsParallel());
+  CHECK(split.NumTasks() >= 2);
+  CHECK(split.NumTrunkJoints() < n);
+  CHECK_FALSE(ParallelEvaluator(skeleton, &pool).IsParallel());
+  CHECK_FALSE(ParallelEvaluator(skeleton, NULL, 0).IsParallel());
+
+  for (uint32_t f = 0; f < sg->NumFrames(); f++) {
+    skeleton.Evaluate(sg->Frame(f), &expected[0]);
+    split.Evaluate(sg->Frame(f), &world[0]);
+    CHECK(NearlyEqual(&expected[0], &world[0], n));
+  }
+}
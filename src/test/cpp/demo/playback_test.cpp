@@ -0,0 +1,106 @@
+#include <catch/catch.hpp>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "joint.h"
+#include "playback.h"
+#include "thread_pool.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+// Verify an instance plays the clip's frames, wrapping around past the
+// last one, and drives the segment tree to the same pose
+TEST_CASE("PlaybackMatchesSkeleton", "[playback]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  uint32_t n = skeleton.NumJoints();
+  PlaybackInstance instance(sg->clip);
+  vector<Transform> world(n);
+
+  for (uint32_t f = 0; f < 2 * sg->NumFrames(); f++) {
+    uint32_t frame = f % sg->NumFrames();
+    instance.SetCurrentFrame(f);
+    skeleton.Evaluate(sg->Frame(frame), &world[0]);
+    CHECK(instance.GetCurrentFrame() == frame);
+    CHECK(NearlyEqual(&instance.world[0], &world[0], n));
+    CHECK(NearlyEqual(&instance.world[0], &SegmentPose(sg.get(), frame)[0],
+                      n));
+  }
+}
+
+// Verify incremental updates, stored rotations and a thread pool all give
+// the pose of a full evaluation, in any order of frames
+TEST_CASE("PlaybackModesAgree", "[playback]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  unique_ptr<SceneGraph> stored = LoadFixture(-1.f, true);
+  uint32_t n = sg->clip->skeleton.NumJoints();
+  ThreadPool pool(2);
+  PlaybackInstance full(sg->clip), incremental(sg->clip);
+  PlaybackInstance rotations(stored->clip), pooled(sg->clip);
+  incremental.SetIncremental(true);
+  pooled.SetThreadPool(&pool);
+
+  const uint32_t frames[] = {0, 1, 2, 2, 5, 6, 7, 8, 3, 11, 0};
+  for (uint32_t i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+    full.SetCurrentFrame(frames[i]);
+    incremental.SetCurrentFrame(frames[i]);
+    rotations.SetCurrentFrame(frames[i]);
+    pooled.SetCurrentFrame(frames[i]);
+    CHECK(NearlyEqual(&full.world[0], &incremental.world[0], n));
+    CHECK(NearlyEqual(&full.world[0], &rotations.world[0], n));
+    CHECK(NearlyEqual(&full.world[0], &pooled.world[0], n));
+  }
+
+  // Repeated frames and the held right leg are reused
+  const EvaluationStats &stats = incremental.Stats();
+  CHECK(stats.poses == sizeof(frames) / sizeof(frames[0]));
+  CHECK(stats.localsReused > 0);
+  CHECK(stats.skipped > 0);
+  CHECK(full.Stats().poses == 0);
+
+  // A copy carries on from the same state
+  PlaybackInstance copy = incremental;
+  copy.SetCurrentFrame(4);
+  full.SetCurrentFrame(4);
+  CHECK(NearlyEqual(&full.world[0], &copy.world[0], n));
+  CHECK(copy.Stats().poses == stats.poses + 1);
+  incremental.SetIncremental(false);
+  CHECK(incremental.Stats().poses == 0);
+}
+
+// Verify sampling between frames lands on each frame at whole times, stays
+// between its frames, and plays the nearest frame in whole-frame modes
+TEST_CASE("PlaybackSampleAtTime", "[playback]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  uint32_t n = sg->clip->skeleton.NumJoints();
+  double secondsPerFrame = sg->MsPerFrame() / 1000.0;
+  PlaybackInstance frame(sg->clip), sampled(sg->clip), coarse(sg->clip);
+  coarse.SetLod(1);
+
+  for (uint32_t f = 0; f + 1 < sg->NumFrames(); f++) {
+    frame.SetCurrentFrame(f);
+    sampled.SampleAtTime(f * secondsPerFrame);
+    CHECK(sampled.GetCurrentFrame() == f);
+    CHECK(NearlyEqual(&frame.world[0], &sampled.world[0], n));
+
+    // Between two frames, the root's position is interpolated linearly
+    Point start = frame.world[0](Point());
+    frame.SetCurrentFrame(f + 1);
+    Point end = frame.world[0](Point());
+    sampled.SampleAtTime((f + 0.25) * secondsPerFrame);
+    CHECK(sampled.GetCurrentFrame() == f);
+    CHECK(sampled.GetTime() == Approx((f + 0.25) * secondsPerFrame));
+    CHECK(Distance(sampled.world[0](Point()),
+                   start + (end - start) * 0.25f) < 0.001f);
+
+    coarse.SampleAtTime((f + 0.75) * secondsPerFrame);
+    CHECK(coarse.GetCurrentFrame() == f + 1);
+  }
+}
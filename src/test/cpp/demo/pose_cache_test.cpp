@@ -0,0 +1,102 @@
+#include <catch/catch.hpp>
+#include <core/matrix.h>
+#include <core/point.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "clip.h"
+#include "joint.h"
+#include "playback.h"
+#include "pose_cache.h"
+#include "thread_pool.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+// Name of the file caches are saved to, in the working directory
+static const char kCachePath[] = "pose_cache_test.poses";
+
+/// Overwrite one byte of a file
+static void PatchByte(const char *path, long offset, char value) {
+  FILE *file = fopen(path, "r+b");
+  REQUIRE(file);
+  fseek(file, offset, SEEK_SET);
+  fputc(value, file);
+  fclose(file);
+}
+
+// Verify baked poses match evaluation, serially and on a pool, and an
+// instance plays them back
+TEST_CASE("PoseCacheBake", "[pose_cache]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  uint32_t n = skeleton.NumJoints();
+  ThreadPool pool(2);
+  PoseCachePtr matrices = PoseCache::Bake(*sg->clip, POSE_MATRICES);
+  PoseCachePtr pooled = PoseCache::Bake(*sg->clip, POSE_MATRICES, &pool);
+  PoseCachePtr positions = PoseCache::Bake(*sg->clip, POSE_POSITIONS, &pool);
+  PlaybackInstance instance(sg->clip);
+  vector<Transform> world(n);
+
+  REQUIRE(instance.SetPoseCache(matrices));
+  CHECK(matrices->NumFrames() == sg->NumFrames());
+  CHECK(matrices->NumJoints() == n);
+  CHECK(positions->Matrices(0) == NULL);
+  for (uint32_t f = 0; f < sg->NumFrames(); f++) {
+    skeleton.Evaluate(sg->Frame(f), &world[0]);
+    CHECK(NearlyEqual(&world[0], matrices->Matrices(f), n));
+    CHECK(NearlyEqual(&world[0], pooled->Matrices(f), n));
+    for (uint32_t j = 0; j < n; j++)
+      CHECK(Distance(world[j](Point()), positions->Position(f, j)) < 0.001f);
+
+    instance.SetCurrentFrame(f);
+    CHECK(instance.CachedPose() == matrices->Matrices(f));
+  }
+}
+
+// Verify a saved cache maps back, and files with a bad header, the wrong
+// size, other contents or another clip's fingerprint are refused
+TEST_CASE("PoseCacheRejection", "[pose_cache]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Clip &clip = *sg->clip;
+  PoseCachePtr baked = PoseCache::Bake(clip, POSE_MATRICES);
+  PlaybackInstance instance(sg->clip);
+
+  REQUIRE(baked->Save(kCachePath));
+  PoseCachePtr mapped = PoseCache::Open(kCachePath, clip, POSE_MATRICES);
+  REQUIRE(mapped);
+  CHECK(mapped->IsMapped());
+  CHECK(NearlyEqual(mapped->Matrices(3)[4], baked->Matrices(3)[4]));
+  CHECK_FALSE(PoseCache::Open(kCachePath, clip, POSE_POSITIONS));
+
+  // Any change to the motion changes the fingerprint
+  vector<float> frames = clip.frames;
+  frames[7] += 1.f;
+  Clip edited(clip.skeleton, frames, clip.frameTime);
+  CHECK(PoseCache::Fingerprint(edited) != PoseCache::Fingerprint(clip));
+  CHECK_FALSE(PoseCache::Open(kCachePath, edited, POSE_MATRICES));
+
+  // A clip with fewer frames expects a smaller file
+  frames.resize(frames.size() - clip.FrameSize());
+  Clip shorter(clip.skeleton, frames, clip.frameTime);
+  CHECK_FALSE(PoseCache::Open(kCachePath, shorter, POSE_MATRICES));
+
+  PatchByte(kCachePath, 0, 'X');
+  CHECK_FALSE(PoseCache::Open(kCachePath, clip, POSE_MATRICES));
+  remove(kCachePath);
+  CHECK_FALSE(PoseCache::Open(kCachePath, clip, POSE_MATRICES));
+
+  // Instances only take caches of matrices of their own clip
+  CHECK_FALSE(instance.SetPoseCache(PoseCache::Bake(clip, POSE_POSITIONS)));
+  CHECK_FALSE(instance.SetPoseCache(PoseCache::Bake(shorter, POSE_MATRICES)));
+  CHECK_FALSE(instance.GetPoseCache());
+  CHECK(instance.SetPoseCache(baked));
+}
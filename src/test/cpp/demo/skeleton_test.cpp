@@ -0,0 +1,149 @@
+#include <catch/catch.hpp>
+#include <core/matrix.h>
+#include <core/transform.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "joint.h"
+#include "skeleton.h"
+
+#include "../helpers.h"
+#include "./fixture.h"
+
+using namespace std;
+using namespace ishi;
+
+// Verify the flattened skeleton computes the same world transforms as
+// updating the segment tree, at every frame
+TEST_CASE("SkeletonMatchesSegments", "[skeleton]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  vector<Transform> world(skeleton.NumJoints());
+
+  CHECK(skeleton.NumJoints() == 14);
+  for (uint32_t f = 0; f < sg->NumFrames(); f++) {
+    skeleton.Evaluate(sg->Frame(f), &world[0]);
+    CHECK(NearlyEqual(&world[0], &SegmentPose(sg.get(), f)[0],
+                      skeleton.NumJoints()));
+  }
+}
+
+// Verify the generic evaluator agrees with the one picked for the topology,
+// and batched sines and cosines with the per-joint ones
+TEST_CASE("SkeletonEvaluatorsAgree", "[skeleton]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  Skeleton generic = skeleton;
+  generic.evaluator = NULL;
+  uint32_t n = skeleton.NumJoints();
+  vector<Transform> world(n), other(n);
+  vector<float> s(skeleton.NumAngles()), c(skeleton.NumAngles());
+
+  for (uint32_t f = 0; f < sg->NumFrames(); f++) {
+    skeleton.Evaluate(sg->Frame(f), &world[0]);
+    generic.Evaluate(sg->Frame(f), &other[0]);
+    CHECK(NearlyEqual(&world[0], &other[0], n));
+
+    skeleton.SinCos(sg->Frame(f), 1, &s[0], &c[0]);
+    skeleton.Evaluate(sg->Frame(f), &s[0], &c[0], &other[0]);
+    CHECK(NearlyEqual(&world[0], &other[0], n));
+  }
+}
+
+// Verify coarse levels of detail evaluate the joints they keep exactly as
+// the full pass, and keep every joint's parent
+TEST_CASE("SkeletonLodKeepsJoints", "[skeleton]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  Skeleton generic = skeleton;
+  generic.evaluator = NULL;
+  uint32_t n = skeleton.NumJoints();
+  vector<Transform> full(n), world(n), other(n);
+
+  CHECK(skeleton.NumJointsAtLod(0) == n);
+  for (int lod = 1; lod < kNumLods; lod++) {
+    CHECK(skeleton.NumJointsAtLod(lod) <= skeleton.NumJointsAtLod(lod - 1));
+    for (uint32_t j = 1; j < n; j++)
+      CHECK(skeleton.lods[j] <= skeleton.lods[skeleton.parents[j]]);
+  }
+
+  for (int lod = 0; lod < kNumLods; lod++) {
+    for (uint32_t f = 0; f < sg->NumFrames(); f++) {
+      skeleton.Evaluate(sg->Frame(f), &full[0]);
+      skeleton.Evaluate(sg->Frame(f), lod, &world[0]);
+      generic.Evaluate(sg->Frame(f), lod, &other[0]);
+      for (uint32_t j = 0; j < n; j++) {
+        if (skeleton.lods[j] < lod)
+          continue;
+        CHECK(NearlyEqual(full[j].Matrix(), world[j].Matrix()));
+        CHECK(NearlyEqual(full[j].Matrix(), other[j].Matrix()));
+      }
+    }
+  }
+}
+
+// Verify stored rotations give the same pose as the angles, and sampling
+// lands on both frames at its ends
+TEST_CASE("SkeletonRotationsAndSamples", "[skeleton]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  uint32_t n = skeleton.NumJoints();
+  vector<Quaternion> rotations(sg->NumFrames() * skeleton.NumRotations());
+  vector<Transform> expected(n), world(n);
+
+  skeleton.Rotations(sg->Frame(0), sg->NumFrames(), &rotations[0]);
+  for (uint32_t f = 0; f + 1 < sg->NumFrames(); f++) {
+    const Quaternion *r0 = &rotations[f * skeleton.NumRotations()];
+    const Quaternion *r1 = r0 + skeleton.NumRotations();
+
+    skeleton.Evaluate(sg->Frame(f), &expected[0]);
+    skeleton.Evaluate(sg->Frame(f), r0, &world[0]);
+    CHECK(NearlyEqual(&expected[0], &world[0], n));
+    skeleton.Sample(sg->Frame(f), NULL, sg->Frame(f + 1), NULL, 0.f, false,
+                    &world[0]);
+    CHECK(NearlyEqual(&expected[0], &world[0], n));
+    skeleton.Sample(sg->Frame(f), r0, sg->Frame(f + 1), NULL, 0.f, false,
+                    &world[0]);
+    CHECK(NearlyEqual(&expected[0], &world[0], n));
+
+    skeleton.Evaluate(sg->Frame(f + 1), &expected[0]);
+    skeleton.Sample(sg->Frame(f), NULL, sg->Frame(f + 1), NULL, 1.f, false,
+                    &world[0]);
+    CHECK(NearlyEqual(&expected[0], &world[0], n));
+    skeleton.Sample(sg->Frame(f), r0, sg->Frame(f + 1), r1, 1.f, false,
+                    &world[0]);
+    CHECK(NearlyEqual(&expected[0], &world[0], n));
+  }
+}
+
+// Verify folding static channels keeps every pose and the loaded frames,
+// while storing fewer values
+TEST_CASE("SkeletonStaticFolding", "[skeleton]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  unique_ptr<SceneGraph> folded = LoadFixture(0.f);
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const Skeleton &compact = folded->clip->skeleton;
+  uint32_t n = skeleton.NumJoints();
+  vector<Transform> world(n), other(n);
+  vector<float> source(compact.sourceFrameSize);
+
+  // The head and the zero channels of the hand and feet are static
+  CHECK(compact.sourceFrameSize == skeleton.frameSize);
+  CHECK(compact.frameSize < skeleton.frameSize);
+  CHECK_FALSE(compact.Matches(skeleton));
+  CHECK(compact.channels[compact.JointIndex(
+      SymbolTable::Shared().Find("Head"))].fixed);
+
+  for (uint32_t f = 0; f < sg->NumFrames(); f++) {
+    skeleton.Evaluate(sg->Frame(f), &world[0]);
+    compact.Evaluate(folded->Frame(f), &other[0]);
+    CHECK(NearlyEqual(&world[0], &other[0], n));
+    CHECK(NearlyEqual(&other[0], &SegmentPose(folded.get(), f)[0], n));
+
+    compact.Unpack(folded->Frame(f), &source[0]);
+    CHECK(vector<float>(sg->Frame(f), sg->Frame(f) + skeleton.frameSize) ==
+          source);
+  }
+}
@@ -0,0 +1,62 @@
+#include <catch/catch.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "joint.h"
+#include "symbol.h"
+
+#include "./fixture.h"
+
+using namespace std;
+
+// Verify every distinct string gets one symbol that names it, across the
+// growth of the table, and unknown strings are not found
+TEST_CASE("SymbolTableInterning", "[symbol]") {
+  SymbolTable table;
+  vector<Symbol> symbols;
+  vector<const char*> names;
+  char name[16];
+
+  for (int i = 0; i < 500; i++) {
+    snprintf(name, sizeof(name), "joint%d", i);
+    symbols.push_back(table.Intern(name));
+    names.push_back(table.Name(symbols.back()));
+  }
+  CHECK(table.Size() == 500);
+  for (int i = 0; i < 500; i++) {
+    snprintf(name, sizeof(name), "joint%d", i);
+    CHECK(table.Intern(name) == symbols[i]);
+    CHECK(table.Find(name) == symbols[i]);
+    CHECK(strcmp(table.Name(symbols[i]), name) == 0);
+    CHECK(table.Name(symbols[i]) == names[i]);
+  }
+  CHECK(table.Size() == 500);
+  CHECK(table.Find("joint500") == kNoSymbol);
+  CHECK(table.Find("") == kNoSymbol);
+}
+
+// Verify joint names resolve to the skeleton's joints through the shared
+// table, and segments share its copy of their names
+TEST_CASE("SymbolJointLookup", "[symbol]") {
+  unique_ptr<SceneGraph> sg = LoadFixture();
+  const Skeleton &skeleton = sg->clip->skeleton;
+  const SymbolTable &symbols = SymbolTable::Shared();
+  const char *names[] = {"Hips", "LeftFoot", "Head", "Tail"};
+  int32_t indices[4];
+
+  sg->JointIndices(names, 4, indices);
+  CHECK(indices[0] == 0);
+  CHECK(indices[3] == -1);
+  for (int i = 0; i < 3; i++) {
+    REQUIRE(indices[i] >= 0);
+    CHECK(strcmp(symbols.Name(skeleton.names[indices[i]]), names[i]) == 0);
+    CHECK(sg->JointIndex(names[i]) == indices[i]);
+    CHECK(sg->JointIndex(symbols.Find(names[i])) == indices[i]);
+  }
+  CHECK(sg->root->name == symbols.Name(sg->root->symbol));
+  CHECK(sg->JointIndex("Tail") == -1);
+}
@@ -0,0 +1,35 @@
+#ifndef TEST_HELPERS_H_
+#define TEST_HELPERS_H_
+
+#include <core/matrix.h>
+#include <core/transform.h>
+#include <core/vector.h>
+
+namespace ishi {
+
+/// Return true if two matrices differ by at most 0.001 in every element
+inline bool NearlyEqual(const Matrix4x4 &a, const Matrix4x4 &b) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      float d = a.m[i][j] - b.m[i][j];
+      if (d < -0.001f || d > 0.001f)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Return true if two vectors differ by less than 0.001
+inline bool NearlyEqual(const Vector &a, const Vector &b) {
+  return Length(a - b) < 0.001f;
+}
+
+/// Return a rigid transform built from the general transforms
+inline Transform RigidSample(float angle, const Vector &delta) {
+  return Translate(delta) * RotateZ(angle) * RotateX(angle * 0.7f) *
+      RotateY(-angle);
+}
+
+}  // namespace ishi
+
+#endif